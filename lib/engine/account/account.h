@@ -93,6 +93,17 @@ namespace Ekiga
      * @return Whether the account is active
      */
     virtual bool is_active () const = 0;
+
+
+    /** Enables the account : it will try to register or connect, and
+     * will do so again at the next startup.
+     */
+    virtual void enable () = 0;
+
+
+    /** Disables the account : it will unregister or disconnect.
+     */
+    virtual void disable () = 0;
   };
 
   typedef boost::shared_ptr<Account> AccountPtr;
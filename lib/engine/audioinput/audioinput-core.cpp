@@ -43,6 +43,10 @@
 #include "ekiga-settings.h"
 
 #include "audioinput-core.h"
+#include "audio-dsp.h"
+
+/* The capture ring holds that many 20 ms frames */
+#define AUDIO_INPUT_CAPTURE_RING_FRAMES 5
 
 using namespace Ekiga;
 
@@ -56,6 +60,80 @@ static void audio_device_changed (G_GNUC_UNUSED GSettings *settings,
   core->setup ();
 }
 
+AudioInputCore::AudioCaptureManager::AudioCaptureManager (AudioInputCore& _audioinput_core)
+: PThread (1000, AutoDeleteThread, HighestPriority, "AudioCaptureManager"),
+  audioinput_core (_audioinput_core)
+{
+  end_thread = false;
+  pause_thread = true;
+  frame = NULL;
+  frame_size = 0;
+  // Since windows does not like to restart a thread that
+  // was never started, we do so here
+  this->Resume ();
+  thread_created.Wait ();
+}
+
+void AudioInputCore::AudioCaptureManager::quit ()
+{
+  stop ();
+
+  end_thread = true;
+  run_thread.Signal ();
+
+  /* Wait for the Main () method to be terminated */
+  PWaitAndSignal m(thread_ended);
+}
+
+void AudioInputCore::AudioCaptureManager::start (unsigned _frame_size)
+{
+  PTRACE(4, "AudioCaptureManager\tStarting capture with " << _frame_size << " bytes frames");
+
+  {
+    PWaitAndSignal c(capture_mutex);
+    if (frame_size != _frame_size) {
+      free (frame);
+      frame = (char*) malloc (_frame_size);
+      frame_size = _frame_size;
+    }
+    pause_thread = false;
+  }
+
+  run_thread.Signal ();
+}
+
+void AudioInputCore::AudioCaptureManager::stop ()
+{
+  PTRACE(4, "AudioCaptureManager\tStopping capture");
+
+  PWaitAndSignal c(capture_mutex);
+  pause_thread = true;
+}
+
+void AudioInputCore::AudioCaptureManager::Main ()
+{
+  PWaitAndSignal m(thread_ended);
+  bool capture = false;
+
+  thread_created.Signal ();
+
+  while (!end_thread) {
+
+    {
+      PWaitAndSignal c(capture_mutex);
+      capture = !pause_thread;
+      if (capture)
+        audioinput_core.capture_frame (frame, frame_size);
+    }
+
+    if (!capture)
+      run_thread.Wait ();
+  }
+
+  free (frame);
+  frame = NULL;
+}
+
 
 AudioInputCore::AudioInputCore (Ekiga::ServiceCore & _core) : core(_core)
 {
@@ -78,19 +156,32 @@ AudioInputCore::AudioInputCore (Ekiga::ServiceCore & _core) : core(_core)
 
   desired_volume = 0;
   current_volume = 0;
+  use_software_volume = false;
+  software_volume = 255;
 
   current_manager = NULL;
   average_level = 0;
   calculate_average = false;
   yield = false;
 
+  threaded_capture = false;
+  capture_active = 0;
+  captured_frames = 0;
+  dropped_frames = 0;
+  capture_underruns = 0;
+  capture_timeout = 0;
+
   notification_core = core.get<Ekiga::NotificationCore> ("notification-core");
   audio_device_settings = g_settings_new (AUDIO_DEVICES_SCHEMA);
   audio_device_settings_signal = 0;
+
+  capture_manager = new AudioCaptureManager (*this);
 }
 
 AudioInputCore::~AudioInputCore ()
 {
+  capture_manager->quit ();
+
   PWaitAndSignal m(core_mutex);
 
   for (std::set<AudioInputManager *>::iterator iter = managers.begin ();
@@ -108,6 +199,7 @@ void AudioInputCore::setup ()
   gchar* audio_device = NULL;
 
   audio_device = g_settings_get_string (audio_device_settings, "input-device");
+  threaded_capture = g_settings_get_boolean (audio_device_settings, "threaded-input-capture");
 
   set_device (audio_device);
 
@@ -338,27 +430,53 @@ void AudioInputCore::set_stream_buffer_size (unsigned buffer_size, unsigned num_
 
 void AudioInputCore::start_stream (unsigned channels, unsigned samplerate, unsigned bits_per_sample)
 {
+  unsigned frame_size = 0;
+
   yield = true;
-  PWaitAndSignal m(core_mutex);
+  {
+    PWaitAndSignal m(core_mutex);
 
-  PTRACE(4, "AudioInputCore\tStarting stream " << channels << "x" << samplerate << "/" << bits_per_sample);
+    PTRACE(4, "AudioInputCore\tStarting stream " << channels << "x" << samplerate << "/" << bits_per_sample);
 
-  if (preview_config.active || stream_config.active) {
-    PTRACE(1, "AudioInputCore\tTrying to start stream in wrong state");
-  }
+    if (preview_config.active || stream_config.active) {
+      PTRACE(1, "AudioInputCore\tTrying to start stream in wrong state");
+    }
 
-  internal_open(channels, samplerate, bits_per_sample);
+    internal_open(channels, samplerate, bits_per_sample);
 
-  stream_config.active = true;
-  stream_config.channels = channels;
-  stream_config.samplerate = samplerate;
-  stream_config.bits_per_sample = bits_per_sample;
+    stream_config.active = true;
+    stream_config.channels = channels;
+    stream_config.samplerate = samplerate;
+    stream_config.bits_per_sample = bits_per_sample;
 
-  average_level = 0;
+    average_level = 0;
+
+    if (threaded_capture) {
+
+      frame_size = channels * samplerate * (bits_per_sample / 8) / 50; // 20 ms
+      capture_ring.resize (frame_size * AUDIO_INPUT_CAPTURE_RING_FRAMES);
+      capture_timeout = 2 * 20;
+      g_atomic_int_set (&captured_frames, 0);
+      g_atomic_int_set (&dropped_frames, 0);
+      g_atomic_int_set (&capture_underruns, 0);
+      g_atomic_int_set (&capture_active, 1);
+    }
+  }
+
+  // The capture thread takes the core_mutex for each frame,
+  // so it must be driven without holding it
+  if (frame_size > 0)
+    capture_manager->start (frame_size);
 }
 
 void AudioInputCore::stop_stream ()
 {
+  if (g_atomic_int_get (&capture_active)) {
+
+    g_atomic_int_set (&capture_active, 0);
+    capture_manager->stop ();
+  }
+
   yield = true;
   PWaitAndSignal m(core_mutex);
 
@@ -378,12 +496,45 @@ void AudioInputCore::get_frame_data (char *data,
                                      unsigned size,
 				     unsigned & bytes_read)
 {
-  if (yield) {
-    yield = false;
-    g_usleep (5 * G_TIME_SPAN_MILLISECOND);
+  if (g_atomic_int_get (&capture_active)) {
+
+    drain_capture_ring (data, size, bytes_read);
+  }
+  else {
+
+    if (yield) {
+      yield = false;
+      g_usleep (5 * G_TIME_SPAN_MILLISECOND);
+    }
+    PWaitAndSignal m_var(core_mutex);
+
+    internal_get_frame_data (data, size, bytes_read);
   }
-  PWaitAndSignal m_var(core_mutex);
 
+  if (calculate_average)
+    calculate_average_level((const short*) data, bytes_read);
+}
+
+void AudioInputCore::set_threaded_capture (bool on_off)
+{
+  PWaitAndSignal m(core_mutex);
+
+  threaded_capture = on_off;
+}
+
+void AudioInputCore::get_capture_statistics (unsigned & captured,
+                                             unsigned & dropped,
+                                             unsigned & underruns) const
+{
+  captured = g_atomic_int_get (&captured_frames);
+  dropped = g_atomic_int_get (&dropped_frames);
+  underruns = g_atomic_int_get (&capture_underruns);
+}
+
+void AudioInputCore::internal_get_frame_data (char *data,
+                                              unsigned size,
+                                              unsigned & bytes_read)
+{
   if (current_manager) {
     if (!current_manager->get_frame_data(data, size, bytes_read)) {
       internal_close();
@@ -393,15 +544,75 @@ void AudioInputCore::get_frame_data (char *data,
         current_manager->get_frame_data(data, size, bytes_read); // the default device must always return true
     }
 
-    PWaitAndSignal m_vol(volume_mutex);
-    if (desired_volume != current_volume) {
+    internal_apply_volume ();
+
+    if (use_software_volume)
+      AudioDSP::apply_volume ((gint16*) data, bytes_read >> 1, software_volume);
+  }
+}
+
+void AudioInputCore::internal_apply_volume ()
+{
+  PWaitAndSignal m_vol(volume_mutex);
+
+  if (desired_volume != current_volume) {
+    if (use_software_volume)
+      software_volume = desired_volume;
+    else
       current_manager->set_volume (desired_volume);
-      current_volume = desired_volume;
+    current_volume = desired_volume;
+  }
+}
+
+void AudioInputCore::capture_frame (char *data,
+                                    unsigned size)
+{
+  unsigned bytes_read = 0;
+
+  {
+    PWaitAndSignal m(core_mutex);
+    internal_get_frame_data (data, size, bytes_read);
+  }
+
+  if (bytes_read == 0) {
+
+    // Do not spin if there is no manager to block on
+    PThread::Sleep (20);
+    return;
+  }
+
+  g_atomic_int_inc (&captured_frames);
+
+  if (capture_ring.get_free () < bytes_read)
+    g_atomic_int_inc (&dropped_frames);
+  else
+    capture_ring.write (data, bytes_read);
+
+  capture_ready.Signal ();
+}
+
+void AudioInputCore::drain_capture_ring (char *data,
+                                         unsigned size,
+                                         unsigned & bytes_read)
+{
+  unsigned done = capture_ring.read (data, size);
+
+  while (done < size) {
+
+    if (!capture_ready.Wait (capture_timeout)) {
+
+      // The capture thread is late (slow device, device switch) :
+      // better send silence than stall the streaming thread
+      done += capture_ring.read (data + done, size - done);
+      memset (data + done, 0, size - done);
+      g_atomic_int_inc (&capture_underruns);
+      break;
     }
+
+    done += capture_ring.read (data + done, size - done);
   }
 
-  if (calculate_average)
-    calculate_average_level((const short*) data, bytes_read);
+  bytes_read = size;
 }
 
 void AudioInputCore::set_volume (unsigned volume)
@@ -420,6 +631,14 @@ void AudioInputCore::on_device_opened (AudioInputDevice device,
                                        AudioInputSettings settings,
                                        AudioInputManager *manager)
 {
+  // Devices without a mixer get their volume applied in software
+  use_software_volume = !settings.modifyable;
+  if (use_software_volume) {
+
+    settings.modifyable = true;
+    settings.volume = software_volume;
+  }
+
   device_opened (*manager, device, settings);
 }
 
@@ -516,18 +735,5 @@ void AudioInputCore::internal_close()
 
 void AudioInputCore::calculate_average_level (const short *buffer, unsigned size)
 {
-  int sum = 0;
-  unsigned csize = 0;
-
-  while (csize < (size>>1) ) {
-
-    if (*buffer < 0)
-      sum -= *buffer++;
-    else
-      sum += *buffer++;
-
-    csize++;
-  }
-
-  average_level = log10 (9.0*sum/size/32767+1)*1.0;
+  average_level = AudioDSP::average_level (buffer, size);
 }
@@ -43,6 +43,7 @@
 #include "audioinput-manager.h"
 #include "notification-core.h"
 #include "hal-core.h"
+#include "lockfree-ring.h"
 
 #include <ptlib.h>
 #include <gio/gio.h>
@@ -102,6 +103,13 @@ namespace Ekiga
    * testing. Note that, contrary to the video preview, the audio preview does not support
    * direct switching between the preview and the streaming mode, which must tus be
    * be prevented by the UI.
+   *
+   * In the threaded capture mode (see set_threaded_capture()), the stream
+   * is read from the current manager by a dedicated thread (represented by
+   * the AudioCaptureManager), which fills a preallocated lock-free ring buffer.
+   * get_frame_data() then only drains that ring, without taking any lock,
+   * so that device switches and UI calls never stall the audio streaming
+   * thread.
    */
   class AudioInputCore
     : public Service
@@ -246,9 +254,30 @@ namespace Ekiga
        */
       void get_frame_data (char *data, unsigned size, unsigned & bytes_read);
 
+      /** Turn the threaded capture mode on and off
+       * In threaded capture mode, the device is read by a dedicated thread
+       * into a lock-free ring buffer, and get_frame_data() only drains that
+       * ring. If the ring does not hold enough data in time, silence is
+       * returned instead of blocking the streaming thread.
+       * Will be applied the next time the stream is started.
+       * @param on_off whether to turn the threaded capture on or off.
+       */
+      void set_threaded_capture (bool on_off);
+
+      /** Get the threaded capture statistics
+       * The counters are reset each time the stream is started.
+       * @param captured the number of frames read from the device.
+       * @param dropped the number of frames dropped because the ring was full.
+       * @param underruns the number of reads which had to be completed with silence.
+       */
+      void get_capture_statistics (unsigned & captured,
+                                   unsigned & dropped,
+                                   unsigned & underruns) const;
+
       /** Set the volume of the next opportunity
        * Sets the volume to the specified value the next time
-       * get_frame_data() is called.
+       * get_frame_data() is called. If the current device has no mixer,
+       * the volume is applied in software on the captured samples.
        * @param volume The new volume level (0..255).
        */
       void set_volume (unsigned volume);
@@ -289,6 +318,53 @@ namespace Ekiga
       boost::signals2::signal<void(AudioInputDevice, bool)> device_removed;
 
   private:
+      /** AudioCaptureManager thread.
+        *
+        * AudioCaptureManager represents a thread that reads frames from the
+        * current audio input manager and pushes them into the lock-free
+        * capture ring of the audio input core. It only runs while the stream
+        * is active in threaded capture mode.
+        */
+      class AudioCaptureManager : public PThread
+      {
+        PCLASSINFO(AudioCaptureManager, PThread);
+
+      public:
+        /** The constructor
+        * @param _audioinput_core reference to the audio input core.
+        */
+        AudioCaptureManager (AudioInputCore & _audioinput_core);
+
+        void quit ();
+
+        /** Start capturing.
+        * Requires the current device to be opened and the ring to be allocated.
+        * @param _frame_size the number of bytes read from the device at once.
+        */
+        void start (unsigned _frame_size);
+
+        /** Stop capturing.
+        * Blocks until the frame being read (if any) has been pushed.
+        * MUST NOT be called with the core_mutex held.
+        */
+        void stop ();
+
+      protected:
+        void Main ();
+
+        bool end_thread;
+        bool pause_thread;
+
+        PMutex thread_ended;
+        PMutex capture_mutex;
+        PSyncPoint run_thread;
+        PSyncPoint thread_created;
+
+        AudioInputCore & audioinput_core;
+        char* frame;
+        unsigned frame_size;
+      };
+
       void on_set_device (const AudioInputDevice & device);
       void on_device_opened (AudioInputDevice device,
                              AudioInputSettings settings,
@@ -303,6 +379,12 @@ namespace Ekiga
       void internal_open (unsigned channels, unsigned samplerate, unsigned bits_per_sample);
       void internal_close();
 
+      void internal_get_frame_data (char *data, unsigned size, unsigned & bytes_read);
+      void internal_apply_volume ();
+
+      void capture_frame (char *data, unsigned size);
+      void drain_capture_ring (char *data, unsigned size, unsigned & bytes_read);
+
       void calculate_average_level (const short *buffer, unsigned size);
 
   private:
@@ -327,6 +409,8 @@ namespace Ekiga
       AudioInputDevice current_device;
       unsigned current_volume;
       unsigned desired_volume;
+      bool use_software_volume;
+      unsigned software_volume;
 
       PMutex core_mutex;
       PMutex volume_mutex;
@@ -335,6 +419,16 @@ namespace Ekiga
       bool calculate_average;
       bool yield;
 
+      AudioCaptureManager* capture_manager;
+      LockFreeRing capture_ring;
+      PSyncPoint capture_ready;
+      bool threaded_capture;
+      volatile gint capture_active;
+      volatile gint captured_frames;
+      volatile gint dropped_frames;
+      volatile gint capture_underruns;
+      unsigned capture_timeout;
+
       Ekiga::ServiceCore & core;
       boost::shared_ptr<Ekiga::NotificationCore> notification_core;
 
@@ -42,9 +42,30 @@
 
 #include "audiooutput-core.h"
 #include "audiooutput-manager.h"
+#include "audio-dsp.h"
 
 #include "ekiga-settings.h"
 
+/* The playout ring holds that many 20 ms frames ; its target fill
+ * starts at 2 frames and can grow up to half the ring
+ */
+#define AUDIO_OUTPUT_PLAYOUT_RING_FRAMES 16
+#define AUDIO_OUTPUT_PLAYOUT_START_FRAMES 2
+
+/* The target fill is lowered by a frame after that many frames
+ * were played without any underrun (5 s)
+ */
+#define AUDIO_OUTPUT_PLAYOUT_STABLE_FRAMES 250
+
+/* While the ring is above its target fill, a writer waits that long
+ * (in ms, a bit more than a frame) for the playout thread to take a
+ * frame, before dropping its buffer
+ */
+#define AUDIO_OUTPUT_PLAYOUT_WRITE_WAIT 30
+
+/* The number of sounds which can wait for a device */
+#define AUDIO_OUTPUT_EVENT_QUEUE_SIZE 8
+
 using namespace Ekiga;
 
 static void sound_event_changed (G_GNUC_UNUSED GSettings *settings,
@@ -76,6 +97,146 @@ static void audio_device_changed (GSettings *settings,
     core->setup_audio_device (secondary);
 }
 
+AudioOutputCore::AudioPlayoutManager::AudioPlayoutManager (AudioOutputCore& _audio_output_core)
+: PThread (1000, AutoDeleteThread, HighestPriority, "AudioPlayoutManager"),
+  audio_output_core (_audio_output_core)
+{
+  end_thread = false;
+  pause_thread = true;
+  frame = NULL;
+  frame_size = 0;
+  // Since windows does not like to restart a thread that
+  // was never started, we do so here
+  this->Resume ();
+  thread_created.Wait ();
+}
+
+void AudioOutputCore::AudioPlayoutManager::quit ()
+{
+  stop ();
+
+  end_thread = true;
+  run_thread.Signal ();
+
+  /* Wait for the Main () method to be terminated */
+  PWaitAndSignal m(thread_ended);
+}
+
+void AudioOutputCore::AudioPlayoutManager::start (unsigned _frame_size)
+{
+  PTRACE(4, "AudioPlayoutManager\tStarting playout with " << _frame_size << " bytes frames");
+
+  {
+    PWaitAndSignal p(playout_mutex);
+    if (frame_size != _frame_size) {
+      free (frame);
+      frame = (char*) malloc (_frame_size);
+      frame_size = _frame_size;
+    }
+    pause_thread = false;
+  }
+
+  run_thread.Signal ();
+}
+
+void AudioOutputCore::AudioPlayoutManager::stop ()
+{
+  PTRACE(4, "AudioPlayoutManager\tStopping playout");
+
+  PWaitAndSignal p(playout_mutex);
+  pause_thread = true;
+}
+
+void AudioOutputCore::AudioPlayoutManager::Main ()
+{
+  PWaitAndSignal m(thread_ended);
+  bool playout = false;
+
+  thread_created.Signal ();
+
+  while (!end_thread) {
+
+    {
+      PWaitAndSignal p(playout_mutex);
+      playout = !pause_thread;
+      if (playout)
+        audio_output_core.playout_frame (frame, frame_size);
+    }
+
+    if (!playout)
+      run_thread.Wait ();
+  }
+
+  free (frame);
+  frame = NULL;
+}
+
+AudioOutputCore::AudioEventPlayer::AudioEventPlayer (AudioOutputCore& _audio_output_core,
+                                                     AudioOutputPS _ps)
+: PThread (1000, AutoDeleteThread, HighestPriority, "AudioEventPlayer"),
+  audio_output_core (_audio_output_core),
+  ps (_ps)
+{
+  end_thread = false;
+  // Since windows does not like to restart a thread that
+  // was never started, we do so here
+  this->Resume ();
+  thread_created.Wait ();
+}
+
+void AudioOutputCore::AudioEventPlayer::quit ()
+{
+  end_thread = true;
+  run_thread.Signal ();
+
+  /* Wait for the Main () method to be terminated */
+  PWaitAndSignal m(thread_ended);
+}
+
+void AudioOutputCore::AudioEventPlayer::enqueue (AudioSoundPtr sound)
+{
+  {
+    PWaitAndSignal q(queue_mutex);
+
+    if (queue.size () >= AUDIO_OUTPUT_EVENT_QUEUE_SIZE) {
+
+      PTRACE(1, "AudioEventPlayer\tDropping sound event, too many pending on device[" << ps << "]");
+      queue.pop_front ();
+    }
+    queue.push_back (sound);
+  }
+
+  run_thread.Signal ();
+}
+
+void AudioOutputCore::AudioEventPlayer::Main ()
+{
+  PWaitAndSignal m(thread_ended);
+  AudioSoundPtr sound;
+
+  thread_created.Signal ();
+
+  while (!end_thread) {
+
+    {
+      PWaitAndSignal q(queue_mutex);
+      if (!queue.empty ()) {
+
+        sound = queue.front ();
+        queue.pop_front ();
+      }
+    }
+
+    if (sound) {
+
+      audio_output_core.internal_play (ps, sound);
+      sound.reset ();
+    }
+    else
+      run_thread.Wait ();
+  }
+}
+
 
 AudioOutputCore::AudioOutputCore (Ekiga::ServiceCore& core)
 {
@@ -94,6 +255,8 @@ AudioOutputCore::AudioOutputCore (Ekiga::ServiceCore& core)
 
   current_primary_volume = 0;
   desired_primary_volume = 0;
+  use_software_volume = false;
+  software_volume = 255;
 
   current_manager[primary] = NULL;
   current_manager[secondary] = NULL;
@@ -101,20 +264,39 @@ AudioOutputCore::AudioOutputCore (Ekiga::ServiceCore& core)
   calculate_average = false;
   yield = false;
 
+  threaded_playout = false;
+  playout_active = 0;
+  played_frames = 0;
+  playout_underruns = 0;
+  playout_overruns = 0;
+  playout_target = 0;
+  playout_frame_size = 0;
+  playout_stable_frames = 0;
+  playout_buffering = true;
+
   notification_core = core.get<Ekiga::NotificationCore> ("notification-core");
   sound_events_settings = g_settings_new (SOUND_EVENTS_SCHEMA);
   audio_device_settings = g_settings_new (AUDIO_DEVICES_SCHEMA);
   audio_device_settings_signals[primary] = 0;
   audio_device_settings_signals[secondary] = 0;
+
+  playout_manager = new AudioPlayoutManager (*this);
+  sound_playing[primary] = false;
+  sound_playing[secondary] = false;
+  event_player[primary] = new AudioEventPlayer (*this, primary);
+  event_player[secondary] = new AudioEventPlayer (*this, secondary);
 }
 
 AudioOutputCore::~AudioOutputCore ()
 {
+  playout_manager->quit ();
+  audio_event_scheduler->quit ();
+  event_player[primary]->quit ();
+  event_player[secondary]->quit ();
+
   PWaitAndSignal m_pri(core_mutex[primary]);
   PWaitAndSignal m_sec(core_mutex[secondary]);
 
-  audio_event_scheduler->quit ();
-
   for (std::set<AudioOutputManager *>::iterator iter = managers.begin ();
        iter != managers.end ();
        iter++)
@@ -129,6 +311,8 @@ AudioOutputCore::~AudioOutputCore ()
 
 void AudioOutputCore::setup ()
 {
+  threaded_playout = g_settings_get_boolean (audio_device_settings, "threaded-output-playout");
+
   setup_audio_device (primary);
   setup_audio_device (secondary);
   setup_sound_events ();
@@ -349,17 +533,17 @@ void AudioOutputCore::set_device(AudioOutputPS ps, const AudioOutputDevice & dev
 {
   PTRACE(4, "AudioOutputCore\tSetting device[" << ps << "]: " << device);
   yield = true;
+  // Always in that order, both outputs may be affected
+  PWaitAndSignal m_pri(core_mutex[primary]);
   PWaitAndSignal m_sec(core_mutex[secondary]);
 
   switch (ps) {
     case primary:
-      yield = true;
-      core_mutex[primary].Wait();
       internal_set_primary_device (device);
-      core_mutex[primary].Signal();
 
       break;
     case secondary:
+        internal_stop_sound (secondary);
         if (device == current_device[primary])
         {
           current_manager[secondary] = NULL;
@@ -402,6 +586,7 @@ void AudioOutputCore::remove_device (const std::string & sink, const std::string
   PTRACE(4, "AudioOutputCore\tRemoving Device " << device_name);
   yield = true;
   PWaitAndSignal m_pri(core_mutex[primary]);
+  PWaitAndSignal m_sec(core_mutex[secondary]);
 
   AudioOutputDevice device;
   for (std::set<AudioOutputManager *>::iterator iter = managers.begin ();
@@ -427,27 +612,57 @@ void AudioOutputCore::remove_device (const std::string & sink, const std::string
 
 void AudioOutputCore::start (unsigned channels, unsigned samplerate, unsigned bits_per_sample)
 {
+  unsigned frame_size = 0;
+
   yield = true;
-  PWaitAndSignal m_pri(core_mutex[primary]);
+  {
+    PWaitAndSignal m_pri(core_mutex[primary]);
 
-  if (current_primary_config.active) {
-    PTRACE(1, "AudioOutputCore\tTrying to start output device although already started");
-    return;
-  }
+    if (current_primary_config.active) {
+      PTRACE(1, "AudioOutputCore\tTrying to start output device although already started");
+      return;
+    }
 
 
-  average_level = 0;
-  internal_open(primary, channels, samplerate, bits_per_sample);
-  current_primary_config.active = true;
-  current_primary_config.channels = channels;
-  current_primary_config.samplerate = samplerate;
-  current_primary_config.bits_per_sample = bits_per_sample;
-  current_primary_config.buffer_size = 0;
-  current_primary_config.num_buffers = 0;
+    average_level = 0;
+    internal_stop_sound (primary); // the call has priority over sound events
+    internal_open(primary, channels, samplerate, bits_per_sample);
+    current_primary_config.active = true;
+    current_primary_config.channels = channels;
+    current_primary_config.samplerate = samplerate;
+    current_primary_config.bits_per_sample = bits_per_sample;
+    current_primary_config.buffer_size = 0;
+    current_primary_config.num_buffers = 0;
+
+    if (threaded_playout) {
+
+      frame_size = channels * samplerate * (bits_per_sample / 8) / 50; // 20 ms
+      playout_ring.resize (frame_size * AUDIO_OUTPUT_PLAYOUT_RING_FRAMES);
+      playout_frame_size = frame_size;
+      playout_stable_frames = 0;
+      playout_buffering = true;
+      g_atomic_int_set (&playout_target, frame_size * AUDIO_OUTPUT_PLAYOUT_START_FRAMES);
+      g_atomic_int_set (&played_frames, 0);
+      g_atomic_int_set (&playout_underruns, 0);
+      g_atomic_int_set (&playout_overruns, 0);
+      g_atomic_int_set (&playout_active, 1);
+    }
+  }
+
+  // The playout thread takes the core_mutex for each frame,
+  // so it must be driven without holding it
+  if (frame_size > 0)
+    playout_manager->start (frame_size);
 }
 
 void AudioOutputCore::stop()
 {
+  if (g_atomic_int_get (&playout_active)) {
+
+    g_atomic_int_set (&playout_active, 0);
+    playout_manager->stop ();
+  }
+
   yield = true;
   PWaitAndSignal m_pri(core_mutex[primary]);
 
@@ -472,12 +687,75 @@ void AudioOutputCore::set_frame_data (const char *data,
                                       unsigned size,
 				      unsigned & bytes_written)
 {
-  if (yield) {
-    yield = false;
-    g_usleep (5 * G_TIME_SPAN_MILLISECOND);
+  if (g_atomic_int_get (&playout_active)) {
+
+    // The caller is paced by this write, as it would be by a blocking
+    // device write : wait for the playout thread while the ring is full
+    // enough, and only drop the buffer if it doesn't take anything
+    bool stalled = false;
+    while (!stalled
+           && g_atomic_int_get (&playout_active)
+           && playout_ring.get_fill () >= (unsigned) g_atomic_int_get (&playout_target) + size)
+      stalled = !playout_drained.Wait (AUDIO_OUTPUT_PLAYOUT_WRITE_WAIT);
+
+    if (stalled || playout_ring.get_free () < size)
+      g_atomic_int_inc (&playout_overruns);
+    else
+      playout_ring.write (data, size);
+    playout_ready.Signal ();
+    bytes_written = size;
+  }
+  else {
+
+    if (yield) {
+      yield = false;
+      g_usleep (5 * G_TIME_SPAN_MILLISECOND);
+    }
+    PWaitAndSignal m_pri(core_mutex[primary]);
+
+    internal_set_frame_data (data, size, bytes_written);
   }
+
+  if (calculate_average) 
+    calculate_average_level((const short*) data, bytes_written);
+}
+
+void AudioOutputCore::set_threaded_playout (bool on_off)
+{
   PWaitAndSignal m_pri(core_mutex[primary]);
 
+  threaded_playout = on_off;
+}
+
+void AudioOutputCore::get_playout_statistics (unsigned & played,
+                                              unsigned & underruns,
+                                              unsigned & overruns,
+                                              unsigned & target,
+                                              unsigned & depth) const
+{
+  played = g_atomic_int_get (&played_frames);
+  underruns = g_atomic_int_get (&playout_underruns);
+  overruns = g_atomic_int_get (&playout_overruns);
+  target = (playout_frame_size > 0) ?
+    g_atomic_int_get (&playout_target) * 20 / playout_frame_size : 0;
+  depth = (playout_frame_size > 0) ?
+    playout_ring.get_fill () * 20 / playout_frame_size : 0;
+}
+
+void AudioOutputCore::internal_set_frame_data (const char *data,
+                                               unsigned size,
+                                               unsigned & bytes_written)
+{
+  if (use_software_volume && software_volume < 255) {
+
+    // Devices without a mixer get their volume applied in software
+    if (software_volume_buffer.size () < size)
+      software_volume_buffer.resize (size);
+    memcpy (&software_volume_buffer[0], data, size);
+    AudioDSP::apply_volume ((gint16*) &software_volume_buffer[0], size >> 1, software_volume);
+    data = &software_volume_buffer[0];
+  }
+
   if (current_manager[primary]) {
     if (!current_manager[primary]->set_frame_data(primary, data, size, bytes_written)) {
       internal_close(primary);
@@ -489,13 +767,76 @@ void AudioOutputCore::set_frame_data (const char *data,
 
     PWaitAndSignal m_vol(volume_mutex);
     if (desired_primary_volume != current_primary_volume) {
-      current_manager[primary]->set_volume(primary, desired_primary_volume);
+      if (use_software_volume)
+        software_volume = desired_primary_volume;
+      else
+        current_manager[primary]->set_volume(primary, desired_primary_volume);
       current_primary_volume = desired_primary_volume;
     }
   }
+}
 
-  if (calculate_average) 
-    calculate_average_level((const short*) data, bytes_written);
+void AudioOutputCore::playout_frame (char *data,
+                                     unsigned size)
+{
+  unsigned bytes_written = 0;
+  unsigned target = g_atomic_int_get (&playout_target);
+  unsigned fill = playout_ring.get_fill ();
+
+  if (playout_buffering && fill < target) {
+
+    // (Re)filling the ring up to its target before playing
+    if (playout_ready.Wait (20))
+      return;
+
+    // Nothing came in time : keep the device fed
+    memset (data, 0, size);
+  }
+  else if (fill < size) {
+
+    // Underrun : play what is left, and aim at a fuller ring
+    playout_ring.read (data, fill);
+    memset (data + fill, 0, size - fill);
+    g_atomic_int_inc (&playout_underruns);
+    if (target + size <= playout_ring.get_capacity () / 2)
+      g_atomic_int_set (&playout_target, target + size);
+    playout_buffering = true;
+    playout_stable_frames = 0;
+  }
+  else {
+
+    // Too much latency piled up : drop a frame
+    if (fill > target + 2 * size) {
+
+      playout_ring.read (data, size);
+      g_atomic_int_inc (&playout_overruns);
+    }
+
+    playout_ring.read (data, size);
+    g_atomic_int_inc (&played_frames);
+    playout_buffering = false;
+
+    if (++playout_stable_frames >= AUDIO_OUTPUT_PLAYOUT_STABLE_FRAMES) {
+
+      if (target > size * AUDIO_OUTPUT_PLAYOUT_START_FRAMES)
+        g_atomic_int_set (&playout_target, target - size);
+      playout_stable_frames = 0;
+    }
+  }
+
+  // a writer may be waiting for room in the ring
+  playout_drained.Signal ();
+
+  {
+    PWaitAndSignal m_pri(core_mutex[primary]);
+    internal_set_frame_data (data, size, bytes_written);
+  }
+
+  if (bytes_written == 0) {
+
+    // Do not spin if there is no device to block on
+    PThread::Sleep (20);
+  }
 }
 
 void AudioOutputCore::set_volume (AudioOutputPS ps, unsigned volume)
@@ -507,43 +848,22 @@ void AudioOutputCore::set_volume (AudioOutputPS ps, unsigned volume)
   }
 }
 
-void AudioOutputCore::play_buffer(AudioOutputPS ps, const char* buffer, unsigned long len, unsigned channels, unsigned sample_rate, unsigned bps)
+void AudioOutputCore::play_sound (AudioOutputPS ps, AudioSoundPtr sound)
 {
-  switch (ps) {
-    case primary:
-      core_mutex[primary].Wait();
+  event_player[ps]->enqueue (sound);
+}
 
-      if (!current_manager[primary]) {
-        PTRACE(1, "AudioOutputCore\tDropping sound event, primary manager not set");
-        core_mutex[primary].Signal();
-        return;
-      }
+void AudioOutputCore::play_buffer(AudioOutputPS ps, const char* buffer, unsigned long len, unsigned channels, unsigned sample_rate, unsigned bps)
+{
+  AudioSoundPtr sound (new AudioSound);
 
-      if (current_primary_config.active) {
-        PTRACE(1, "AudioOutputCore\tDropping sound event, primary device not set");
-        core_mutex[primary].Signal();
-        return;
-      }
-      internal_play(primary, buffer, len, channels, sample_rate, bps);
-      core_mutex[primary].Signal();
+  sound->mtime = 0;
+  sound->data.assign (buffer, buffer + len);
+  sound->channels = channels;
+  sound->sample_rate = sample_rate;
+  sound->bps = bps;
 
-      break;
-    case secondary:
-        core_mutex[secondary].Wait();
- 
-        if (current_manager[secondary]) {
-             internal_play(secondary, buffer, len, channels, sample_rate, bps);
-          core_mutex[secondary].Signal();
-        }
-        else {
-          core_mutex[secondary].Signal();
-          PTRACE(1, "AudioOutputCore\tNo secondary audiooutput device defined, trying primary");
-          play_buffer(primary, buffer, len, channels, sample_rate, bps);
-        }
-      break;
-    default:
-      break;
-  }
+  play_sound (ps, sound);
 }
 
 void AudioOutputCore::on_set_device (const AudioOutputDevice & device)
@@ -556,6 +876,17 @@ void AudioOutputCore::on_device_opened (AudioOutputPS ps,
                                         AudioOutputSettings settings,
                                         AudioOutputManager *manager)
 {
+  // Devices without a mixer get their volume applied in software
+  if (ps == primary) {
+
+    use_software_volume = !settings.modifyable;
+    if (use_software_volume) {
+
+      settings.modifyable = true;
+      settings.volume = software_volume;
+    }
+  }
+
   device_opened (*manager, ps, device, settings);
 }
 
@@ -571,11 +902,15 @@ void AudioOutputCore::on_device_error (AudioOutputPS ps, AudioOutputDevice devic
 
 void AudioOutputCore::internal_set_primary_device(const AudioOutputDevice & device)
 {
+  internal_stop_sound (primary);
+
   if (current_primary_config.active)
      internal_close(primary);
 
   if (device == current_device[secondary]) {
 
+    internal_stop_sound (secondary);
+
     current_manager[secondary] = NULL;
     current_device[secondary].type = "";
     current_device[secondary].source = "";
@@ -661,41 +996,70 @@ void AudioOutputCore::internal_close(AudioOutputPS ps)
     current_manager[ps]->close(ps);
 }
 
-void AudioOutputCore::internal_play(AudioOutputPS ps, const char* buffer, unsigned long len, unsigned channels, unsigned sample_rate, unsigned bps)
+void AudioOutputCore::internal_play(AudioOutputPS ps, AudioSoundPtr sound)
 {
   unsigned long pos = 0;
+  unsigned long len = sound->data.size ();
   unsigned bytes_written = 0;
-  unsigned buffer_size = (unsigned)((float)sample_rate/25);
+  unsigned buffer_size = (unsigned)((float)sound->sample_rate/25);
 
-  if (!internal_open ( ps, channels, sample_rate, bps))
-    return;
+  {
+    PWaitAndSignal m(core_mutex[ps]);
+
+    if (ps == secondary && !current_manager[secondary]) {
+
+      PTRACE(1, "AudioOutputCore\tNo secondary audiooutput device defined, trying primary");
+      event_player[primary]->enqueue (sound);
+      return;
+    }
+
+    if (!current_manager[ps]) {
+      PTRACE(1, "AudioOutputCore\tDropping sound event, manager not set for device[" << ps << "]");
+      return;
+    }
+
+    if (ps == primary && current_primary_config.active) {
+      PTRACE(1, "AudioOutputCore\tDropping sound event, primary device in use");
+      return;
+    }
+
+    if (!internal_open (ps, sound->channels, sound->sample_rate, sound->bps))
+      return;
 
-  if (current_manager[ps]) {
     current_manager[ps]->set_buffer_size (ps, buffer_size, 4);
-    do {
-      if (!current_manager[ps]->set_frame_data(ps, buffer+pos, std::min(buffer_size, (unsigned) (len - pos)), bytes_written))
-        break;
-      pos += buffer_size;
-    } while (pos < len);
+    sound_playing[ps] = true;
   }
 
-  internal_close( ps);
+  // The lock is only held for each chunk, so that the other
+  // users of the device never wait for more than one chunk
+  while (pos < len) {
+
+    PWaitAndSignal m(core_mutex[ps]);
+
+    if (!sound_playing[ps] || !current_manager[ps]) {
+      PTRACE(4, "AudioOutputCore\tSound event on device[" << ps << "] cut short");
+      return;
+    }
+
+    if (!current_manager[ps]->set_frame_data(ps, &sound->data[pos], std::min(buffer_size, (unsigned) (len - pos)), bytes_written))
+      break;
+    pos += buffer_size;
+  }
+
+  PWaitAndSignal m(core_mutex[ps]);
+  internal_stop_sound (ps);
 }
 
-void AudioOutputCore::calculate_average_level (const short *buffer, unsigned size)
+void AudioOutputCore::internal_stop_sound (AudioOutputPS ps)
 {
-  int sum = 0;
-  unsigned csize = 0;
-  
-  while (csize < (size>>1) ) {
+  if (sound_playing[ps]) {
 
-    if (*buffer < 0)
-      sum -= *buffer++;
-    else
-      sum += *buffer++;
-
-    csize++;
+    internal_close (ps);
+    sound_playing[ps] = false;
   }
-	  
-  average_level = log10 (9.0*sum/size/32767+1)*1.0;
+}
+
+void AudioOutputCore::calculate_average_level (const short *buffer, unsigned size)
+{
+  average_level = AudioDSP::average_level (buffer, size);
 }
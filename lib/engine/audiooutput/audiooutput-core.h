@@ -43,7 +43,9 @@
 
 #include "audiooutput-manager.h"
 #include "audiooutput-scheduler.h"
+#include "lockfree-ring.h"
 
+#include <deque>
 #include <ptlib.h>
 #include <gio/gio.h>
 
@@ -95,7 +97,16 @@ namespace Ekiga
    * back due to a removed device, and the respective device is re-added to the system,
    * it will be automatically activated.
    *
-
+   * In the threaded playout mode (see set_threaded_playout()), set_frame_data()
+   * only pushes the buffer into a preallocated lock-free ring buffer, which is
+   * drained into the primary device by a dedicated thread (represented by the
+   * AudioPlayoutManager). The ring absorbs the jitter between the decoder and
+   * the device : its target fill grows on underruns and shrinks back while the
+   * playout is stable. While the ring is above its target fill,
+   * set_frame_data() waits for the playout thread to take a frame, so the
+   * audio streaming thread is still paced by the device, but only for a
+   * bounded time : a stalled device makes it drop frames instead of
+   * blocking.
    */
   class AudioOutputCore
     : public Service
@@ -249,8 +260,19 @@ namespace Ekiga
        */
       void stop_play_event (const std::string & event_name);
 
-      /** Play a sound event buffer
+      /** Play a decoded sound
        * This function is called by the Scheduler in order to play an already loaded sound.
+       * It only queues the sound for the worker thread of the device and returns immediately.
+       * Sounds for the secondary device are played on the primary device if there is no
+       * secondary device. Sounds for the primary device are dropped while the audio output
+       * is started, and a sound being played is cut short when it gets started.
+       * @param ps whether to play the sound on the primary or secondary device.
+       * @param sound the sound, which must not be modified afterwards.
+       */
+      void play_sound (AudioOutputPS ps, AudioSoundPtr sound);
+
+      /** Play a sound event buffer
+       * Same as play_sound(), but the buffer is copied first.
        * @param ps whether to play the sound on the primary or secondary device.
        * @param buffer pointer to the sound in raw format.
        * @param len the length in bytes of the sound.
@@ -295,6 +317,31 @@ namespace Ekiga
        */
       void set_frame_data (const char *data, unsigned size, unsigned & bytes_written);
 
+      /** Turn the threaded playout mode on and off
+       * In threaded playout mode, set_frame_data() only queues the buffer
+       * in a lock-free ring buffer, which is written to the primary device
+       * by a dedicated thread. It waits, for about a frame at most, while
+       * the ring is above its target fill. If the ring runs dry, the device gets silence
+       * and the ring fills up to a higher target before playing again.
+       * Will be applied the next time the audio output is started.
+       * @param on_off whether to turn the threaded playout on or off.
+       */
+      void set_threaded_playout (bool on_off);
+
+      /** Get the threaded playout statistics
+       * The counters are reset each time the audio output is started.
+       * @param played the number of frames written to the device.
+       * @param underruns the number of frames which had to be completed with silence.
+       * @param overruns the number of frames dropped because the ring was too full.
+       * @param target the current target fill of the ring, in ms.
+       * @param depth the current fill of the ring, in ms.
+       */
+      void get_playout_statistics (unsigned & played,
+                                   unsigned & underruns,
+                                   unsigned & overruns,
+                                   unsigned & target,
+                                   unsigned & depth) const;
+
      /** Set the volume of the next opportunity
        * Sets the volume to the specified value the next time
        * get_frame_data() is called.
@@ -340,6 +387,93 @@ namespace Ekiga
       boost::signals2::signal<void(AudioOutputDevice, bool)> device_removed;
 
   private:
+      /** AudioPlayoutManager thread.
+        *
+        * AudioPlayoutManager represents a thread that drains the playout
+        * ring of the audio output core into the primary device. It only
+        * runs while the audio output is started in threaded playout mode.
+        */
+      class AudioPlayoutManager : public PThread
+      {
+        PCLASSINFO(AudioPlayoutManager, PThread);
+
+      public:
+        /** The constructor
+        * @param _audio_output_core reference to the audio output core.
+        */
+        AudioPlayoutManager (AudioOutputCore & _audio_output_core);
+
+        void quit ();
+
+        /** Start the playout.
+        * Requires the primary device to be opened and the ring to be allocated.
+        * @param _frame_size the number of bytes written to the device at once.
+        */
+        void start (unsigned _frame_size);
+
+        /** Stop the playout.
+        * Blocks until the frame being written (if any) has been written.
+        * MUST NOT be called with the core_mutex held.
+        */
+        void stop ();
+
+      protected:
+        void Main ();
+
+        bool end_thread;
+        bool pause_thread;
+
+        PMutex thread_ended;
+        PMutex playout_mutex;
+        PSyncPoint run_thread;
+        PSyncPoint thread_created;
+
+        AudioOutputCore & audio_output_core;
+        char* frame;
+        unsigned frame_size;
+      };
+
+      /** AudioEventPlayer thread.
+        *
+        * AudioEventPlayer represents a thread that plays the queued sounds
+        * on one of the devices, so that the primary and secondary devices
+        * are fed independently, and that queuing a sound never blocks.
+        */
+      class AudioEventPlayer : public PThread
+      {
+        PCLASSINFO(AudioEventPlayer, PThread);
+
+      public:
+        /** The constructor
+        * @param _audio_output_core reference to the audio output core.
+        * @param _ps the device the sounds are played on.
+        */
+        AudioEventPlayer (AudioOutputCore & _audio_output_core,
+                          AudioOutputPS _ps);
+
+        void quit ();
+
+        /** Queue a sound.
+        * If too many sounds are pending, the oldest one is dropped.
+        * @param sound the sound to play.
+        */
+        void enqueue (AudioSoundPtr sound);
+
+      protected:
+        void Main ();
+
+        bool end_thread;
+
+        PMutex thread_ended;
+        PMutex queue_mutex;
+        PSyncPoint run_thread;
+        PSyncPoint thread_created;
+
+        AudioOutputCore & audio_output_core;
+        AudioOutputPS ps;
+        std::deque<AudioSoundPtr> queue;
+      };
+
       void on_set_device (const AudioOutputDevice & device);
       void on_device_opened (AudioOutputPS ps,
                              AudioOutputDevice device,
@@ -355,8 +489,11 @@ namespace Ekiga
       bool internal_open (AudioOutputPS ps, unsigned channels, unsigned samplerate,
                           unsigned bits_per_sample);
       void internal_close(AudioOutputPS ps);
-      void internal_play(AudioOutputPS ps, const char* buffer, unsigned long len,
-                         unsigned channels, unsigned sample_rate, unsigned bps);
+      void internal_play(AudioOutputPS ps, AudioSoundPtr sound);
+      void internal_stop_sound (AudioOutputPS ps);
+      void internal_set_frame_data (const char *data, unsigned size, unsigned & bytes_written);
+
+      void playout_frame (char *data, unsigned size);
 
       void calculate_average_level (const short *buffer, unsigned size);
 
@@ -378,11 +515,30 @@ namespace Ekiga
       AudioOutputDevice current_device[2];
       unsigned desired_primary_volume;
       unsigned current_primary_volume;
+      bool use_software_volume;
+      unsigned software_volume;
+      std::vector<char> software_volume_buffer;
 
       PMutex core_mutex[2];
       PMutex volume_mutex;
 
       AudioEventScheduler* audio_event_scheduler;
+      AudioEventPlayer* event_player[2];
+      bool sound_playing[2]; // protected by core_mutex[ps]
+
+      AudioPlayoutManager* playout_manager;
+      LockFreeRing playout_ring;
+      PSyncPoint playout_ready;
+      PSyncPoint playout_drained;
+      bool threaded_playout;
+      volatile gint playout_active;
+      volatile gint played_frames;
+      volatile gint playout_underruns;
+      volatile gint playout_overruns;
+      volatile gint playout_target;   // in bytes
+      unsigned playout_frame_size;    // bytes in 20 ms
+      unsigned playout_stable_frames; // frames played since the last underrun
+      bool playout_buffering;
 
       float average_level;
       bool calculate_average;
@@ -36,11 +36,21 @@
 
 #include "audiooutput-scheduler.h"
 #include "audiooutput-core.h"
+#include "audio-dsp.h"
 #include "config.h"
 #ifdef WIN32
 #include "platform/winpaths.h"
 #endif
 
+#include <algorithm>
+#include <sys/stat.h>
+#include <glib/gstdio.h>
+
+/* The number of decoded sounds kept in memory : there are only a handful
+ * of event sounds, but the preferences also play arbitrary files
+ */
+#define AUDIO_SOUND_CACHE_SIZE 16
+
 using namespace Ekiga;
 
 AudioEventScheduler::AudioEventScheduler (AudioOutputCore& _audio_output_core)
@@ -69,10 +79,7 @@ void AudioEventScheduler::Main ()
 
   std::vector <AudioEvent> pending_event_list;
   unsigned idle_time = 65535;
-  AudioEvent event;
-  char* buffer = NULL;
-  unsigned long buffer_len = 0;
-  unsigned channels, sample_rate, bps;
+  AudioSoundPtr sound;
   AudioOutputPS ps;
 
   thread_created.Signal ();
@@ -90,76 +97,149 @@ void AudioEventScheduler::Main ()
     get_pending_event_list(pending_event_list);
     PTRACE(4, "AEScheduler\tChecking pending list with " << pending_event_list.size() << " elements");
 
-    while (pending_event_list.size() > 0) {
-      event = *(pending_event_list.begin()); pending_event_list.erase(pending_event_list.begin());
-      load_wav(event.name, event.is_file_name, buffer, buffer_len, channels, sample_rate, bps, ps);
-      if (buffer) {
-         audio_output_core.play_buffer (ps, buffer, buffer_len, channels, sample_rate, bps);
-        free (buffer);
-        buffer = NULL;
-      }
-      Current()->Sleep (10);
+    // Events falling due together are played together on each device
+    std::vector<AudioSoundPtr> sounds[2];
+
+    for (std::vector<AudioEvent>::iterator iter = pending_event_list.begin ();
+         iter != pending_event_list.end ();
+         iter++) {
+
+      sound = load_wav(iter->name, iter->is_file_name, ps);
+      if (sound)
+        sounds[ps].push_back (sound);
     }
+    pending_event_list.clear ();
+    sound.reset ();
+
+    play_sounds (primary, sounds[primary]);
+    play_sounds (secondary, sounds[secondary]);
+
     idle_time = get_time_to_next_event();
   }
 }
 
+void AudioEventScheduler::play_sounds (AudioOutputPS ps, const std::vector<AudioSoundPtr> & sounds)
+{
+  std::vector<AudioSoundPtr> mixed;
+  std::vector<AudioSoundPtr> others;
+  unsigned long len = 0;
+
+  if (sounds.empty ())
+    return;
+
+  // Only 16 bit sounds sharing the format of the first one can be mixed
+  const AudioSound & first = *sounds.front ();
+
+  for (std::vector<AudioSoundPtr>::const_iterator iter = sounds.begin ();
+       iter != sounds.end ();
+       iter++) {
+
+    const AudioSound & sound = **iter;
+
+    if (mixed.empty ()
+        || (first.bps == 16 && sound.bps == 16
+            && sound.channels == first.channels
+            && sound.sample_rate == first.sample_rate)) {
+
+      mixed.push_back (*iter);
+      len = std::max (len, (unsigned long) sound.data.size ());
+    }
+    else
+      others.push_back (*iter);
+  }
+
+  if (mixed.size () == 1) {
+
+    audio_output_core.play_sound (ps, mixed.front ());
+  }
+  else {
+
+    // The cached sounds are shared with the output, so mix into a new one
+    AudioSoundPtr mix (new AudioSound);
+
+    PTRACE(4, "AEScheduler\tMixing " << mixed.size () << " sounds");
+    mix->mtime = 0;
+    mix->channels = first.channels;
+    mix->sample_rate = first.sample_rate;
+    mix->bps = first.bps;
+    mix->data.assign (len, 0);
+    for (std::vector<AudioSoundPtr>::iterator iter = mixed.begin ();
+         iter != mixed.end ();
+         iter++)
+      AudioDSP::mix ((gint16*) &mix->data[0], (const gint16*) &(*iter)->data[0],
+                     (*iter)->data.size () >> 1);
+
+    audio_output_core.play_sound (ps, mix);
+  }
+
+  for (std::vector<AudioSoundPtr>::iterator iter = others.begin ();
+       iter != others.end ();
+       iter++)
+    audio_output_core.play_sound (ps, *iter);
+}
+
 void AudioEventScheduler::get_pending_event_list (std::vector<AudioEvent> & pending_event_list)
 {
   PWaitAndSignal m(event_list_mutex);
 
-  AudioEvent event;
-  std::vector <AudioEvent> new_event_list;
-  unsigned long time = get_time_ms();
+  PInt64 time = get_time_ms();
 
   pending_event_list.clear();
 
-  while (event_list.size() > 0) {
+  while (!event_queue.empty () && event_queue.begin ()->first <= time) {
 
-    event = *(event_list.begin()); event_list.erase(event_list.begin());
+    AudioEventQueue::iterator iter = event_queue.begin ();
+    AudioEvent event = iter->second;
+    std::multimap<std::string, AudioEventQueue::iterator>::iterator index;
 
-    if (event.interval == 0) {
-      pending_event_list.push_back(event);
-    }
-    else {
-      if (event.time <= time) {
-        pending_event_list.push_back(event);
-        event.repetitions--; 
-        if (event.repetitions > 0) {
+    for (index = event_index.lower_bound (event.name);
+         index->second != iter;
+         index++);
+    event_index.erase (index);
+    event_queue.erase (iter);
+
+    pending_event_list.push_back(event);
+
+    if (event.interval > 0) {
+
+      event.repetitions--;
+      if (event.repetitions > 0) {
+
+        // Keep the cadence exact, unless we are already late
+        event.time += event.interval;
+        if (event.time <= time)
           event.time = time + event.interval;
-          new_event_list.push_back(event);
-        }
-      }
-      else {
-        new_event_list.push_back(event);
+        schedule_event (event);
       }
     }
   }
-
-  event_list = new_event_list;
 }
 
-unsigned long AudioEventScheduler::get_time_ms()
+PInt64 AudioEventScheduler::get_time_ms()
 {
-  GTimeVal time_val;
-  g_get_current_time(&time_val);
-  return (time_val.tv_sec * 1000 + (unsigned long) (time_val.tv_usec / 1000) );
+  // PTimer::Tick is monotonic, unlike the wall-clock
+  return PTimer::Tick ().GetMilliSeconds ();
 }
 
 unsigned AudioEventScheduler::get_time_to_next_event()
 {
   PWaitAndSignal m(event_list_mutex);
-  unsigned long time = get_time_ms();
-  unsigned min_time = 65535;
+  PInt64 time = get_time_ms();
 
-  for (std::vector<AudioEvent>::iterator iter = event_list.begin ();
-       iter !=event_list.end ();
-       iter++) {
+  if (event_queue.empty ())
+    return 65535; // wait until an event is added
 
-    if ( (iter->interval > 0) && ((iter->time - time) < min_time) )
-      min_time = iter->time - time;
-  }
-  return min_time;
+  if (event_queue.begin ()->first <= time)
+    return 0;
+
+  // Events further away are waited for in several steps
+  return (unsigned) std::min (event_queue.begin ()->first - time, (PInt64) 65534);
+}
+
+void AudioEventScheduler::schedule_event(const AudioEvent & event)
+{
+  AudioEventQueue::iterator iter = event_queue.insert (std::make_pair (event.time, event));
+  event_index.insert (std::make_pair (event.name, iter));
 }
 
 void AudioEventScheduler::add_event_to_queue(const std::string & name, bool is_file_name, unsigned interval, unsigned repetitions)
@@ -172,7 +252,7 @@ void AudioEventScheduler::add_event_to_queue(const std::string & name, bool is_f
   event.interval = interval;
   event.repetitions = repetitions;
   event.time = get_time_ms();
-  event_list.push_back(event);
+  schedule_event(event);
   run_thread.Signal();
 }
 
@@ -181,32 +261,21 @@ void AudioEventScheduler::remove_event_from_queue(const std::string & name)
   PTRACE(4, "AEScheduler\tRemoving Event " << name << " from queue");
   PWaitAndSignal m(event_list_mutex);
 
-  bool found = false;
-  std::vector<AudioEvent>::iterator iter;
-
-  for (iter = event_list.begin ();
-       iter != event_list.end () ;
-       iter++) {
+  std::pair<std::multimap<std::string, AudioEventQueue::iterator>::iterator,
+            std::multimap<std::string, AudioEventQueue::iterator>::iterator> range = event_index.equal_range (name);
 
-      if ( (iter->name == name) ) { 
-        found = true;
-        break;
-      }
-  }
+  for (std::multimap<std::string, AudioEventQueue::iterator>::iterator iter = range.first;
+       iter != range.second;
+       iter++)
+    event_queue.erase (iter->second);
 
-  if (found) {
-    event_list.erase(iter);
-  }
+  event_index.erase (range.first, range.second);
 }
 
-void AudioEventScheduler::load_wav(const std::string & event_name, bool is_file_name, char* & buffer, unsigned long & len, unsigned & channels, unsigned & sample_rate, unsigned & bps, AudioOutputPS & ps)
+AudioSoundPtr AudioEventScheduler::load_wav(const std::string & event_name, bool is_file_name, AudioOutputPS & ps)
 {
-  PWAVFile* wav = NULL;
   std::string file_name;
 
-  len = 0;
-  buffer = NULL;
-
   // Shall we also try event name as file name?
   if (is_file_name) {
     file_name = event_name;
@@ -214,36 +283,77 @@ void AudioEventScheduler::load_wav(const std::string & event_name, bool is_file_
   }
   else 
     if (!get_file_name(event_name, file_name, ps)) // if this event is disabled
-      return;
+      return AudioSoundPtr ();
+
+  PTRACE(4, "AEScheduler\tLoading " << file_name << " for event " << event_name);
+  return get_sound (file_name);
+}
+
+AudioSoundPtr AudioEventScheduler::get_sound(const std::string & file_name)
+{
+  std::map<std::string, AudioSoundPtr>::iterator iter = sound_cache.find (file_name);
+  AudioSoundPtr sound;
+
+  if (iter != sound_cache.end ()) {
+
+    struct stat info;
 
-  PTRACE(4, "AEScheduler\tTrying to load " << file_name << " for event " << event_name);
-  wav = new PWAVFile (file_name.c_str(), PFile::ReadOnly);
+    // The file is only read again when it was modified
+    if (g_stat (iter->second->path.c_str (), &info) == 0
+        && info.st_mtime == iter->second->mtime)
+      return iter->second;
 
-  if (!wav->IsValid ()) {
+    sound_cache.erase (iter);
+  }
+
+  sound = decode_wav (file_name);
+
+  if (!sound) {
      /* it isn't a full path to a file : add our default path */
  
-    delete wav;
-    wav = NULL;
- 
     gchar* filename = g_build_filename (DATA_DIR, "sounds", PACKAGE_NAME, file_name.c_str(), NULL);
-    PTRACE(4, "AEScheduler\tTrying to load " << filename << " for event " << event_name);
-
-    wav = new PWAVFile (filename, PFile::ReadOnly);
+    sound = decode_wav (filename);
     g_free (filename);
   }
-  
-  if (wav->IsValid ()) {
-    len = wav->GetDataLength();
-    channels = wav->GetChannels ();
-    sample_rate = wav->GetSampleRate ();
-    bps = wav->GetSampleSize ();
-
-    buffer = (char*) malloc (len);
-    memset(buffer, 127, len);
-    wav->Read(buffer, len);
+
+  if (sound) {
+
+    if (sound_cache.size () >= AUDIO_SOUND_CACHE_SIZE)
+      sound_cache.clear ();
+    sound_cache[file_name] = sound;
   }
 
-  delete wav;
+  return sound;
+}
+
+AudioSoundPtr AudioEventScheduler::decode_wav(const std::string & path)
+{
+  struct stat info;
+
+  if (g_stat (path.c_str (), &info) != 0)
+    return AudioSoundPtr ();
+
+  PTRACE(4, "AEScheduler\tTrying to load " << path);
+  PWAVFile wav (path.c_str (), PFile::ReadOnly);
+
+  if (!wav.IsValid () || wav.GetDataLength () <= 0)
+    return AudioSoundPtr ();
+
+  AudioSoundPtr sound (new AudioSound);
+  sound->path = path;
+  sound->mtime = info.st_mtime;
+  sound->channels = wav.GetChannels ();
+  sound->sample_rate = wav.GetSampleRate ();
+  sound->bps = wav.GetSampleSize ();
+  sound->data.resize (wav.GetDataLength ());
+
+  if (!wav.Read (&sound->data[0], sound->data.size ())
+      || wav.GetLastReadCount () <= 0)
+    return AudioSoundPtr ();
+
+  sound->data.resize (wav.GetLastReadCount ());
+
+  return sound;
 }
 
 
@@ -43,6 +43,8 @@
 
 #include <glib.h>
 #include <vector>
+#include <map>
+#include <boost/shared_ptr.hpp>
 #include <ptlib.h>
 #include <ptclib/pwavfile.h>
 
@@ -55,9 +57,24 @@ namespace Ekiga
     bool is_file_name;
     unsigned interval;
     unsigned repetitions;
-    unsigned long time;
+    PInt64 time;
   } AudioEvent;
 
+  /* The queued events, sorted by the time they are due */
+  typedef std::multimap<PInt64, AudioEvent> AudioEventQueue;
+
+  /* A decoded sound, as kept in the scheduler cache */
+  typedef struct AudioSound {
+    std::string path;
+    time_t mtime;
+    std::vector<char> data;
+    unsigned channels;
+    unsigned sample_rate;
+    unsigned bps;
+  } AudioSound;
+
+  typedef boost::shared_ptr<AudioSound> AudioSoundPtr;
+
   typedef struct EventFileName {
     std::string event_name;
     std::string file_name;
@@ -79,10 +96,14 @@ namespace Ekiga
   protected:
     void Main (void);
     void get_pending_event_list (std::vector<AudioEvent> & pending_event_list);
-    unsigned long get_time_ms();
+    PInt64 get_time_ms();
+    void schedule_event(const AudioEvent & event);
     unsigned get_time_to_next_event();
     bool get_file_name(const std::string & event_name, std::string & file_name, AudioOutputPS & ps);
-    void load_wav(const std::string & event_name, bool is_file_name, char* & buffer, unsigned long & len, unsigned & channels, unsigned & sample_rate, unsigned & bps, AudioOutputPS & ps);
+    AudioSoundPtr load_wav(const std::string & event_name, bool is_file_name, AudioOutputPS & ps);
+    AudioSoundPtr get_sound(const std::string & file_name);
+    AudioSoundPtr decode_wav(const std::string & path);
+    void play_sounds(AudioOutputPS ps, const std::vector<AudioSoundPtr> & sounds);
 
     PSyncPoint run_thread;
     bool end_thread;
@@ -91,11 +112,15 @@ namespace Ekiga
     PSyncPoint thread_created;
 
     PMutex event_list_mutex;
-    std::vector <AudioEvent> event_list;
+    AudioEventQueue event_queue;
+    std::multimap<std::string, AudioEventQueue::iterator> event_index;
 
     PMutex event_file_list_mutex;
     std::vector <EventFileName> event_file_list;
 
+    /* Only used from the scheduler thread, so it needs no lock */
+    std::map<std::string, AudioSoundPtr> sound_cache;
+
     Ekiga::AudioOutputCore& audio_output_core;
   };
 };
@@ -86,6 +86,22 @@ namespace Ekiga {
      */
     virtual void visit_messages (boost::function1<bool, const Message&>) const = 0;
 
+    /* Conversations don't keep all their messages in memory : the ones
+     * visit_messages lists are only the latest, and this tells how many
+     * were before them.
+     */
+    virtual unsigned int get_older_messages_count () const
+    { return 0; }
+
+    /* Lists the messages numbered [first, first + count) from the start of
+     * the conversation, even those which aren't in memory anymore, so a
+     * view can show them when the user scrolls back
+     */
+    virtual void visit_messages_range (unsigned int /*first*/,
+				       unsigned int /*count*/,
+				       boost::function1<bool, const Message&> /*visitor*/) const
+    {}
+
     /* Send a message through this conversation
      * @param: the message to send
      * @return: whether we could send
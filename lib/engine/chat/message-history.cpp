@@ -0,0 +1,186 @@
+/*
+ * Ekiga -- A VoIP and Video-Conferencing application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+/*
+ *                         message-history.cpp  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014
+ *   description          : implementation of a bounded store for the
+ *                          messages of a conversation
+ *
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <unistd.h>
+
+#include "message-history.h"
+#include "tab-separated.h"
+
+/* The log has a record per message : the time, the name, then the
+ * payload as type/content pairs.
+ */
+
+
+Ekiga::MessageHistory::MessageHistory (unsigned int max_in_memory_):
+  max_in_memory(max_in_memory_), older(0), log_failed(false), log(NULL)
+{
+}
+
+Ekiga::MessageHistory::~MessageHistory ()
+{
+  if (log != NULL) {
+
+    fclose (log);
+    if ( !log_path.empty ())
+      g_unlink (log_path.c_str ());
+  }
+}
+
+void
+Ekiga::MessageHistory::push_back (const Message& message)
+{
+  write_to_log (message);
+
+  latest.push_back (message);
+  while (latest.size () > max_in_memory) {
+
+    latest.pop_front ();
+    older++;
+  }
+}
+
+void
+Ekiga::MessageHistory::visit (boost::function1<bool, const Message&> visitor) const
+{
+  for (std::deque<Message>::const_iterator iter = latest.begin ();
+       iter != latest.end ();
+       ++iter)
+    if ( !visitor (*iter))
+      break;
+}
+
+void
+Ekiga::MessageHistory::visit_range (unsigned int first,
+				    unsigned int count,
+				    boost::function1<bool, const Message&> visitor) const
+{
+  bool go_on = true;
+
+  for (unsigned int index = first;
+       go_on && index < first + count && index < size ();
+       ++index) {
+
+    if (index >= older)
+      go_on = visitor (latest[index - older]);
+    else
+      go_on = read_from_log (index, visitor);
+  }
+}
+
+bool
+Ekiga::MessageHistory::open_log ()
+{
+  gchar* dir = NULL;
+  gchar* path = NULL;
+  int fd = -1;
+
+  dir = g_build_filename (g_get_user_cache_dir (), PACKAGE_NAME, "chats", NULL);
+  path = g_build_filename (dir, "conversation-XXXXXX", NULL);
+
+  if (g_mkdir_with_parents (dir, 0700) == 0)
+    fd = g_mkstemp (path);
+  if (fd != -1) {
+
+    log = fdopen (fd, "w+b");
+    if (log == NULL)
+      close (fd);
+
+    /* only we use the file : once it has no name, it goes away with the
+     * descriptor, even if we crash -- where an open file can't be
+     * removed, it will only be when we're done with it
+     */
+    if (g_unlink (path) != 0 && log != NULL)
+      log_path = path;
+  }
+
+  g_free (path);
+  g_free (dir);
+
+  return log != NULL;
+}
+
+void
+Ekiga::MessageHistory::write_to_log (const Message& message)
+{
+  std::string line;
+
+  if (log == NULL && (log_failed || !open_log ())) {
+
+    log_failed = true;
+    return;
+  }
+
+  line = tab_separated_escape (message.time) + "\t" + tab_separated_escape (message.name);
+  for (Message::payload_type::const_iterator iter = message.payload.begin ();
+       iter != message.payload.end ();
+       ++iter)
+    line += "\t" + tab_separated_escape (iter->first) + "\t" + tab_separated_escape (iter->second);
+  line += "\n";
+
+  /* reading moves around, so go back to the end first */
+  fseek (log, 0, SEEK_END);
+  offsets.push_back (ftell (log));
+  fwrite (line.c_str (), 1, line.size (), log);
+}
+
+bool
+Ekiga::MessageHistory::read_from_log (unsigned int index,
+				      boost::function1<bool, const Message&> visitor) const
+{
+  std::string line;
+
+  /* the log may have failed after the first messages */
+  if (log == NULL || index >= offsets.size ())
+    return true;
+
+  if (fseek (log, offsets[index], SEEK_SET) != 0
+      || !tab_separated_read_line (log, line))
+    return true;
+
+  std::vector<std::string> fields = tab_separated_split (line);
+  if (fields.size () < 2)
+    return true;
+
+  Message::payload_type payload;
+  for (unsigned int ii = 2; ii + 1 < fields.size (); ii += 2)
+    payload.insert (std::make_pair (fields[ii], fields[ii + 1]));
+
+  Message message = { fields[0], fields[1], payload };
+
+  return visitor (message);
+}
@@ -0,0 +1,109 @@
+/*
+ * Ekiga -- A VoIP and Video-Conferencing application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+/*
+ *                         message-history.h  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014
+ *   description          : declaration of a bounded store for the messages
+ *                          of a conversation
+ *
+ */
+
+#ifndef __MESSAGE_HISTORY_H__
+#define __MESSAGE_HISTORY_H__
+
+#include <stdio.h>
+
+#include <deque>
+#include <vector>
+
+#include "conversation.h"
+
+namespace Ekiga
+{
+
+  /* This keeps the messages of a conversation, without letting a
+   * conversation which lasts for weeks eat all the memory : only the
+   * latest messages are kept in memory, and all of them are also written
+   * to an append-only log in the cache directory, from which the older
+   * ones are read back when they're asked for.
+   *
+   * Messages are numbered from the start of the conversation, so a view
+   * can ask for the ones before those it already shows.
+   */
+  class MessageHistory
+  {
+  public:
+
+    MessageHistory (unsigned int max_in_memory = 250);
+
+    ~MessageHistory ();
+
+    void push_back (const Message& message);
+
+    /* how many messages there were in all */
+    unsigned int size () const
+    { return older + latest.size (); }
+
+    /* how many of those are too old to be kept in memory */
+    unsigned int get_older_count () const
+    { return older; }
+
+    /* visits the messages kept in memory */
+    void visit (boost::function1<bool, const Message&> visitor) const;
+
+    /* visits the messages numbered in [first, first + count), reading
+     * them from the log if needed
+     */
+    void visit_range (unsigned int first,
+		      unsigned int count,
+		      boost::function1<bool, const Message&> visitor) const;
+
+  private:
+
+    MessageHistory (const MessageHistory&);
+    MessageHistory& operator= (const MessageHistory&);
+
+    bool open_log ();
+    void write_to_log (const Message& message);
+    bool read_from_log (unsigned int index,
+			boost::function1<bool, const Message&> visitor) const;
+
+    unsigned int max_in_memory;
+    unsigned int older;
+    std::deque<Message> latest;
+
+    /* the log is opened on the first message, and if that fails, the
+     * messages which don't fit in memory anymore are simply lost
+     */
+    bool log_failed;
+    FILE* log;
+    std::string log_path; // if it couldn't be removed while open
+    std::vector<long> offsets;
+  };
+};
+
+#endif
@@ -35,46 +35,26 @@
 
 #include "history-book.h"
 
+#include <stdlib.h>
+
+#include <libxml/parser.h>
 #include <glib/gi18n.h>
 
+/* this key used to hold the whole history as xml : it is only read to
+ * import what older versions saved there
+ */
 #define CALL_HISTORY_KEY "call-history"
+#define CALL_HISTORY_SIZE_KEY "call-history-size"
 
 History::Book::Book (Ekiga::ServiceCore& core):
-  contact_core(core.get<Ekiga::ContactCore>("contact-core")), doc()
+  contact_core(core.get<Ekiga::ContactCore>("contact-core")), first_number(0)
 {
-  xmlNodePtr root = NULL;
-
   contacts_settings = boost::shared_ptr<Ekiga::Settings> (new Ekiga::Settings (CONTACTS_SCHEMA));
-  std::string raw = contacts_settings->get_string (CALL_HISTORY_KEY);
-
-  if (!raw.empty ()) {
-
-    doc = boost::shared_ptr<xmlDoc> (xmlRecoverMemory (raw.c_str (), raw.length ()), xmlFreeDoc);
-    if ( !doc)
-      doc = boost::shared_ptr<xmlDoc> (xmlNewDoc (BAD_CAST "1.0"), xmlFreeDoc);
-
-    root = xmlDocGetRootElement (doc.get ());
-    if (root == NULL) {
-
-      root = xmlNewDocNode (doc.get (), NULL, BAD_CAST "list", NULL);
-      xmlDocSetRootElement (doc.get (), root);
-    }
+  max_size = contacts_settings->get_int (CALL_HISTORY_SIZE_KEY);
+  connections.add (contacts_settings->changed.connect (boost::bind (&History::Book::on_contacts_settings_changed, this, _1)));
 
-    for (xmlNodePtr child = root->children;
-	 child != NULL;
-	 child = child->next)
-      if (child->type == XML_ELEMENT_NODE
-	  && child->name != NULL
-	  && xmlStrEqual (BAD_CAST ("entry"), child->name))
-        add (child);
-
-  }
-  else {
-
-    doc = boost::shared_ptr<xmlDoc> (xmlNewDoc (BAD_CAST "1.0"), xmlFreeDoc);
-    root = xmlNewDocNode (doc.get (), NULL, BAD_CAST "list", NULL);
-    xmlDocSetRootElement (doc.get (), root);
-  }
+  store.load (boost::bind (&History::Book::push_entry, this, _1));
+  import_settings ();
 
   boost::shared_ptr<Ekiga::CallCore> call_core = core.get<Ekiga::CallCore> ("call-core");
 
@@ -97,17 +77,53 @@ History::Book::get_name () const
 void
 History::Book::visit_contacts (boost::function1<bool, Ekiga::ContactPtr> visitor) const
 {
-  for (std::list<ContactPtr>::const_iterator iter = ordered_contacts.begin ();
-       iter != ordered_contacts.end();
+  bool go_on = true;
+
+  for (unsigned int position = 0;
+       go_on && position < entries.size ();
+       ++position)
+    go_on = visitor (get_contact (position));
+}
+
+void
+History::Book::visit_latest_contacts (unsigned int skip,
+				      unsigned int count,
+				      boost::function1<bool, ContactPtr> visitor) const
+{
+  bool go_on = true;
+
+  for (unsigned int ii = skip;
+       go_on && ii < skip + count && ii < entries.size ();
+       ++ii)
+    go_on = visitor (get_contact (entries.size () - 1 - ii));
+}
+
+void
+History::Book::visit_contacts_with_uri (const std::string uri,
+					boost::function1<bool, ContactPtr> visitor) const
+{
+  bool go_on = true;
+  std::pair<std::multimap<std::string, unsigned long>::const_iterator,
+	    std::multimap<std::string, unsigned long>::const_iterator> range
+    = uri_index.equal_range (uri);
+
+  for (std::multimap<std::string, unsigned long>::const_iterator iter = range.first;
+       go_on && iter != range.second;
        ++iter)
-    visitor (*iter);
+    go_on = visitor (get_contact (iter->second - first_number));
 }
 
 void
-History::Book::add (xmlNodePtr node)
+History::Book::visit_contacts_between (time_t from,
+				       time_t to,
+				       boost::function1<bool, ContactPtr> visitor) const
 {
-  boost::shared_ptr<Ekiga::ContactCore> ccore = contact_core.lock ();
-  common_add (ContactPtr (new Contact (ccore, doc, node)));
+  bool go_on = true;
+
+  for (std::multimap<time_t, unsigned long>::const_iterator iter = time_index.lower_bound (from);
+       go_on && iter != time_index.end () && iter->first <= to;
+       ++iter)
+    go_on = visitor (get_contact (iter->second - first_number));
 }
 
 void
@@ -117,20 +133,21 @@ History::Book::add (const std::string & name,
                     const std::string & call_duration,
 		    const call_type c_t)
 {
-  boost::shared_ptr<Ekiga::ContactCore> ccore = contact_core.lock ();
-
   if ( !uri.empty ()) {
 
-    xmlNodePtr root = xmlDocGetRootElement (doc.get ());
-
-    ContactPtr contact(new Contact (ccore, doc, name, uri,
-				    call_start, call_duration, c_t));
+    Entry entry;
 
-    xmlAddChild (root, contact->get_node ());
+    entry.name = name;
+    entry.uri = uri;
+    entry.call_start = call_start;
+    entry.call_duration = call_duration;
+    entry.type = c_t;
 
-    save ();
+    store.append (entry);
+    push_entry (entry);
 
-    common_add (contact);
+    contact_added (get_contact (entries.size () - 1));
+    updated ();
 
     enforce_size_limit();
   }
@@ -158,25 +175,168 @@ History::Book::get_status () const
 }
 
 void
-History::Book::save () const
+History::Book::import_settings ()
 {
-  xmlChar *buffer = NULL;
-  int size = 0;
+  std::string raw = contacts_settings->get_string (CALL_HISTORY_KEY);
+  boost::shared_ptr<xmlDoc> doc;
+  xmlNodePtr root = NULL;
+  xmlChar* xml_str = NULL;
+
+  if (raw.empty ())
+    return;
+
+  doc = boost::shared_ptr<xmlDoc> (xmlRecoverMemory (raw.c_str (), raw.length ()), xmlFreeDoc);
+  if (doc)
+    root = xmlDocGetRootElement (doc.get ());
+
+  for (xmlNodePtr node = (root != NULL) ? root->children : NULL;
+       node != NULL;
+       node = node->next) {
+
+    if (node->type != XML_ELEMENT_NODE
+	|| node->name == NULL
+	|| !xmlStrEqual (BAD_CAST ("entry"), node->name))
+      continue;
+
+    Entry entry;
+    entry.type = RECEIVED;
+    entry.call_start = 0;
+
+    xml_str = xmlGetProp (node, (const xmlChar *)"type");
+    if (xml_str != NULL) {
+
+      entry.type = (call_type)(xml_str[0] - '0');
+      xmlFree (xml_str);
+    }
+
+    xml_str = xmlGetProp (node, (const xmlChar *)"uri");
+    if (xml_str != NULL) {
+
+      entry.uri = (const char *)xml_str;
+      xmlFree (xml_str);
+    }
 
-  xmlDocDumpMemory (doc.get (), &buffer, &size);
+    for (xmlNodePtr child = node->children ;
+	 child != NULL ;
+	 child = child->next) {
 
-  contacts_settings->set_string (CALL_HISTORY_KEY, (const char *)buffer);
+      if (child->type != XML_ELEMENT_NODE || child->name == NULL)
+	continue;
 
-  xmlFree (buffer);
+      xml_str = xmlNodeGetContent (child);
+      if (xml_str == NULL)
+	continue;
+
+      if (xmlStrEqual (BAD_CAST ("name"), child->name))
+	entry.name = (const char *)xml_str;
+
+      if (xmlStrEqual (BAD_CAST ("call_start"), child->name))
+	entry.call_start = (time_t) strtoll ((const char *) xml_str, NULL, 0);
+
+      if (xmlStrEqual (BAD_CAST ("call_duration"), child->name))
+	entry.call_duration = (const char *) xml_str;
+
+      xmlFree (xml_str);
+    }
+
+    store.append (entry);
+    push_entry (entry);
+  }
+
+  contacts_settings->set_string (CALL_HISTORY_KEY, "");
+}
+
+void
+History::Book::push_entry (const Entry& entry)
+{
+  unsigned long number = first_number + entries.size ();
+
+  entries.push_back (entry);
+  contacts.push_back (ContactPtr ());
+  uri_index.insert (std::make_pair (entry.uri, number));
+  time_index.insert (std::make_pair (entry.call_start, number));
+}
+
+void
+History::Book::pop_entry ()
+{
+  const Entry& entry = entries.front ();
+  ContactPtr contact = contacts.front ();
+
+  std::pair<std::multimap<std::string, unsigned long>::iterator,
+	    std::multimap<std::string, unsigned long>::iterator> uris
+    = uri_index.equal_range (entry.uri);
+  for (std::multimap<std::string, unsigned long>::iterator iter = uris.first;
+       iter != uris.second;
+       ++iter)
+    if (iter->second == first_number) {
+
+      uri_index.erase (iter);
+      break;
+    }
+
+  std::pair<std::multimap<time_t, unsigned long>::iterator,
+	    std::multimap<time_t, unsigned long>::iterator> times
+    = time_index.equal_range (entry.call_start);
+  for (std::multimap<time_t, unsigned long>::iterator iter = times.first;
+       iter != times.second;
+       ++iter)
+    if (iter->second == first_number) {
+
+      time_index.erase (iter);
+      break;
+    }
+
+  entries.pop_front ();
+  contacts.pop_front ();
+  first_number++;
+
+  if (contact) {
+
+    contact->removed ();
+    contact_removed (contact);
+  }
+}
+
+History::ContactPtr
+History::Book::get_contact (unsigned int position) const
+{
+  if ( !contacts[position]) {
+
+    const Entry& entry = entries[position];
+    boost::shared_ptr<Ekiga::ContactCore> ccore = contact_core.lock ();
+    ContactPtr contact (new Contact (ccore, entry.name, entry.uri,
+				     entry.call_start, entry.call_duration,
+				     entry.type));
+
+    /* the contacts are created lazily, even from const methods */
+    contact->questions.connect (boost::ref (const_cast<Book*> (this)->questions));
+    /* nothing to do when the contact is updated or removed:
+     * they don't get updated and only get removed by the book
+     */
+    contacts[position] = contact;
+  }
+
+  return contacts[position];
 }
 
 void
 History::Book::clear ()
 {
-  xmlNodePtr root = NULL;
+  std::list<ContactPtr> old_contacts;
+
+  for (std::deque<ContactPtr>::iterator iter = contacts.begin ();
+       iter != contacts.end ();
+       ++iter)
+    if (*iter)
+      old_contacts.push_back (*iter);
 
-  std::list<ContactPtr> old_contacts = ordered_contacts;
-  ordered_contacts.clear ();
+  entries.clear ();
+  contacts.clear ();
+  uri_index.clear ();
+  time_index.clear ();
+  first_number = 0;
+  store.clear ();
 
   cleared ();
   updated ();
@@ -185,12 +345,6 @@ History::Book::clear ()
        iter != old_contacts.end();
        ++iter)
     contact_removed (*iter);
-
-  doc = boost::shared_ptr<xmlDoc> (xmlNewDoc (BAD_CAST "1.0"), xmlFreeDoc);
-  root = xmlNewDocNode (doc.get (), NULL, BAD_CAST "list", NULL);
-  xmlDocSetRootElement (doc.get (), root);
-
-  save ();
 }
 
 void
@@ -217,16 +371,13 @@ History::Book::on_cleared_call (boost::shared_ptr<Ekiga::CallManager> /*manager*
 }
 
 void
-History::Book::common_add (ContactPtr contact)
+History::Book::on_contacts_settings_changed (const std::string key)
 {
-  contact->questions.connect (boost::ref (questions));
-  /* nothing to do when the contact is updated or removed:
-   * they don't get updated and only get removed all at the same time
-   */
+  if (key == CALL_HISTORY_SIZE_KEY) {
 
-  ordered_contacts.push_back (contact);
-  contact_added (contact);
-  updated ();
+    max_size = contacts_settings->get_int (CALL_HISTORY_SIZE_KEY);
+    enforce_size_limit ();
+  }
 }
 
 void
@@ -234,20 +385,20 @@ History::Book::enforce_size_limit()
 {
   bool flag = false;
 
-  while (ordered_contacts.size() > 100) {
+  while (entries.size () > max_size) {
 
-    ContactPtr contact = ordered_contacts.front ();
-    ordered_contacts.pop_front();
-    xmlNodePtr node = contact->get_node ();
-    contact->removed();
-    xmlUnlinkNode(node);
-    xmlFreeNode(node);
+    pop_entry ();
     flag = true;
   }
 
-  if (flag) {
+  /* the forgotten calls are still in the file : rewrite it once in a
+   * while, not each time */
+  if (store.get_lines () > max_size + max_size / 4) {
 
-    save();
-    updated();
+    std::list<Entry> kept (entries.begin (), entries.end ());
+    store.compact (kept);
   }
+
+  if (flag)
+    updated();
 }
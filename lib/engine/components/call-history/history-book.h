@@ -39,8 +39,12 @@
 #include "call-core.h"
 #include "call-manager.h"
 
+#include <deque>
+#include <map>
+
 #include "book-impl.h"
 #include "history-contact.h"
+#include "history-store.h"
 
 #include "ekiga-settings.h"
 #include "scoped-connections.h"
@@ -65,6 +69,7 @@ namespace History
 
     ~Book ();
 
+    /* visits all the calls, oldest first */
     void visit_contacts (boost::function1<bool, Ekiga::ContactPtr>) const;
 
     const std::string get_name () const;
@@ -88,17 +93,42 @@ namespace History
 
     void clear ();
 
+    /* the history can be long, so views should show it a page at a time :
+     * this visits count calls, newest first, after skipping the skip
+     * newest ones
+     */
+    void visit_latest_contacts (unsigned int skip,
+				unsigned int count,
+				boost::function1<bool, ContactPtr> visitor) const;
+
+    /* those visit the calls with that uri, or which started in [from, to],
+     * oldest first
+     */
+    void visit_contacts_with_uri (const std::string uri,
+				  boost::function1<bool, ContactPtr> visitor) const;
+
+    void visit_contacts_between (time_t from,
+				 time_t to,
+				 boost::function1<bool, ContactPtr> visitor) const;
+
+    unsigned int size () const
+    { return entries.size (); }
+
     boost::signals2::signal<void(void)> cleared;
 
   private:
 
     Ekiga::scoped_connections connections;
 
-    void parse_entry (xmlNodePtr entry);
+    void import_settings ();
+
+    void push_entry (const Entry& entry);
 
-    void save () const;
+    void pop_entry ();
 
-    void add (xmlNodePtr node);
+    ContactPtr get_contact (unsigned int position) const;
+
+    void on_contacts_settings_changed (const std::string key);
 
     void on_missed_call (boost::shared_ptr<Ekiga::CallManager> manager,
 			 boost::shared_ptr<Ekiga::Call> call);
@@ -107,14 +137,27 @@ namespace History
 			  boost::shared_ptr<Ekiga::Call> call,
 			  std::string message);
 
-    void common_add (ContactPtr contact);
-
     void enforce_size_limit();
 
     boost::weak_ptr<Ekiga::ContactCore> contact_core;
-    boost::shared_ptr<xmlDoc> doc;
-    std::list<ContactPtr> ordered_contacts;
     boost::shared_ptr<Ekiga::Settings> contacts_settings;
+    unsigned int max_size;
+
+    Store store;
+
+    /* the calls, oldest first, and the contacts for them -- those are only
+     * created when something asks for them
+     */
+    std::deque<Entry> entries;
+    mutable std::deque<ContactPtr> contacts;
+
+    /* the calls are numbered from the first one we ever knew, which
+     * doesn't move when the oldest are forgotten, and the indexes give
+     * those numbers
+     */
+    unsigned long first_number;
+    std::multimap<std::string, unsigned long> uri_index;
+    std::multimap<time_t, unsigned long> time_index;
   };
 
   typedef boost::shared_ptr<Book> BookPtr;
@@ -36,8 +36,6 @@
 #ifndef __HISTORY_CONTACT_H__
 #define __HISTORY_CONTACT_H__
 
-#include <libxml/tree.h>
-
 #include <boost/smart_ptr.hpp>
 
 #include "services.h"
@@ -65,11 +63,6 @@ namespace History
   public:
 
     Contact (boost::shared_ptr<Ekiga::ContactCore> _contact_core,
-	     boost::shared_ptr<xmlDoc> _doc,
-	     xmlNodePtr _node);
-
-    Contact (boost::shared_ptr<Ekiga::ContactCore> _contact_core,
-	     boost::shared_ptr<xmlDoc> _doc,
 	     const std::string _name,
 	     const std::string _uri,
              time_t call_start,
@@ -90,8 +83,6 @@ namespace History
 
     /*** more specific api ***/
 
-    xmlNodePtr get_node ();
-
     call_type get_type () const;
 
     time_t get_call_start () const;
@@ -102,8 +93,6 @@ namespace History
 
     boost::weak_ptr<Ekiga::ContactCore> contact_core;
 
-    boost::shared_ptr<xmlDoc> doc;
-    xmlNodePtr node;
     std::string name;
     std::string uri;
     time_t call_start;
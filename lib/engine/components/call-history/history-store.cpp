@@ -0,0 +1,178 @@
+
+/*
+ * Ekiga -- A VoIP and Video-Conferencing application
+ * Copyright (C) 2000-2009 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+/*
+ *                         history-store.cpp  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014
+ *   description          : implementation of the file keeping the call
+ *                          history
+ *
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <vector>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "history-store.h"
+#include "tab-separated.h"
+
+/* A record is : type, start, duration, uri and name */
+
+static void
+write_entry (FILE* file,
+	     const History::Entry& entry)
+{
+  gchar* start = g_strdup_printf ("%" G_GINT64_FORMAT, (gint64)entry.call_start);
+  std::string line = std::string (1, (char)('0' + entry.type))
+    + "\t" + start
+    + "\t" + Ekiga::tab_separated_escape (entry.call_duration)
+    + "\t" + Ekiga::tab_separated_escape (entry.uri)
+    + "\t" + Ekiga::tab_separated_escape (entry.name)
+    + "\n";
+
+  fwrite (line.c_str (), 1, line.size (), file);
+  g_free (start);
+}
+
+
+History::Store::Store (): file(NULL), lines(0)
+{
+  gchar* dir = g_build_filename (g_get_user_data_dir (), PACKAGE_NAME, NULL);
+  gchar* filename = g_build_filename (dir, "call-history", NULL);
+
+  g_mkdir_with_parents (dir, 0700);
+  path = filename;
+
+  g_free (filename);
+  g_free (dir);
+}
+
+History::Store::~Store ()
+{
+  if (file != NULL)
+    fclose (file);
+}
+
+bool
+History::Store::open (const char* mode)
+{
+  if (file != NULL)
+    fclose (file);
+
+  file = g_fopen (path.c_str (), mode);
+
+  return file != NULL;
+}
+
+void
+History::Store::load (boost::function1<void, const Entry&> visitor)
+{
+  std::string line;
+
+  lines = 0;
+  if ( !open ("rb"))
+    return;
+
+  while (Ekiga::tab_separated_read_line (file, line)) {
+
+    std::vector<std::string> fields = Ekiga::tab_separated_split (line);
+    lines++;
+
+    /* a broken line (crash while writing?) is skipped */
+    if (fields.size () != 5 || fields[0].size () != 1
+	|| fields[0][0] < '0' || fields[0][0] > '0' + MISSED)
+      continue;
+
+    Entry entry;
+    entry.type = (call_type)(fields[0][0] - '0');
+    entry.call_start = (time_t) strtoll (fields[1].c_str (), NULL, 10);
+    entry.call_duration = fields[2];
+    entry.uri = fields[3];
+    entry.name = fields[4];
+    visitor (entry);
+  }
+
+  fclose (file);
+  file = NULL;
+}
+
+void
+History::Store::append (const Entry& entry)
+{
+  if (file == NULL && !open ("ab"))
+    return;
+
+  write_entry (file, entry);
+  fflush (file);
+  lines++;
+}
+
+void
+History::Store::clear ()
+{
+  if (open ("wb")) {
+
+    fclose (file);
+    file = NULL;
+  }
+  lines = 0;
+}
+
+void
+History::Store::compact (const std::list<Entry>& entries)
+{
+  std::string new_path = path + ".new";
+  FILE* new_file = g_fopen (new_path.c_str (), "wb");
+  bool ok = false;
+
+  if (new_file == NULL)
+    return;
+
+  for (std::list<Entry>::const_iterator iter = entries.begin ();
+       iter != entries.end ();
+       ++iter)
+    write_entry (new_file, *iter);
+
+  ok = (fflush (new_file) == 0);
+  ok = (fclose (new_file) == 0) && ok;
+
+  if (file != NULL) {
+
+    fclose (file);
+    file = NULL;
+  }
+
+  /* if anything went wrong, the old file is still good */
+  if (ok && g_rename (new_path.c_str (), path.c_str ()) == 0)
+    lines = entries.size ();
+  else
+    g_unlink (new_path.c_str ());
+}
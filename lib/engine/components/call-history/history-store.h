@@ -0,0 +1,107 @@
+
+/*
+ * Ekiga -- A VoIP and Video-Conferencing application
+ * Copyright (C) 2000-2009 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+/*
+ *                         history-store.h  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014
+ *   description          : declaration of the file keeping the call history
+ *
+ */
+
+#ifndef __HISTORY_STORE_H__
+#define __HISTORY_STORE_H__
+
+#include <stdio.h>
+
+#include <list>
+#include <string>
+
+#include <boost/function.hpp>
+
+#include "history-contact.h"
+
+namespace History
+{
+
+/**
+ * @addtogroup contacts
+ * @internal
+ * @{
+ */
+
+  struct Entry
+  {
+    std::string name;
+    std::string uri;
+    time_t call_start;
+    std::string call_duration;
+    call_type type;
+  };
+
+  /* The calls are kept in a file with a line per call, to which new calls
+   * are appended : adding a call doesn't rewrite the whole history. The
+   * file is only rewritten when the history is cleared, and when the book
+   * asks to forget about the oldest calls (compaction).
+   */
+  class Store
+  {
+  public:
+
+    Store ();
+
+    ~Store ();
+
+    /* reads the calls from the file, oldest first */
+    void load (boost::function1<void, const Entry&> visitor);
+
+    void append (const Entry& entry);
+
+    void clear ();
+
+    /* rewrites the file with only those calls */
+    void compact (const std::list<Entry>& entries);
+
+    /* how many calls are in the file */
+    unsigned int get_lines () const
+    { return lines; }
+
+  private:
+
+    bool open (const char* mode);
+
+    std::string path;
+    FILE* file;
+    unsigned int lines;
+  };
+
+/**
+ * @}
+ */
+
+};
+
+#endif
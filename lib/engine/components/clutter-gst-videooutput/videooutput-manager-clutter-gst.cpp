@@ -49,14 +49,26 @@
 
 #include "runtime.h"
 
+/* The GstBuffer pushed to the pipelines hold a reference to the frame
+ * they wrap : this is called when gstreamer is done with them
+ */
+static void
+frame_unref (gpointer data)
+{
+  delete (Ekiga::VideoFramePtr*) data;
+}
 
-GMVideoOutputManager_clutter_gst::GMVideoOutputManager_clutter_gst (G_GNUC_UNUSED Ekiga::ServiceCore & _core)
+GMVideoOutputManager_clutter_gst::GMVideoOutputManager_clutter_gst (G_GNUC_UNUSED Ekiga::ServiceCore & _core):
+  frame_pool(new Ekiga::VideoFramePool)
 {
   devices_nbr = 0;
 
   for (int i = 0 ; i < 3 ; i++) {
     texture[i] = NULL;
     pipeline[i] = NULL;
+    appsrc[i] = NULL;
+    videosink[i] = NULL;
+    playing[i] = false;
     current_height[i] = 0;
     current_width[i] = 0;
   }
@@ -77,23 +89,23 @@ GMVideoOutputManager_clutter_gst::quit ()
 void
 GMVideoOutputManager_clutter_gst::open ()
 {
-  GstElement *appsrc = NULL;
-  GstElement *videosink = NULL;
   GstElement *conv = NULL;
   GstCaps *caps = NULL;
-  PWaitAndSignal m(device_mutex);
 
   for (int i = 0 ; i < 3 ; ++i) {
 
+    PWaitAndSignal m(view_mutex[i]);
     std::ostringstream name;
     name << std::string ("appsrc") << i;
     pipeline[i] = gst_pipeline_new (NULL);
-    videosink = gst_element_factory_make ("autocluttersink", "videosink");
-    if (videosink == NULL)
-      videosink = gst_element_factory_make ("cluttersink", "videosink");
-    g_object_set (videosink, "texture", texture[i], NULL);
-
-    appsrc = gst_element_factory_make ("appsrc", name.str ().c_str ());
+    playing[i] = false;
+    videosink[i] = gst_element_factory_make ("autocluttersink", "videosink");
+    if (videosink[i] == NULL)
+      videosink[i] = gst_element_factory_make ("cluttersink", "videosink");
+    if (videosink[i])
+      g_object_set (videosink[i], "texture", texture[i], NULL);
+
+    appsrc[i] = gst_element_factory_make ("appsrc", name.str ().c_str ());
     conv = gst_element_factory_make ("videoconvert", NULL);
 
     /* set the caps on the source */
@@ -111,21 +123,21 @@ GMVideoOutputManager_clutter_gst::open ()
                                 "endianness", G_TYPE_INT, G_LITTLE_ENDIAN,
                                 NULL);
 
-    if (!videosink || !appsrc || !conv || !pipeline[i]) {
+    if (!videosink[i] || !appsrc[i] || !conv || !pipeline[i]) {
 
       Ekiga::Runtime::run_in_main (boost::bind (&GMVideoOutputManager_clutter_gst::device_error_in_main,
                                                 this));
       break;
     }
 
-    gst_app_src_set_caps (GST_APP_SRC (appsrc), caps);
-    g_object_set (G_OBJECT (appsrc),
+    gst_app_src_set_caps (GST_APP_SRC (appsrc[i]), caps);
+    g_object_set (G_OBJECT (appsrc[i]),
                   "block", TRUE,
                   "max-bytes", MAX_VIDEO_SIZE*3/2,
                   "stream-type", GST_APP_STREAM_TYPE_STREAM,
                   NULL);
-    gst_bin_add_many (GST_BIN (pipeline[i]), appsrc, conv, videosink, NULL);
-    gst_element_link_many (appsrc, conv, videosink, NULL);
+    gst_bin_add_many (GST_BIN (pipeline[i]), appsrc[i], conv, videosink[i], NULL);
+    gst_element_link_many (appsrc[i], conv, videosink[i], NULL);
     gst_caps_unref (caps);
   }
 }
@@ -134,22 +146,22 @@ GMVideoOutputManager_clutter_gst::open ()
 void
 GMVideoOutputManager_clutter_gst::close ()
 {
-  PWaitAndSignal m(device_mutex);
-  for (int i = 0 ; i < 2 ; i++) {
+  for (int i = 0 ; i < 3 ; i++) {
+    PWaitAndSignal m(view_mutex[i]);
     if (!pipeline[i])
       continue;
 
-    std::ostringstream name;
-    name << std::string ("appsrc") << i;
-    GstElement *appsrc = gst_bin_get_by_name (GST_BIN (pipeline[i]), name.str ().c_str ());
-    gst_app_src_end_of_stream (GST_APP_SRC (appsrc));
+    gst_app_src_end_of_stream (GST_APP_SRC (appsrc[i]));
     gst_element_set_state (pipeline[i], GST_STATE_NULL);
     gst_object_unref (pipeline[i]);
     pipeline[i] = NULL;
+    appsrc[i] = NULL;
+    videosink[i] = NULL;
+    playing[i] = false;
     current_height[i] = 0;
     current_width[i] = 0;
   }
-  devices_nbr = 0;
+  g_atomic_int_set (&devices_nbr, 0);
 
   Ekiga::Runtime::run_in_main (boost::bind (&GMVideoOutputManager_clutter_gst::device_closed_in_main,
                                             this));
@@ -162,20 +174,25 @@ GMVideoOutputManager_clutter_gst::set_frame_data (const char *data,
                                                   unsigned height,
                                                   Ekiga::VideoOutputManager::VideoView i,
                                                   int _devices_nbr)
+{
+  Ekiga::VideoFramePtr frame = frame_pool->get_frame (width, height);
+
+  memcpy (frame->data, data, frame->get_size ());
+  set_frame (frame, i, _devices_nbr);
+}
+
+
+void
+GMVideoOutputManager_clutter_gst::set_frame (Ekiga::VideoFramePtr frame,
+                                             Ekiga::VideoOutputManager::VideoView i,
+                                             int _devices_nbr)
 {
   GstBuffer *buffer = NULL;
-  GstMapInfo info;
-  int buffer_size = width*height*3/2;
-  std::ostringstream name;
+  unsigned width = frame->width;
+  unsigned height = frame->height;
   bool init = false;
 
-  info.memory = NULL;
-  info.flags = GST_MAP_WRITE;
-  info.data = NULL;
-  info.size = 0;
-  info.maxsize = buffer_size;
-
-  PWaitAndSignal m(device_mutex);
+  PWaitAndSignal m(view_mutex[i]);
 
   if (!pipeline[i]) {
     PTRACE (1, "GMVideoOutputManager_clutter_gst\tTrying to upload frame to closed pipeline " << i);
@@ -191,45 +208,39 @@ GMVideoOutputManager_clutter_gst::set_frame_data (const char *data,
                     height,
                     (_devices_nbr > 1),
                     (_devices_nbr > 2)));
-    devices_nbr = (unsigned) _devices_nbr;
+    g_atomic_int_set (&devices_nbr, _devices_nbr);
     current_height[i] = height;
     current_width[i] = width;
     init = true;
   }
 
-  name << std::string ("appsrc") << i;
-  GstElement *appsrc = gst_bin_get_by_name (GST_BIN (pipeline[i]), name.str ().c_str ());
+  if (init) {
 
-  if (init || current_width[i] != width || current_height[i] != height) {
-
-    GstCaps *caps = gst_app_src_get_caps (GST_APP_SRC (appsrc));
+    GstCaps *caps = gst_app_src_get_caps (GST_APP_SRC (appsrc[i]));
     GstCaps *new_caps = gst_caps_copy (caps);
     gst_caps_set_simple (new_caps,
                          "width", G_TYPE_INT, width,
                          "height", G_TYPE_INT, height, NULL);
-    gst_app_src_set_caps (GST_APP_SRC (appsrc), new_caps);
+    gst_app_src_set_caps (GST_APP_SRC (appsrc[i]), new_caps);
     gst_caps_unref (caps);
     gst_caps_unref (new_caps);
-
-    current_height[i] = height;
-    current_width[i] = width;
-
-    if (!init)
-      Ekiga::Runtime::run_in_main (boost::bind (&GMVideoOutputManager_clutter_gst::size_changed_in_main,
-                                                this,
-                                                i,
-                                                width,
-                                                height));
   }
 
-  buffer = gst_buffer_new_and_alloc (buffer_size);
-  gst_buffer_map (buffer, &info, GST_MAP_WRITE);
-  memcpy ((void *) info.data, (const void *) data, buffer_size);
-  info.size = buffer_size;
-  gst_buffer_unmap (buffer, &info);
-  gst_app_src_push_buffer (GST_APP_SRC (appsrc), buffer);
+  /* The buffer wraps the frame memory, and keeps a reference to the frame
+   * until the sink is done with it : no copy, no allocation
+   */
+  buffer = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY,
+                                        frame->data, frame->capacity,
+                                        0, frame->get_size (),
+                                        new Ekiga::VideoFramePtr (frame),
+                                        frame_unref);
+  gst_app_src_push_buffer (GST_APP_SRC (appsrc[i]), buffer);
+
+  if (!playing[i]) {
 
-  gst_element_set_state (pipeline[i], GST_STATE_PLAYING);
+    gst_element_set_state (pipeline[i], GST_STATE_PLAYING);
+    playing[i] = true;
+  }
 }
 
 
@@ -237,31 +248,34 @@ void
 GMVideoOutputManager_clutter_gst::set_display_info (const gpointer _local_video,
                                                     const gpointer _remote_video)
 {
-  GstElement *videosink = NULL;
-  PWaitAndSignal m(device_mutex);
-
-  if (_local_video == NULL) {
-    gst_element_set_state (pipeline[0], GST_STATE_NULL);
-    texture[0] = NULL;
-  }
-  else {
-    texture[0] = CLUTTER_ACTOR (_local_video);
-    if (pipeline[0]) {
-      videosink = gst_bin_get_by_name (GST_BIN (pipeline[0]), "videosink");
-      g_object_set (videosink, "texture", texture[0], NULL);
+  {
+    PWaitAndSignal m(view_mutex[0]);
+
+    if (_local_video == NULL) {
+      if (pipeline[0])
+        gst_element_set_state (pipeline[0], GST_STATE_NULL);
+      playing[0] = false;
+      texture[0] = NULL;
+    }
+    else {
+      texture[0] = CLUTTER_ACTOR (_local_video);
+      if (videosink[0])
+        g_object_set (videosink[0], "texture", texture[0], NULL);
     }
   }
 
+  PWaitAndSignal m(view_mutex[1]);
+
   if (_remote_video == NULL) {
-    gst_element_set_state (pipeline[1], GST_STATE_NULL);
+    if (pipeline[1])
+      gst_element_set_state (pipeline[1], GST_STATE_NULL);
+    playing[1] = false;
     texture[1] = NULL;
   }
   else {
     texture[1] = CLUTTER_ACTOR (_remote_video);
-    if (pipeline[1]) {
-      videosink = gst_bin_get_by_name (GST_BIN (pipeline[1]), "videosink");
-      g_object_set (videosink, "texture", texture[1], NULL);
-    }
+    if (videosink[1])
+      g_object_set (videosink[1], "texture", texture[1], NULL);
   }
 }
 
@@ -269,19 +283,18 @@ GMVideoOutputManager_clutter_gst::set_display_info (const gpointer _local_video,
 void
 GMVideoOutputManager_clutter_gst::set_ext_display_info (const gpointer _ext_video)
 {
-  GstElement *videosink = NULL;
-  PWaitAndSignal m(device_mutex);
+  PWaitAndSignal m(view_mutex[2]);
 
   if (_ext_video == NULL) {
-    gst_element_set_state (pipeline[2], GST_STATE_NULL);
+    if (pipeline[2])
+      gst_element_set_state (pipeline[2], GST_STATE_NULL);
+    playing[2] = false;
     texture[2] = NULL;
   }
   else {
     texture[2] = CLUTTER_ACTOR (_ext_video);
-    if (pipeline[2]) {
-      videosink = gst_bin_get_by_name (GST_BIN (pipeline[2]), "videosink");
-      g_object_set (videosink, "texture", texture[2], NULL);
-    }
+    if (videosink[2])
+      g_object_set (videosink[2], "texture", texture[2], NULL);
   }
 }
 
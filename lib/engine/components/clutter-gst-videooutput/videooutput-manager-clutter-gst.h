@@ -67,6 +67,10 @@ public:
                        Ekiga::VideoOutputManager::VideoView type,
                        int devices_nbr);
 
+  void set_frame (Ekiga::VideoFramePtr frame,
+                  Ekiga::VideoOutputManager::VideoView type,
+                  int devices_nbr);
+
   void set_display_info (const gpointer local_video,
                          const gpointer remote_video);
 
@@ -88,7 +92,8 @@ private:
   void device_error_in_main ();
 
   // Variables
-  PMutex device_mutex;
+  // Each view has its own lock, so that a slow view never holds back another
+  PMutex view_mutex[3];
 
   // 0 = local, 1 = remote, 2 = extended
   unsigned current_width[3];
@@ -96,7 +101,15 @@ private:
   GstElement *pipeline[3];
   ClutterActor *texture[3];
 
-  int devices_nbr;
+  // Cached pipeline elements, owned by the pipelines
+  GstElement *appsrc[3];
+  GstElement *videosink[3];
+  bool playing[3];
+
+  // Frames given to set_frame_data are copied in those
+  boost::shared_ptr<Ekiga::VideoFramePool> frame_pool;
+
+  volatile gint devices_nbr;
 };
 
 /**
@@ -33,6 +33,8 @@
  *
  */
 
+#include "config.h"
+
 #include "local-heap.h"
 
 #include <set>
@@ -45,23 +47,42 @@
 
 #define ROSTER_KEY "roster"
 
+/* how long to wait for more changes before writing the roster */
+#define ROSTER_SAVE_DELAY 2
+
+static gboolean
+on_save_timeout_c (gpointer data)
+{
+  ((Local::Heap*)data)->on_save_timeout ();
+  return FALSE;
+}
+
 /*
  * Public API
  */
 Local::Heap::Heap (boost::shared_ptr<Ekiga::PresenceCore> _presence_core,
 		   boost::shared_ptr<Local::Cluster> _local_cluster):
-  presence_core(_presence_core), local_cluster(_local_cluster), doc ()
+  presence_core(_presence_core), local_cluster(_local_cluster), doc (),
+  save_timeout(0), dirty(false)
 {
   xmlNodePtr root;
+  xmlDocPtr loaded = NULL;
+  uri_index = add_index (boost::bind (&Local::Presentity::get_uri, _1));
   contacts_settings = boost::shared_ptr<Ekiga::Settings> (new Ekiga::Settings (CONTACTS_SCHEMA));
-  std::string raw = contacts_settings->get_string (ROSTER_KEY);
 
-  // Build the XML document representing the contacts list from the configuration
-  if (!raw.empty ()) {
+  gchar* dir = g_build_filename (g_get_user_data_dir (), PACKAGE_NAME, NULL);
+  gchar* filename = g_build_filename (dir, "roster.xml", NULL);
+  g_mkdir_with_parents (dir, 0700);
+  path = filename;
+  g_free (filename);
+  g_free (dir);
+
+  loaded = load ();
+
+  // Build the XML document representing the contacts list from the file
+  if (loaded != NULL) {
 
-    doc = boost::shared_ptr<xmlDoc> (xmlRecoverMemory (raw.c_str (), raw.length ()), xmlFreeDoc);
-    if ( !doc)
-      doc = boost::shared_ptr<xmlDoc> (xmlNewDoc (BAD_CAST "1.0"), xmlFreeDoc);
+    doc = boost::shared_ptr<xmlDoc> (loaded, xmlFreeDoc);
 
     root = xmlDocGetRootElement (doc.get ());
     if (root == NULL) {
@@ -99,6 +120,7 @@ Local::Heap::Heap (boost::shared_ptr<Ekiga::PresenceCore> _presence_core,
 
 Local::Heap::~Heap ()
 {
+  flush ();
 }
 
 
@@ -127,36 +149,10 @@ Local::Heap::populate_menu_for_group (const std::string name,
   return true;
 }
 
-struct has_presentity_with_uri_helper
-{
-  has_presentity_with_uri_helper (const std::string uri_): uri(uri_),
-							   found(false)
-  {}
-
-  const std::string uri;
-
-  bool found;
-
-  bool operator() (Ekiga::PresentityPtr pres)
-  {
-    Local::PresentityPtr presentity = boost::dynamic_pointer_cast<Local::Presentity> (pres);
-    if (presentity && presentity->get_uri () == uri) {
-
-      found = true;
-    }
-
-    return !found;
-  }
-};
-
 bool
 Local::Heap::has_presentity_with_uri (const std::string uri)
 {
-  has_presentity_with_uri_helper helper(uri);
-
-  visit_presentities (boost::ref (helper));
-
-  return helper.found;
+  return find_object (uri_index, uri).get () != NULL;
 }
 
 struct existing_groups_helper
@@ -257,23 +253,16 @@ Local::Heap::new_presentity (const std::string name,
 
 struct push_presence_helper
 {
-  push_presence_helper (const std::string uri_,
-			const std::string presence_): uri(uri_),
-						      presence(presence_)
+  push_presence_helper (const std::string presence_): presence(presence_)
   {}
 
-  bool operator() (Ekiga::PresentityPtr pres_)
+  bool operator() (Local::PresentityPtr presentity)
   {
-    Local::PresentityPtr presentity = boost::dynamic_pointer_cast<Local::Presentity> (pres_);
-    if (presentity && presentity->get_uri () == uri) {
-
-      presentity->set_presence (presence);
-    }
+    presentity->set_presence (presence);
 
     return true;
   }
 
-  const std::string uri;
   const std::string presence;
 };
 
@@ -281,30 +270,23 @@ void
 Local::Heap::push_presence (const std::string uri,
 			    const std::string presence)
 {
-  push_presence_helper helper(uri, presence);
+  push_presence_helper helper(presence);
 
-  visit_presentities (boost::ref (helper));
+  visit_objects (uri_index, uri, helper);
 }
 
 struct push_status_helper
 {
-  push_status_helper (const std::string uri_,
-		      const std::string status_): uri(uri_),
-						  status(status_)
+  push_status_helper (const std::string status_): status(status_)
   {}
 
-  bool operator() (Ekiga::PresentityPtr pres_)
+  bool operator() (Local::PresentityPtr presentity)
   {
-    Local::PresentityPtr presentity = boost::dynamic_pointer_cast<Local::Presentity> (pres_);
-    if (presentity && presentity->get_uri () == uri) {
-
-      presentity->set_status (status);
-    }
+    presentity->set_status (status);
 
     return true;
   }
 
-  const std::string uri;
   const std::string status;
 };
 
@@ -312,9 +294,9 @@ void
 Local::Heap::push_status (const std::string uri,
 			  const std::string status)
 {
-  push_status_helper helper(uri, status);
+  push_status_helper helper(status);
 
-  visit_presentities (boost::ref (helper));
+  visit_objects (uri_index, uri, helper);
 }
 
 
@@ -368,16 +350,88 @@ Local::Heap::common_add (PresentityPtr presentity)
 
 
 void
-Local::Heap::save () const
+Local::Heap::save ()
+{
+  dirty = true;
+
+  /* the changes made until the timeout are written together */
+  if (save_timeout == 0)
+    save_timeout = g_timeout_add_seconds (ROSTER_SAVE_DELAY, on_save_timeout_c, this);
+}
+
+
+void
+Local::Heap::on_save_timeout ()
+{
+  save_timeout = 0;
+  flush ();
+}
+
+
+bool
+Local::Heap::flush ()
 {
   xmlChar *buffer = NULL;
   int doc_size = 0;
+  GError* error = NULL;
+  bool result = true;
+
+  if (save_timeout != 0) {
+
+    g_source_remove (save_timeout);
+    save_timeout = 0;
+  }
+
+  if ( !dirty)
+    return true;
 
   xmlDocDumpMemory (doc.get (), &buffer, &doc_size);
 
-  contacts_settings->set_string (ROSTER_KEY, (const char *)buffer);
+  /* writes to a temporary file then renames it : the roster is never
+   * left half-written */
+  if ( !g_file_set_contents (path.c_str (), (const gchar*)buffer, doc_size, &error)) {
+
+    g_warning ("Couldn't save the roster: %s", error->message);
+    g_error_free (error);
+    result = false;
+  }
+  else
+    dirty = false;
 
   xmlFree (buffer);
+
+  return result;
+}
+
+
+xmlDocPtr
+Local::Heap::load ()
+{
+  xmlDocPtr result = NULL;
+  gchar* contents = NULL;
+  gsize length = 0;
+
+  if (g_file_get_contents (path.c_str (), &contents, &length, NULL)) {
+
+    result = xmlRecoverMemory (contents, length);
+    g_free (contents);
+    if (result == NULL)
+      result = xmlNewDoc (BAD_CAST "1.0");
+    return result;
+  }
+
+  /* older versions kept the roster in a GSettings key : move it to the file */
+  std::string raw = contacts_settings->get_string (ROSTER_KEY);
+  if ( !raw.empty ()) {
+
+    result = xmlRecoverMemory (raw.c_str (), raw.length ());
+    if (result == NULL)
+      result = xmlNewDoc (BAD_CAST "1.0");
+    if (g_file_set_contents (path.c_str (), raw.c_str (), raw.length (), NULL))
+      contacts_settings->set_string (ROSTER_KEY, "");
+  }
+
+  return result;
 }
 
 
@@ -408,7 +462,6 @@ Local::Heap::new_presentity_form_submitted (bool submitted,
       && !has_presentity_with_uri (uri)) {
 
     add (name, uri, groups);
-    save ();
   } else {
 
     boost::shared_ptr<Ekiga::FormRequestSimple> request = boost::shared_ptr<Ekiga::FormRequestSimple>(new Ekiga::FormRequestSimple (boost::bind (&Local::Heap::new_presentity_form_submitted, this, _1, _2)));
@@ -477,21 +530,16 @@ Local::Heap::decide (const std::string /*domain*/,
 		     const std::string token) const
 {
   Ekiga::FriendOrFoe::Identification result = Ekiga::FriendOrFoe::Unknown;
+  PresentityPtr presentity = find_object (uri_index, token);
 
-  for (const_iterator iter = begin ();
-       iter != end ();
-       ++iter) {
+  if (presentity) {
 
-    if ((*iter)->get_uri () == token) {
+    if (presentity->is_preferred ()) {
 
-      if ((*iter)->is_preferred ()) {
-
-	result = Ekiga::FriendOrFoe::Friend;
-      } else {
+      result = Ekiga::FriendOrFoe::Friend;
+    } else {
 
-	result = Ekiga::FriendOrFoe::Neutral;
-      }
-      break;
+      result = Ekiga::FriendOrFoe::Neutral;
     }
   }
 
@@ -61,8 +61,9 @@ namespace Local
    * signals defined in heap.h through the use of global implementations
    * coded in heap-imp.h.
    *
-   * When required, the Heap content is being saved in a GmConf entry.
-   * Alternatively, it could be saved elsewhere.
+   * When required, the Heap content is being saved in a file in the
+   * user data directory ; as many changes come in bursts (importing
+   * contacts, renaming a group...), the writes are delayed and grouped.
    */
   class Heap:
     public Ekiga::HeapImpl<Presentity>,
@@ -182,9 +183,31 @@ namespace Local
     void common_add (PresentityPtr presentity);
 
 
-    /** Save the XML Document in the GmConf key.
+    /** Mark the XML Document as needing to be saved : it will be
+     * written once no other change came for a little while, or when
+     * the Heap is destroyed.
      */
-    void save () const;
+    void save ();
+
+
+    /** Write the XML Document to the roster file now, if it changed.
+     * @return: FALSE if the file couldn't be written.
+     */
+    bool flush ();
+
+
+    /** Read the XML Document from the roster file, or from the
+     * GSettings key used by older versions.
+     * @return: The XML Document, or NULL if there is none.
+     */
+    xmlDocPtr load ();
+
+  public:
+
+    /* called by the save timeout */
+    void on_save_timeout ();
+
+  private:
 
 
     /** This should be triggered when a new Presentity form
@@ -211,6 +234,12 @@ namespace Local
     boost::weak_ptr<Local::Cluster> local_cluster;
     boost::shared_ptr<xmlDoc> doc;
     boost::shared_ptr<Ekiga::Settings> contacts_settings;
+    std::string path;
+    unsigned int save_timeout;
+    bool dirty;
+
+    /* the RefLister index of the presentities by uri */
+    int uri_index;
   };
 
   typedef boost::shared_ptr<Heap> HeapPtr;
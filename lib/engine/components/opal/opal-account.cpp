@@ -161,11 +161,12 @@ Opal::Account::Account (boost::shared_ptr<Opal::Sip::EndPoint> _sip_endpoint,
   failed_registration_already_notified = false;
   dead = false;
 
-  decide_type ();
+  parse_node ();
+
+  uri_index = add_index (boost::bind (&Opal::Presentity::get_uri, _1));
 
   if (type != Account::H323) {
 
-    const std::string name = get_name ();
     if (name.find ("%limit") != std::string::npos)
       compat_mode = SIPRegister::e_CannotRegisterMultipleContacts;  // start registration in this compat mode
     else
@@ -214,25 +215,7 @@ Opal::Account::get_groups () const
 const std::string
 Opal::Account::get_name () const
 {
-  std::string result;
-  xmlChar* xml_str = NULL;
-
-  for (xmlNodePtr child = node->children; child != NULL; child = child->next) {
-
-    if (child->type == XML_ELEMENT_NODE && child->name != NULL && xmlStrEqual (BAD_CAST "name", child->name)) {
-
-      xml_str = xmlNodeGetContent (child);
-      if (xml_str != NULL) {
-
-	result = (const char*)xml_str;
-	xmlFree (xml_str);
-      } else {
-	result = _("Unnamed");
-      }
-    }
-  }
-
-  return result;
+  return name;
 }
 
 const std::string
@@ -262,139 +245,48 @@ Opal::Account::get_status () const
 const std::string
 Opal::Account::get_aor () const
 {
-  std::stringstream str;
-
-  str << (get_protocol_name () == "SIP" ? "sip:" : "h323:") << get_username ();
-
-  if (get_username ().find ("@") == string::npos)
-    str << "@" << get_host ();
-
-  return str.str ();
+  return aor;
 }
 
 const std::string
 Opal::Account::get_protocol_name () const
 {
-  std::string result = "SIP";
-  xmlChar* xml_str = xmlGetProp (node, BAD_CAST "type");
-
-  if (xml_str != NULL) {
-
-    result = (const char*)xml_str;
-    xmlFree (xml_str);
-    if (result.compare ("Ekiga") == 0 || result.compare ("DiamondCard") == 0)
-      result = "SIP";
-  }
-
-  return result;
+  return protocol_name;
 }
 
 
 const std::string
 Opal::Account::get_host () const
 {
-  std::string result;
-  xmlChar* xml_str = NULL;
-
-  for (xmlNodePtr child = node->children; child != NULL; child = child->next) {
-
-    if (child->type == XML_ELEMENT_NODE && child->name != NULL && xmlStrEqual (BAD_CAST "host", child->name)) {
-
-      xml_str = xmlNodeGetContent (child);
-      if (xml_str != NULL) {
-
-	result = (const char*)xml_str;
-	xmlFree (xml_str);
-      }
-    }
-  }
-
-  return result;
+  return host;
 }
 
 
 const std::string
 Opal::Account::get_username () const
 {
-  std::string result;
-  xmlChar* xml_str = NULL;
-
-  for (xmlNodePtr child = node->children; child != NULL; child = child->next) {
-
-    if (child->type == XML_ELEMENT_NODE && child->name != NULL && xmlStrEqual (BAD_CAST "user", child->name)) {
-
-      xml_str = xmlNodeGetContent (child);
-      if (xml_str != NULL) {
-
-	result = (const char*)xml_str;
-	xmlFree (xml_str);
-      }
-    }
-  }
-
-  return result;
+  return user;
 }
 
 
 const std::string
 Opal::Account::get_authentication_username () const
 {
-  std::string result;
-  xmlChar* xml_str = NULL;
-
-  for (xmlNodePtr child = node->children; child != NULL; child = child->next) {
-
-    if (child->type == XML_ELEMENT_NODE && child->name != NULL && xmlStrEqual (BAD_CAST "auth_user", child->name)) {
-
-      xml_str = xmlNodeGetContent (child);
-      if (xml_str != NULL) {
-
-	result = (const char*)xml_str;
-	xmlFree (xml_str);
-      }
-    }
-  }
-
-  return result;
+  return auth_user;
 }
 
 
 const std::string
 Opal::Account::get_password () const
 {
-  std::string result;
-  xmlChar* xml_str = NULL;
-
-  for (xmlNodePtr child = node->children; child != NULL; child = child->next) {
-
-    if (child->type == XML_ELEMENT_NODE && child->name != NULL && xmlStrEqual (BAD_CAST "password", child->name)) {
-
-      xml_str = xmlNodeGetContent (child);
-      if (xml_str != NULL) {
-
-	result = (const char*)xml_str;
-	xmlFree (xml_str);
-      }
-    }
-  }
-
-  return result;
+  return password;
 }
 
 
 unsigned
 Opal::Account::get_timeout () const
 {
-  unsigned result = 0;
-  xmlChar* xml_str = xmlGetProp (node, BAD_CAST "timeout");
-
-  if (xml_str != NULL) {
-
-    result = std::strtoul ((const char*)xml_str, NULL, 0);
-    xmlFree (xml_str);
-  }
-
-  return result;
+  return timeout;
 }
 
 
@@ -421,6 +313,7 @@ Opal::Account::set_authentication_settings (const std::string& username,
     }
   }
 
+  parse_node ();
   enable ();
 }
 
@@ -429,6 +322,7 @@ void
 Opal::Account::enable ()
 {
   xmlSetProp (node, BAD_CAST "enabled", BAD_CAST "true");
+  enabled = true;
 
   state = Processing;
   status = _("Processing...");
@@ -443,6 +337,7 @@ void
 Opal::Account::disable ()
 {
   xmlSetProp (node, BAD_CAST "enabled", BAD_CAST "false");
+  enabled = false;
 
   if (presentity) {
 
@@ -475,22 +370,7 @@ Opal::Account::disable ()
 bool
 Opal::Account::is_enabled () const
 {
-  bool result = false;
-  xmlChar* xml_str = xmlGetProp (node, BAD_CAST "enabled");
-
-  if (xml_str != NULL) {
-
-    if (xmlStrEqual (xml_str, BAD_CAST "true")) {
-
-      result = true;
-    } else {
-
-      result = false;
-    }
-    xmlFree (xml_str);
-  }
-
-  return result;
+  return enabled;
 }
 
 
@@ -753,7 +633,7 @@ Opal::Account::on_edit_form_submitted (bool submitted,
       }
     }
 
-    decide_type ();
+    parse_node ();
 
     if (should_enable)
       enable ();
@@ -1250,16 +1130,8 @@ Opal::Account::presence_status_in_main (std::string uri,
 					std::string uri_presence,
 					std::string uri_status) const
 {
-  for (const_iterator iter = begin ();
-       iter != end ();
-       ++iter) {
-
-    if ((*iter)->has_uri (uri)) {
-
-      (*iter)->set_presence (uri_presence);
-      (*iter)->set_status (uri_status);
-    }
-  }
+  visit_objects (uri_index, uri,
+		 boost::bind (&Opal::Account::set_presence_and_status, _1, uri_presence, uri_status));
   presence_received (uri, uri_presence);
   status_received (uri, uri_status);
 }
@@ -1287,6 +1159,25 @@ Opal::Account::visit_presentities (boost::function1<bool, Ekiga::PresentityPtr >
 }
 
 
+Opal::PresentityPtr
+Opal::Account::find_presentity (const std::string uri) const
+{
+  return find_object (uri_index, uri);
+}
+
+
+bool
+Opal::Account::set_presence_and_status (Opal::PresentityPtr pres,
+					std::string presence,
+					std::string status)
+{
+  pres->set_presence (presence);
+  pres->set_status (status);
+
+  return true;
+}
+
+
 bool
 Opal::Account::populate_menu_for_group (const std::string name,
 					Ekiga::MenuBuilder& builder)
@@ -1349,15 +1240,93 @@ Opal::Account::rename_group_form_submitted (std::string old_name,
 }
 
 void
-Opal::Account::decide_type ()
+Opal::Account::parse_node ()
 {
-  const std::string host = get_host ();
+  xmlChar* xml_str = NULL;
 
+  name = "";
+  host = "";
+  user = "";
+  auth_user = "";
+  password = "";
+  timeout = 0;
+  enabled = false;
+  protocol_name = "SIP";
+
+  xml_str = xmlGetProp (node, BAD_CAST "type");
+  if (xml_str != NULL) {
+
+    protocol_name = (const char*)xml_str;
+    xmlFree (xml_str);
+    if (protocol_name == "Ekiga" || protocol_name == "DiamondCard")
+      protocol_name = "SIP";
+  }
+
+  xml_str = xmlGetProp (node, BAD_CAST "timeout");
+  if (xml_str != NULL) {
+
+    timeout = std::strtoul ((const char*)xml_str, NULL, 0);
+    xmlFree (xml_str);
+  }
+
+  xml_str = xmlGetProp (node, BAD_CAST "enabled");
+  if (xml_str != NULL) {
+
+    enabled = xmlStrEqual (xml_str, BAD_CAST "true");
+    xmlFree (xml_str);
+  }
+
+  for (xmlNodePtr child = node->children; child != NULL; child = child->next) {
+
+    if (child->type != XML_ELEMENT_NODE || child->name == NULL)
+      continue;
+
+    std::string* field = NULL;
+    if (xmlStrEqual (BAD_CAST "name", child->name))
+      field = &name;
+    else if (xmlStrEqual (BAD_CAST "host", child->name))
+      field = &host;
+    else if (xmlStrEqual (BAD_CAST "user", child->name))
+      field = &user;
+    else if (xmlStrEqual (BAD_CAST "auth_user", child->name))
+      field = &auth_user;
+    else if (xmlStrEqual (BAD_CAST "password", child->name))
+      field = &password;
+
+    if (field != NULL) {
+
+      xml_str = xmlNodeGetContent (child);
+      if (xml_str != NULL) {
+
+	*field = (const char*)xml_str;
+	xmlFree (xml_str);
+      }
+      else if (field == &name)
+	name = _("Unnamed");
+    }
+  }
+
+  {
+    std::stringstream str;
+
+    str << (protocol_name == "SIP" ? "sip:" : "h323:") << user;
+    if (user.find ("@") == string::npos)
+      str << "@" << host;
+    aor = str.str ();
+  }
+
+  decide_type ();
+}
+
+
+void
+Opal::Account::decide_type ()
+{
   if (host == "ekiga.net")
     type = Account::Ekiga;
   else if (host == "sip.diamondcard.us")
     type = Account::DiamondCard;
-  else if (get_protocol_name () == "SIP")
+  else if (protocol_name == "SIP")
     type = Account::SIP;
   else
     type = Account::H323;
@@ -187,6 +187,9 @@ public:
 
     /* This part of the api is the implementation of Ekiga::Heap */
     void visit_presentities (boost::function1<bool, Ekiga::PresentityPtr > visitor) const;
+
+    /* returns the presentity with that uri, if there's one */
+    Opal::PresentityPtr find_presentity (const std::string uri) const;
     bool populate_menu_for_group (const std::string name,
 				  Ekiga::MenuBuilder& builder);
 
@@ -225,7 +228,20 @@ private:
     std::string aid;
     mutable std::string status;  // the state, as a string
     int message_waiting_number;
+
+    /* the fields of the XML node, parsed once by parse_node when the node
+     * is loaded or edited instead of each time they are needed
+     */
+    void parse_node ();
+    std::string name;
+    std::string host;
+    std::string user;
+    std::string auth_user;
+    std::string password;
     std::string protocol_name;
+    std::string aor;
+    unsigned timeout;
+    bool enabled;
 
     mutable bool failed_registration_already_notified;
 
@@ -242,6 +258,11 @@ private:
     void presence_status_in_main (std::string uri,
 				  std::string presence,
 				  std::string status) const;
+    static bool set_presence_and_status (Opal::PresentityPtr pres,
+					 std::string presence,
+					 std::string status);
+    /* the RefLister index of the presentities by uri */
+    int uri_index;
     void when_presentity_removed (boost::shared_ptr<Opal::Presentity> pres);
     void when_presentity_updated (boost::shared_ptr<Opal::Presentity> pres);
 
@@ -62,6 +62,9 @@ Opal::Bank::Bank (Ekiga::ServiceCore& core):
   std::list<std::string> accounts;
   protocols_settings = new Ekiga::Settings (PROTOCOLS_SCHEMA);
 
+  aor_index = Ekiga::RefLister<Opal::Account>::add_index (boost::bind (&Opal::Account::get_aor, _1));
+  host_index = Ekiga::RefLister<Opal::Account>::add_index (boost::bind (&Opal::Account::get_host, _1));
+
   const std::string raw = protocols_settings->get_string ("accounts");
 
   doc = boost::shared_ptr<xmlDoc> (xmlRecoverMemory (raw.c_str (), raw.length ()), xmlFreeDoc);
@@ -347,14 +350,12 @@ Opal::Bank::find_account (const std::string& aor)
 {
   AccountPtr result;
 
-  for (iterator iter = begin ();
-       iter != end ();
-       ++iter) {
-    if (aor.find ("@") != std::string::npos && (*iter)->get_aor () == aor)  // find by account name+host (aor)
-        return *iter;
-    else if ((*iter)->get_host () == aor)  // find by host
-      return *iter;
-  }
+  if (aor.find ("@") != std::string::npos)  // find by account name+host (aor)
+    result = Ekiga::RefLister<Opal::Account>::find_object (aor_index, aor);
+
+  if ( !result)  // find by host
+    result = Ekiga::RefLister<Opal::Account>::find_object (host_index, aor);
+
   return result;
 }
 
@@ -472,38 +473,17 @@ Opal::Bank::existing_groups () const
   return result;
 }
 
-struct find_presentity_helper
-{
-  find_presentity_helper (const std::string uri_): uri(uri_)
-  {}
-
-  bool operator() (Ekiga::PresentityPtr pres)
-  {
-    Opal::PresentityPtr presentity = boost::dynamic_pointer_cast<Opal::Presentity> (pres);
-
-    if (presentity && presentity->get_uri () == uri)
-      result = presentity;
-
-    return !result;
-  }
-
-  std::string uri;
-  Ekiga::PresentityPtr result;
-};
-
 Ekiga::PresentityPtr
 Opal::Bank::find_presentity_for_uri (const std::string uri) const
 {
-  find_presentity_helper helper(uri);
+  Ekiga::PresentityPtr result;
 
   for (const_iterator iter = begin ();
-       iter != end () && !helper.result;
-       ++iter) {
-
-    (*iter)->visit_presentities(boost::ref(helper));
-  }
+       iter != end () && !result;
+       ++iter)
+    result = (*iter)->find_presentity (uri);
 
-  return helper.result;
+  return result;
 }
 
 void
@@ -169,6 +169,10 @@ private:
     void update_sip_endpoint_aor_map ();
 
     Ekiga::Settings *protocols_settings;
+
+    /* the RefLister indexes used by find_account */
+    int aor_index;
+    int host_index;
   };
 
   /**
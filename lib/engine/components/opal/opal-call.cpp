@@ -37,8 +37,10 @@
 
 #include <cctype>
 #include <algorithm>
+#include <set>
 
 #include <glib/gi18n.h>
+#include <glib/gstdio.h>
 #include <opal/opal.h>
 #include <opal/pcss.h>
 #include <sip/sippdu.h>
@@ -49,9 +51,48 @@
 #include "notification-core.h"
 #include "call-core.h"
 #include "runtime.h"
+#include "ekiga-settings.h"
+
+/* only the statistics of the latest calls are kept on disk */
+#define CALL_STATISTICS_MAX_SAVED 100
 
 using namespace Opal;
 
+/* The files are named after the start of the call, so sorting them by
+ * name sorts them by age : forget the oldest calls, both files of each.
+ */
+static void
+prune_saved_statistics (const gchar* dir)
+{
+  GDir* gdir = g_dir_open (dir, 0, NULL);
+  const gchar* name = NULL;
+  std::set<std::string> calls;
+
+  if (gdir == NULL)
+    return;
+
+  while ((name = g_dir_read_name (gdir)) != NULL) {
+
+    std::string base = name;
+    std::string::size_type dot = base.rfind ('.');
+    if (dot != std::string::npos)
+      calls.insert (base.substr (0, dot));
+  }
+  g_dir_close (gdir);
+
+  while (calls.size () > CALL_STATISTICS_MAX_SAVED) {
+
+    const std::string oldest = *calls.begin ();
+    gchar* filename = g_build_filename (dir, (oldest + ".csv").c_str (), NULL);
+    g_unlink (filename);
+    g_free (filename);
+    filename = g_build_filename (dir, (oldest + ".json").c_str (), NULL);
+    g_unlink (filename);
+    g_free (filename);
+    calls.erase (calls.begin ());
+  }
+}
+
 static void
 strip_special_chars (std::string& str, char* special_chars, bool start)
 {
@@ -567,6 +608,20 @@ Opal::Call::OnOpenMediaStream (OpalMediaStream & stream)
   std::transform (stream_name.begin (), stream_name.end (), stream_name.begin (), (int (*) (int)) toupper);
   is_transmitting = !stream.IsSource ();
 
+  {
+    PWaitAndSignal m(stats_mutex);
+    Ekiga::StreamStatistics& stream_statistics = (type == Audio
+						  ? (is_transmitting ? statistics.transmitted_audio : statistics.received_audio)
+						  : (is_transmitting ? statistics.transmitted_video : statistics.received_video));
+
+    stream_statistics.codec = stream_name;
+    if (type == Video) {
+
+      stream_statistics.width = stream.GetMediaFormat ().GetOptionInteger (OpalVideoFormat::FrameWidthOption ());
+      stream_statistics.height = stream.GetMediaFormat ().GetOptionInteger (OpalVideoFormat::FrameHeightOption ());
+    }
+  }
+
   Ekiga::Runtime::run_in_main (boost::bind (boost::ref (stream_opened), stream_name, type, is_transmitting));
 }
 
@@ -615,6 +670,14 @@ Opal::Call::OnRTPStatistics (const OpalConnection & /* connection */,
     out_of_order_a = session.GetPacketsOutOfOrder ();
 
     jitter = session.GetJitterBufferSize () / max ((unsigned) session.GetJitterTimeUnits (), (unsigned) 8);
+
+    statistics.received_audio.bandwidth = re_a_bw;
+    statistics.transmitted_audio.bandwidth = tr_a_bw;
+    statistics.received_audio.packets = total_a;
+    statistics.received_audio.lost_packets = lost_a;
+    statistics.received_audio.late_packets = too_late_a;
+    statistics.received_audio.out_of_order_packets = out_of_order_a;
+    statistics.received_audio.jitter = jitter;
   }
   else {
 
@@ -637,11 +700,30 @@ Opal::Call::OnRTPStatistics (const OpalConnection & /* connection */,
     lost_v = session.GetPacketsLost ();
     too_late_v = session.GetPacketsTooLate ();
     out_of_order_v = session.GetPacketsOutOfOrder ();
+
+    statistics.received_video.bandwidth = re_v_bw;
+    statistics.transmitted_video.bandwidth = tr_v_bw;
+    statistics.received_video.packets = total_v;
+    statistics.received_video.lost_packets = lost_v;
+    statistics.received_video.late_packets = too_late_v;
+    statistics.received_video.out_of_order_packets = out_of_order_v;
   }
 
-  lost_packets = (lost_a + lost_v) / max ((unsigned long)(total_a + total_v), (unsigned long) 1);
-  late_packets = (too_late_a + too_late_v) / max ((unsigned long)(total_a + total_v), (unsigned long) 1);
-  out_of_order_packets = (out_of_order_a + out_of_order_v) / max ((unsigned long)(total_a + total_v), (unsigned long) 1);
+  /* percentages, computed in floating point : the integer ratio was 0 */
+  double total = max ((unsigned long)(total_a + total_v), (unsigned long) 1);
+  lost_packets = 100.0 * (lost_a + lost_v) / total;
+  late_packets = 100.0 * (too_late_a + too_late_v) / total;
+  out_of_order_packets = 100.0 * (out_of_order_a + out_of_order_v) / total;
+
+  /* the audio and video sessions are reported separately : push a
+   * snapshot of both at most once a second */
+  if ((PTime () - last_statistics_tick).GetMilliSeconds () >= 1000) {
+
+    last_statistics_tick = PTime ();
+    if (start_time.IsValid ())
+      statistics.elapsed = (last_statistics_tick - start_time).GetSeconds ();
+    Ekiga::Runtime::run_in_main (boost::bind (&Opal::Call::emit_statistics_in_main, this, statistics));
+  }
 }
 
 
@@ -697,6 +779,7 @@ Opal::Call::emit_missed_in_main ()
 void
 Opal::Call::emit_cleared_in_main (const std::string reason)
 {
+  save_statistics ();
   cleared (reason);
   removed ();
 }
@@ -724,3 +807,51 @@ Opal::Call::emit_retrieved_in_main ()
 {
   retrieved ();
 }
+
+void
+Opal::Call::emit_statistics_in_main (Ekiga::CallStatistics _statistics)
+{
+  statistics_history.push_back (_statistics);
+  statistics_updated (_statistics);
+}
+
+void
+Opal::Call::save_statistics () const
+{
+  boost::shared_ptr<Ekiga::Settings> call_options_settings (new Ekiga::Settings (CALL_OPTIONS_SCHEMA));
+  gchar* dir = NULL;
+  gchar* filename = NULL;
+  char stamp[32];
+  time_t start = get_start_time ();
+  std::string base;
+
+  if (statistics_history.size () == 0
+      || !call_options_settings->get_bool ("save-call-statistics"))
+    return;
+
+  dir = g_build_filename (g_get_user_data_dir (), PACKAGE_NAME, "call-statistics", NULL);
+  g_mkdir_with_parents (dir, 0700);
+
+  /* the file names are the start time and the remote uri */
+  strftime (stamp, sizeof (stamp), "%Y%m%d-%H%M%S", localtime (&start));
+  base = std::string (stamp) + "-" + remote_uri;
+  for (std::string::iterator iter = base.begin (); iter != base.end (); ++iter)
+    if (!g_ascii_isalnum (*iter) && *iter != '-' && *iter != '.' && *iter != '@')
+      *iter = '_';
+
+  filename = g_build_filename (dir, (base + ".csv").c_str (), NULL);
+  std::string csv = statistics_history.to_csv ();
+  if (!g_file_set_contents (filename, csv.c_str (), csv.length (), NULL))
+    PTRACE (2, "Opal::Call\tCould not save the call statistics to " << filename);
+  g_free (filename);
+
+  filename = g_build_filename (dir, (base + ".json").c_str (), NULL);
+  std::string json = statistics_history.to_json ();
+  if (!g_file_set_contents (filename, json.c_str (), json.length (), NULL))
+    PTRACE (2, "Opal::Call\tCould not save the call statistics to " << filename);
+  g_free (filename);
+
+  prune_saved_statistics (dir);
+
+  g_free (dir);
+}
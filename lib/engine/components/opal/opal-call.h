@@ -166,6 +166,7 @@ public:
     double get_lost_packets () const { return lost_packets; }
     double get_late_packets () const { return late_packets; }
     double get_out_of_order_packets () const { return out_of_order_packets; }
+    const Ekiga::CallStatisticsHistory& get_statistics_history () const { return statistics_history; }
 
 
     /*
@@ -273,6 +274,13 @@ private:
     unsigned out_of_order_v;
     unsigned total_v;
 
+    Ekiga::CallStatistics statistics; // the latest values, under stats_mutex
+    PTime last_statistics_tick;
+    Ekiga::CallStatisticsHistory statistics_history; // only used in the main thread
+
+    /* writes the history as CSV and JSON files when the call ends */
+    void save_statistics () const;
+
     bool outgoing;
 
 private:
@@ -284,6 +292,7 @@ private:
     void emit_ringing_in_main ();
     void emit_held_in_main ();
     void emit_retrieved_in_main ();
+    void emit_statistics_in_main (Ekiga::CallStatistics statistics);
   };
 };
 
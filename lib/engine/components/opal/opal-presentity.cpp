@@ -104,6 +104,7 @@ Opal::Presentity::Presentity (boost::weak_ptr<Ekiga::PresenceCore> presence_core
   node(node_),
   presence("unknown")
 {
+  parse_node ();
 }
 
 
@@ -115,31 +116,6 @@ Opal::Presentity::~Presentity ()
 const std::string
 Opal::Presentity::get_name () const
 {
-  std::string name;
-  xmlChar* xml_str = NULL;
-
-  for (xmlNodePtr child = node->children ;
-       child != NULL ;
-       child = child->next) {
-
-    if (child->type == XML_ELEMENT_NODE
-        && child->name != NULL) {
-
-      if (xmlStrEqual (BAD_CAST ("name"), child->name)) {
-
-	xml_str = xmlNodeGetContent (child);
-	if (xml_str != NULL) {
-
-	  name = (const char*)xml_str;
-	  xmlFree (xml_str);
-	} else {
-
-	  name = _("Unnamed");
-	}
-      }
-    }
-  }
-
   return name;
 }
 
@@ -161,27 +137,6 @@ Opal::Presentity::get_status () const
 const std::set<std::string>
 Opal::Presentity::get_groups () const
 {
-  std::set<std::string> groups;
-
-  for (xmlNodePtr child = node->children ;
-       child != NULL ;
-       child = child->next) {
-
-    if (child->type == XML_ELEMENT_NODE
-        && child->name != NULL) {
-
-      if (xmlStrEqual (BAD_CAST ("group"), child->name)) {
-
-	xmlChar* xml_str = xmlNodeGetContent (child);
-	if (xml_str != NULL) {
-
-	  groups.insert ((const char*) xml_str);
-	  xmlFree (xml_str);
-	}
-      }
-    }
-  }
-
   return groups;
 }
 
@@ -189,16 +144,6 @@ Opal::Presentity::get_groups () const
 const std::string
 Opal::Presentity::get_uri () const
 {
-  std::string uri;
-  xmlChar* xml_str = NULL;
-
-  xml_str = xmlGetProp (node, BAD_CAST "uri");
-  if (xml_str != NULL) {
-
-    uri = (const char*)xml_str;
-    xmlFree (xml_str);
-  }
-
   return uri;
 }
 
@@ -355,6 +300,7 @@ Opal::Presentity::edit_presentity_form_submitted (bool submitted,
     }
   }
 
+  parse_node ();
   updated ();
   trigger_saving ();
 }
@@ -417,11 +363,62 @@ Opal::Presentity::rename_group (const std::string old_name,
 
   }
 
+  parse_node ();
   updated ();
   trigger_saving ();
 }
 
 
+void
+Opal::Presentity::parse_node ()
+{
+  xmlChar* xml_str = NULL;
+
+  name = "";
+  uri = "";
+  groups.clear ();
+
+  xml_str = xmlGetProp (node, BAD_CAST "uri");
+  if (xml_str != NULL) {
+
+    uri = (const char*)xml_str;
+    xmlFree (xml_str);
+  }
+
+  for (xmlNodePtr child = node->children ;
+       child != NULL ;
+       child = child->next) {
+
+    if (child->type == XML_ELEMENT_NODE
+        && child->name != NULL) {
+
+      if (xmlStrEqual (BAD_CAST ("name"), child->name)) {
+
+	xml_str = xmlNodeGetContent (child);
+	if (xml_str != NULL) {
+
+	  name = (const char*)xml_str;
+	  xmlFree (xml_str);
+	} else {
+
+	  name = _("Unnamed");
+	}
+      }
+
+      if (xmlStrEqual (BAD_CAST ("group"), child->name)) {
+
+	xml_str = xmlNodeGetContent (child);
+	if (xml_str != NULL) {
+
+	  groups.insert ((const char*) xml_str);
+	  xmlFree (xml_str);
+	}
+      }
+    }
+  }
+}
+
+
 void
 Opal::Presentity::remove ()
 {
@@ -127,6 +127,12 @@ namespace Opal
     boost::function0<std::set<std::string> > existing_groups;
     xmlNodePtr node;
 
+    /* the node's content, parsed when it is loaded or edited */
+    void parse_node ();
+    std::string name;
+    std::string uri;
+    std::set<std::string> groups;
+
     std::string presence;
     std::string status;
   };
@@ -44,18 +44,12 @@
 
 int PVideoOutputDevice_EKIGA::devices_nbr = 0;
 
-PMutex PVideoOutputDevice_EKIGA::videoDisplay_mutex;
+PMutex PVideoOutputDevice_EKIGA::devices_mutex;
 
 /* The Methods */
 PVideoOutputDevice_EKIGA::PVideoOutputDevice_EKIGA (boost::shared_ptr<Ekiga::VideoOutputCore> _videooutput_core):
   videooutput_core(_videooutput_core)
 {
-  PWaitAndSignal m(videoDisplay_mutex); /* FIXME: if it's really needed
-					 * then we may crash : it's wrong to
-					 * use 'core' from a thread -- mutex
-					 * or not mutex.
-					 */
-
   is_active = FALSE;
 
   /* Used to distinguish between input and output device. */
@@ -65,10 +59,7 @@ PVideoOutputDevice_EKIGA::PVideoOutputDevice_EKIGA (boost::shared_ptr<Ekiga::Vid
 
 PVideoOutputDevice_EKIGA::~PVideoOutputDevice_EKIGA()
 {
-  PWaitAndSignal m(videoDisplay_mutex); /* FIXME: if it's really needed
-					 * then we may crash : it's wrong to
-					 * have played with 'core' from a thread
-					 */
+  PWaitAndSignal m(devices_mutex);
 
   if (is_active) {
     devices_nbr--;
@@ -116,7 +107,7 @@ bool PVideoOutputDevice_EKIGA::SetFrameData (unsigned x,
                                              const BYTE * data,
                                              bool endFrame)
 {
-  PWaitAndSignal m(videoDisplay_mutex);
+  int nbr = 0;
 
   if (x > 0 || y > 0)
     return FALSE;
@@ -130,18 +121,28 @@ bool PVideoOutputDevice_EKIGA::SetFrameData (unsigned x,
   if (!endFrame)
     return FALSE;
 
-  if (!is_active) {
-    if (devices_nbr == 0) {
-      videooutput_core->start();
+  {
+    PWaitAndSignal m(devices_mutex);
+
+    if (!is_active) {
+
+      if (devices_nbr == 0) {
+        videooutput_core->start();
+      }
+      is_active = TRUE;
+      devices_nbr++;
     }
-    is_active = TRUE;
-    devices_nbr++;
+    nbr = devices_nbr;
   }
 
-  videooutput_core->set_frame_data ((const char*) data,
-                                    width, height,
-                                    (Ekiga::VideoOutputManager::VideoView) device_id,
-                                    devices_nbr);
+  /* This is the only copy of the decoded frame : the displays get the
+   * pooled frame itself
+   */
+  Ekiga::VideoFramePtr frame = videooutput_core->get_frame (width, height);
+  memcpy (frame->data, data, frame->get_size ());
+  videooutput_core->set_frame (frame,
+                               (Ekiga::VideoOutputManager::VideoView) device_id,
+                               nbr);
   return TRUE;
 }
 
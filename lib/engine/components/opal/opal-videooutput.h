@@ -131,7 +131,10 @@ class PVideoOutputDevice_EKIGA : public PVideoOutputDevice
   static int devices_nbr; /* The number of devices opened */
   int device_id;          /* The current device : local or remote */
 
-  static PMutex videoDisplay_mutex;  
+  /* Only protects devices_nbr and the start/stop of the video output :
+   * frames from the different devices never wait for each other
+   */
+  static PMutex devices_mutex;
 
   bool is_active;
 
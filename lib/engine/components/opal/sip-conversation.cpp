@@ -53,13 +53,7 @@ SIP::Conversation::Conversation (boost::shared_ptr<Ekiga::PresenceCore> _core,
 void
 SIP::Conversation::visit_messages (boost::function1<bool, const Ekiga::Message&> visitor) const
 {
-  for (std::list<Ekiga::Message>::const_iterator iter = messages.begin();
-       iter != messages.end ();
-       ++iter) {
-
-    if (!visitor(*iter))
-      break;
-  }
+  messages.visit (visitor);
 }
 
 bool
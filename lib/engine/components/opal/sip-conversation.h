@@ -37,6 +37,7 @@
 #define __SIP_CONVERSATION_H__
 
 #include "conversation.h"
+#include "message-history.h"
 #include "presence-core.h"
 
 #include "sip-heap.h"
@@ -64,6 +65,14 @@ namespace SIP {
     { return status; }
 
     void visit_messages (boost::function1<bool, const Ekiga::Message&> visitor) const;
+
+    unsigned int get_older_messages_count () const
+    { return messages.get_older_count (); }
+
+    void visit_messages_range (unsigned int first,
+			       unsigned int count,
+			       boost::function1<bool, const Ekiga::Message&> visitor) const
+    { messages.visit_range (first, count, visitor); }
     bool send_message (const Ekiga::Message::payload_type& payload);
 
     int get_unread_messages_count () const
@@ -89,7 +98,7 @@ namespace SIP {
     boost::function1<bool, Ekiga::Message::payload_type> sender;
     boost::shared_ptr<Heap> heap;
     int unreads;
-    std::list<Ekiga::Message> messages;
+    Ekiga::MessageHistory messages;
   };
 
   typedef typename boost::shared_ptr<Conversation> ConversationPtr;
@@ -36,80 +36,269 @@
  */
 
 
+#include <algorithm>
+#include <list>
+#include <map>
+#include <set>
+
 #include <glib/gi18n.h>
 #include "config.h"
 #include "sip-endpoint.h"
 #include "chat-core.h"
 
+/* The number of threads doing the (un)registrations */
+#define SUBSCRIBER_POOL_WORKERS 2
+
+/* The minimum delay between two (un)registrations (ms) */
+#define SUBSCRIBER_POOL_INTERVAL 100
+
+/* Failed registrations are tried again after 1s, 2s, 4s... at most
+ * that many times
+ */
+#define SUBSCRIBER_POOL_MAX_RETRIES 6
+
 namespace Opal {
 
   namespace Sip {
 
+    /* A registration or unregistration waiting for a worker */
+    struct subscriber_job
+    {
+      std::string username;
+      std::string host;
+      std::string authentication_username;
+      std::string password;
+      bool is_enabled;
+      SIPRegister::CompatibilityModes compat_mode;
+      unsigned timeout;
+      std::string aor;
+      bool registering;
+      PSafePtr<OpalPresentity> presentity;
+      PTimeInterval not_before; // on the PTimer::Tick () clock
+    };
+
+    class subscriber;
+
+    /* The (un)registrations are queued by AOR, so that a new request for
+     * an AOR replaces the one still waiting, and are run by a few workers,
+     * at most one at a time for a given AOR, and not too fast.
+     *
+     * When the pool is destroyed, the waiting registrations are dropped,
+     * but the waiting unregistrations are still sent, without delay,
+     * before the workers stop.
+     */
+    class subscriber_pool
+    {
+    public:
+      subscriber_pool (Opal::Sip::EndPoint & _manager);
+
+      ~subscriber_pool ();
+
+      void push (const subscriber_job & job);
+
+      /* used by the workers */
+      bool pop (subscriber_job & job);
+
+      void done (const subscriber_job & job,
+                 bool success);
+
+      Opal::Sip::EndPoint & manager;
+
+    private:
+      PMutex queue_mutex;
+      PSyncPoint job_available;
+      bool end_pool;
+
+      std::list<std::string> order;
+      std::map<std::string, subscriber_job> pending;
+      std::set<std::string> running;
+      std::map<std::string, unsigned> failures;
+      PTimeInterval next_start;
+
+      std::list<subscriber *> workers;
+    };
+
     class subscriber : public PThread
     {
       PCLASSINFO(subscriber, PThread);
 
     public:
-      subscriber (std::string _username,
-		  std::string _host,
-		  std::string _authentication_username,
-		  std::string _password,
-		  bool _is_enabled,
-		  SIPRegister::CompatibilityModes _compat_mode,
-		  unsigned _timeout,
-		  std::string _aor,
-                  Opal::Sip::EndPoint & _manager,
-		  bool _registering,
-                  const PSafePtr<OpalPresentity> & _presentity)
-        : PThread (1000, AutoDeleteThread),
-	  username(_username),
-	  host(_host),
-	  authentication_username(_authentication_username),
-	  password(_password),
-	  is_enabled(_is_enabled),
-	  compat_mode(_compat_mode),
-	  timeout(_timeout),
-	  aor(_aor),
-	  manager (_manager),
-	  registering (_registering),
-	  presentity (_presentity)
+      subscriber (subscriber_pool & _pool)
+        : PThread (1000, NoAutoDeleteThread, NormalPriority, "SIP subscriber"),
+	  pool (_pool)
       {
         this->Resume ();
       };
 
       void Main ()
       {
-	if (registering) {
-
-          if (presentity && !presentity->IsOpen ())
-            presentity->Open ();
-	  manager.Register (username, host, authentication_username, password, is_enabled, compat_mode, timeout);
-	}
-        else {
-	  manager.Unregister (aor);
-
-          if (presentity && presentity->IsOpen ())
-            presentity->Close ();
-	}
+        subscriber_job job;
+
+        while (pool.pop (job)) {
+
+          bool success = true;
+
+          if (job.registering) {
+
+            if (job.presentity && !job.presentity->IsOpen ())
+              job.presentity->Open ();
+            success = pool.manager.Register (job.username, job.host, job.authentication_username, job.password, job.is_enabled, job.compat_mode, job.timeout);
+          }
+          else {
+            pool.manager.Unregister (job.aor);
+
+            if (job.presentity && job.presentity->IsOpen ())
+              job.presentity->Close ();
+          }
+
+          pool.done (job, success);
+          job.presentity.SetNULL ();
+        }
       };
 
     private:
-      std::string username;
-      std::string host;
-      std::string authentication_username;
-      std::string password;
-      bool is_enabled;
-      SIPRegister::CompatibilityModes compat_mode;
-      unsigned timeout;
-      std::string aor;
-      Opal::Sip::EndPoint & manager;
-      bool registering;
-      const PSafePtr<OpalPresentity> & presentity;
+      subscriber_pool & pool;
     };
   };
 };
 
 
+Opal::Sip::subscriber_pool::subscriber_pool (Opal::Sip::EndPoint & _manager)
+  : manager (_manager), end_pool (false), next_start (0)
+{
+  for (int i = 0 ; i < SUBSCRIBER_POOL_WORKERS ; i++)
+    workers.push_back (new subscriber (*this));
+}
+
+Opal::Sip::subscriber_pool::~subscriber_pool ()
+{
+  {
+    PWaitAndSignal m(queue_mutex);
+    end_pool = true;
+  }
+
+  for (std::list<subscriber *>::iterator iter = workers.begin ();
+       iter != workers.end ();
+       ++iter) {
+
+    // one signal only wakes one worker up, so keep signalling
+    while (!(*iter)->WaitForTermination (SUBSCRIBER_POOL_INTERVAL))
+      job_available.Signal ();
+    delete *iter;
+  }
+}
+
+void
+Opal::Sip::subscriber_pool::push (const subscriber_job & job)
+{
+  {
+    PWaitAndSignal m(queue_mutex);
+
+    if (pending.find (job.aor) == pending.end ())
+      order.push_back (job.aor);
+    else
+      PTRACE(4, "EndPoint\tReplacing the pending (un)registration of " << job.aor);
+
+    pending[job.aor] = job;
+  }
+
+  job_available.Signal ();
+}
+
+bool
+Opal::Sip::subscriber_pool::pop (subscriber_job & job)
+{
+  while (true) {
+
+    PTimeInterval wait = PMaxTimeInterval;
+
+    {
+      PWaitAndSignal m(queue_mutex);
+      PTimeInterval now = PTimer::Tick ();
+
+      if (end_pool) {
+
+        // registering is pointless now, unregistering still matters
+        for (std::list<std::string>::iterator iter = order.begin ();
+             iter != order.end ();) {
+
+          if (pending[*iter].registering) {
+
+            pending.erase (*iter);
+            iter = order.erase (iter);
+          }
+          else
+            ++iter;
+        }
+
+        if (order.empty ())
+          return false;
+      }
+
+      for (std::list<std::string>::iterator iter = order.begin ();
+           iter != order.end ();
+           ++iter) {
+
+        if (running.find (*iter) != running.end ())
+          continue;
+
+        subscriber_job & candidate = pending[*iter];
+        PTimeInterval due = end_pool ? now : std::max (candidate.not_before, next_start);
+
+        if (due <= now) {
+
+          job = candidate;
+          pending.erase (*iter);
+          running.insert (*iter);
+          order.erase (iter);
+          next_start = now + PTimeInterval (SUBSCRIBER_POOL_INTERVAL);
+          return true;
+        }
+
+        wait = std::min (wait, due - now);
+      }
+    }
+
+    if (wait == PMaxTimeInterval)
+      job_available.Wait ();
+    else
+      job_available.Wait (wait);
+  }
+}
+
+void
+Opal::Sip::subscriber_pool::done (const subscriber_job & job,
+                                  bool success)
+{
+  {
+    PWaitAndSignal m(queue_mutex);
+
+    running.erase (job.aor);
+
+    if (success || !job.registering || end_pool)
+      failures.erase (job.aor);
+    else if (pending.find (job.aor) == pending.end ()) {
+
+      // retry later, unless a newer request came in the meantime
+      unsigned count = ++failures[job.aor];
+
+      if (count <= SUBSCRIBER_POOL_MAX_RETRIES) {
+
+        PTRACE(4, "EndPoint\tRegistration of " << job.aor << " failed, retry #" << count);
+        subscriber_job retry = job;
+        retry.not_before = PTimer::Tick () + PTimeInterval (1000 << (count - 1));
+        pending[job.aor] = retry;
+        order.push_back (job.aor);
+      }
+      else
+        failures.erase (job.aor);
+    }
+  }
+
+  // the AOR may have another request waiting
+  job_available.Signal ();
+}
+
 
 /* The class */
 Opal::Sip::EndPoint::EndPoint (Opal::CallManager & _manager,
@@ -117,6 +306,8 @@ Opal::Sip::EndPoint::EndPoint (Opal::CallManager & _manager,
   SIPEndPoint (_manager),
   manager (_manager)
 {
+  subscribers = new subscriber_pool (*this);
+
   boost::shared_ptr<Ekiga::ChatCore> chat_core = core.get<Ekiga::ChatCore> ("chat-core");
   boost::shared_ptr<Ekiga::PresenceCore> presence_core = core.get<Ekiga::PresenceCore> ("presence-core");
 
@@ -151,6 +342,7 @@ Opal::Sip::EndPoint::EndPoint (Opal::CallManager & _manager,
 
 Opal::Sip::EndPoint::~EndPoint ()
 {
+  delete subscribers;
 }
 
 void
@@ -398,17 +590,7 @@ Opal::Sip::EndPoint::subscribe (const Opal::Account & account,
   if (account.get_protocol_name () != "SIP")
     return false;
 
-  new subscriber (account.get_username (),
-		  account.get_host (),
-		  account.get_authentication_username (),
-		  account.get_password (),
-		  account.is_enabled (),
-		  account.get_compat_mode (),
-		  account.get_timeout (),
-		  account.get_aor (),
-		  *this,
-                  true,
-                  presentity);
+  push_subscriber_job (account, true, presentity);
   return true;
 }
 
@@ -420,22 +602,35 @@ Opal::Sip::EndPoint::unsubscribe (const Opal::Account & account,
   if (account.get_protocol_name () != "SIP")
     return false;
 
-  new subscriber (account.get_username (),
-		  account.get_host (),
-		  account.get_authentication_username (),
-		  account.get_password (),
-		  account.is_enabled (),
-		  account.get_compat_mode (),
-		  account.get_timeout (),
-		  account.get_aor (),
-		  *this,
-                  false,
-                  presentity);
+  push_subscriber_job (account, false, presentity);
   return true;
 }
 
 
 void
+Opal::Sip::EndPoint::push_subscriber_job (const Opal::Account & account,
+                                          bool registering,
+                                          const PSafePtr<OpalPresentity> & presentity)
+{
+  subscriber_job job;
+
+  job.username = account.get_username ();
+  job.host = account.get_host ();
+  job.authentication_username = account.get_authentication_username ();
+  job.password = account.get_password ();
+  job.is_enabled = account.is_enabled ();
+  job.compat_mode = account.get_compat_mode ();
+  job.timeout = account.get_timeout ();
+  job.aor = account.get_aor ();
+  job.registering = registering;
+  job.presentity = presentity;
+  job.not_before = 0;
+
+  subscribers->push (job);
+}
+
+
+bool
 Opal::Sip::EndPoint::Register (const std::string username,
 			       const std::string host_,
 			       const std::string auth_username,
@@ -476,7 +671,10 @@ Opal::Sip::EndPoint::Register (const std::string username,
     status.m_addressofRecord = PString (aor.str ());
 
     OnRegistrationStatus (status);
+    return false;
   }
+
+  return true;
 }
 
 void
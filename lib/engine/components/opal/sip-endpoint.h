@@ -58,6 +58,8 @@ namespace Opal {
 
   namespace Sip {
 
+    class subscriber_pool;
+
     class EndPoint : public SIPEndPoint,
 		     public Ekiga::Service,
 		     public Ekiga::CallProtocolManager
@@ -137,7 +139,8 @@ namespace Opal {
       void update_aor_map (std::map<std::string, std::string> _accounts);
 
       /* OPAL Methods */
-      void Register (const std::string username,
+      /* returns false if the registration failed right away */
+      bool Register (const std::string username,
 		     const std::string host,
 		     const std::string auth_username,
 		     const std::string password,
@@ -177,6 +180,13 @@ namespace Opal {
       void push_message_in_main (const std::string uri,
 				 const Ekiga::Message msg);
 
+      void push_subscriber_job (const Opal::Account & account,
+                                bool registering,
+                                const PSafePtr<OpalPresentity> & presentity);
+
+      // the (un)registrations are done by a few threads
+      subscriber_pool* subscribers;
+
       PMutex aorMutex;
       std::map<std::string, std::string> accounts;
 
@@ -0,0 +1,527 @@
+
+/*
+ * Ekiga -- A VoIP and Video-Conferencing application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+/*
+ *                         audio-dsp.cpp  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014
+ *   description          : Implementation of small DSP kernels working on
+ *                          16 bit PCM (level metering, gain)
+ *
+ */
+
+#include <math.h>
+
+#include "audio-dsp.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define AUDIO_DSP_X86 1
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define AUDIO_DSP_NEON 1
+#include <arm_neon.h>
+#endif
+
+/* The vector kernels sum absolute values pairwise into 32 bit lanes,
+ * which can take that many rounds before they may overflow
+ */
+#define AUDIO_DSP_BLOCK_ROUNDS 16384
+
+using namespace Ekiga;
+
+typedef void (*measure_func) (const gint16* samples,
+                              unsigned count,
+                              AudioDSP::Levels& levels);
+
+typedef void (*gain_func) (gint16* samples,
+                           unsigned count,
+                           unsigned gain);
+
+typedef void (*mix_func) (gint16* samples,
+                          const gint16* other,
+                          unsigned count);
+
+struct Kernels
+{
+  const char* name;
+  measure_func measure;
+  gain_func gain;
+  mix_func mix;
+};
+
+
+/* Portable implementation, also used for the tails of the vector ones.
+ * Absolute values saturate at 32767, as the vector instructions do.
+ */
+
+static void
+measure_scalar (const gint16* samples,
+                unsigned count,
+                AudioDSP::Levels& levels)
+{
+  guint64 abs_sum = 0;
+  guint64 square_sum = 0;
+  unsigned peak = levels.peak;
+
+  for (unsigned i = 0 ; i < count ; i++) {
+
+    int value = samples[i];
+    unsigned abs_value = (value < 0) ? (unsigned) -value : (unsigned) value;
+
+    if (abs_value > 32767)
+      abs_value = 32767;
+
+    abs_sum += abs_value;
+    square_sum += (guint64) (value * value);
+    if (abs_value > peak)
+      peak = abs_value;
+  }
+
+  levels.abs_sum += abs_sum;
+  levels.square_sum += square_sum;
+  levels.peak = peak;
+}
+
+static void
+gain_scalar (gint16* samples,
+             unsigned count,
+             unsigned gain)
+{
+  for (unsigned i = 0 ; i < count ; i++) {
+
+    int value = (samples[i] * (int) gain) >> 12;
+
+    if (value > 32767)
+      value = 32767;
+    else if (value < -32768)
+      value = -32768;
+
+    samples[i] = (gint16) value;
+  }
+}
+
+static void
+mix_scalar (gint16* samples,
+            const gint16* other,
+            unsigned count)
+{
+  for (unsigned i = 0 ; i < count ; i++) {
+
+    int value = samples[i] + other[i];
+
+    if (value > 32767)
+      value = 32767;
+    else if (value < -32768)
+      value = -32768;
+
+    samples[i] = (gint16) value;
+  }
+}
+
+
+#ifdef AUDIO_DSP_X86
+
+__attribute__((target("sse2")))
+static void
+measure_sse2 (const gint16* samples,
+              unsigned count,
+              AudioDSP::Levels& levels)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+  const __m128i ones = _mm_set1_epi16 (1);
+  __m128i peak = zero;
+  __m128i square_sum = zero;
+  unsigned vector_count = count & ~7u;
+  unsigned i = 0;
+  guint32 abs_lanes[4];
+  guint64 square_lanes[2];
+  gint16 peak_lanes[8];
+
+  while (i < vector_count) {
+
+    unsigned block_end = MIN (vector_count, i + 8 * AUDIO_DSP_BLOCK_ROUNDS);
+    __m128i abs_sum = zero;
+
+    for ( ; i < block_end ; i += 8) {
+
+      __m128i value = _mm_loadu_si128 ((const __m128i*) (samples + i));
+      __m128i abs_value = _mm_max_epi16 (value, _mm_subs_epi16 (zero, value));
+      __m128i square = _mm_madd_epi16 (value, value); // unsigned, up to 2^31
+
+      peak = _mm_max_epi16 (peak, abs_value);
+      abs_sum = _mm_add_epi32 (abs_sum, _mm_madd_epi16 (abs_value, ones));
+      square_sum = _mm_add_epi64 (square_sum, _mm_unpacklo_epi32 (square, zero));
+      square_sum = _mm_add_epi64 (square_sum, _mm_unpackhi_epi32 (square, zero));
+    }
+
+    _mm_storeu_si128 ((__m128i*) abs_lanes, abs_sum);
+    levels.abs_sum += (guint64) abs_lanes[0] + abs_lanes[1] + abs_lanes[2] + abs_lanes[3];
+  }
+
+  _mm_storeu_si128 ((__m128i*) square_lanes, square_sum);
+  levels.square_sum += square_lanes[0] + square_lanes[1];
+
+  _mm_storeu_si128 ((__m128i*) peak_lanes, peak);
+  for (unsigned j = 0 ; j < 8 ; j++)
+    if ((unsigned) peak_lanes[j] > levels.peak)
+      levels.peak = peak_lanes[j];
+
+  measure_scalar (samples + vector_count, count - vector_count, levels);
+}
+
+__attribute__((target("sse2")))
+static void
+gain_sse2 (gint16* samples,
+           unsigned count,
+           unsigned gain)
+{
+  const __m128i factor = _mm_set1_epi16 ((gint16) gain);
+  unsigned vector_count = count & ~7u;
+
+  for (unsigned i = 0 ; i < vector_count ; i += 8) {
+
+    __m128i value = _mm_loadu_si128 ((const __m128i*) (samples + i));
+    __m128i low = _mm_mullo_epi16 (value, factor);
+    __m128i high = _mm_mulhi_epi16 (value, factor);
+    __m128i first = _mm_srai_epi32 (_mm_unpacklo_epi16 (low, high), 12);
+    __m128i second = _mm_srai_epi32 (_mm_unpackhi_epi16 (low, high), 12);
+
+    _mm_storeu_si128 ((__m128i*) (samples + i), _mm_packs_epi32 (first, second));
+  }
+
+  gain_scalar (samples + vector_count, count - vector_count, gain);
+}
+
+__attribute__((target("sse2")))
+static void
+mix_sse2 (gint16* samples,
+          const gint16* other,
+          unsigned count)
+{
+  unsigned vector_count = count & ~7u;
+
+  for (unsigned i = 0 ; i < vector_count ; i += 8) {
+
+    __m128i value = _mm_loadu_si128 ((const __m128i*) (samples + i));
+    __m128i added = _mm_loadu_si128 ((const __m128i*) (other + i));
+
+    _mm_storeu_si128 ((__m128i*) (samples + i), _mm_adds_epi16 (value, added));
+  }
+
+  mix_scalar (samples + vector_count, other + vector_count, count - vector_count);
+}
+
+__attribute__((target("avx2")))
+static void
+measure_avx2 (const gint16* samples,
+              unsigned count,
+              AudioDSP::Levels& levels)
+{
+  const __m256i zero = _mm256_setzero_si256 ();
+  const __m256i ones = _mm256_set1_epi16 (1);
+  __m256i peak = zero;
+  __m256i square_sum = zero;
+  unsigned vector_count = count & ~15u;
+  unsigned i = 0;
+  guint32 abs_lanes[8];
+  guint64 square_lanes[4];
+  gint16 peak_lanes[16];
+
+  while (i < vector_count) {
+
+    unsigned block_end = MIN (vector_count, i + 16 * AUDIO_DSP_BLOCK_ROUNDS);
+    __m256i abs_sum = zero;
+
+    for ( ; i < block_end ; i += 16) {
+
+      __m256i value = _mm256_loadu_si256 ((const __m256i*) (samples + i));
+      __m256i abs_value = _mm256_max_epi16 (value, _mm256_subs_epi16 (zero, value));
+      __m256i square = _mm256_madd_epi16 (value, value); // unsigned, up to 2^31
+
+      peak = _mm256_max_epi16 (peak, abs_value);
+      abs_sum = _mm256_add_epi32 (abs_sum, _mm256_madd_epi16 (abs_value, ones));
+      square_sum = _mm256_add_epi64 (square_sum, _mm256_unpacklo_epi32 (square, zero));
+      square_sum = _mm256_add_epi64 (square_sum, _mm256_unpackhi_epi32 (square, zero));
+    }
+
+    _mm256_storeu_si256 ((__m256i*) abs_lanes, abs_sum);
+    for (unsigned j = 0 ; j < 8 ; j++)
+      levels.abs_sum += abs_lanes[j];
+  }
+
+  _mm256_storeu_si256 ((__m256i*) square_lanes, square_sum);
+  levels.square_sum += square_lanes[0] + square_lanes[1] + square_lanes[2] + square_lanes[3];
+
+  _mm256_storeu_si256 ((__m256i*) peak_lanes, peak);
+  for (unsigned j = 0 ; j < 16 ; j++)
+    if ((unsigned) peak_lanes[j] > levels.peak)
+      levels.peak = peak_lanes[j];
+
+  measure_scalar (samples + vector_count, count - vector_count, levels);
+}
+
+__attribute__((target("avx2")))
+static void
+gain_avx2 (gint16* samples,
+           unsigned count,
+           unsigned gain)
+{
+  const __m256i factor = _mm256_set1_epi16 ((gint16) gain);
+  unsigned vector_count = count & ~15u;
+
+  for (unsigned i = 0 ; i < vector_count ; i += 16) {
+
+    __m256i value = _mm256_loadu_si256 ((const __m256i*) (samples + i));
+    __m256i low = _mm256_mullo_epi16 (value, factor);
+    __m256i high = _mm256_mulhi_epi16 (value, factor);
+    // unpack and pack both work within 128 bit lanes, so the order is kept
+    __m256i first = _mm256_srai_epi32 (_mm256_unpacklo_epi16 (low, high), 12);
+    __m256i second = _mm256_srai_epi32 (_mm256_unpackhi_epi16 (low, high), 12);
+
+    _mm256_storeu_si256 ((__m256i*) (samples + i), _mm256_packs_epi32 (first, second));
+  }
+
+  gain_scalar (samples + vector_count, count - vector_count, gain);
+}
+
+__attribute__((target("avx2")))
+static void
+mix_avx2 (gint16* samples,
+          const gint16* other,
+          unsigned count)
+{
+  unsigned vector_count = count & ~15u;
+
+  for (unsigned i = 0 ; i < vector_count ; i += 16) {
+
+    __m256i value = _mm256_loadu_si256 ((const __m256i*) (samples + i));
+    __m256i added = _mm256_loadu_si256 ((const __m256i*) (other + i));
+
+    _mm256_storeu_si256 ((__m256i*) (samples + i), _mm256_adds_epi16 (value, added));
+  }
+
+  mix_scalar (samples + vector_count, other + vector_count, count - vector_count);
+}
+
+#endif
+
+
+#ifdef AUDIO_DSP_NEON
+
+static void
+measure_neon (const gint16* samples,
+              unsigned count,
+              AudioDSP::Levels& levels)
+{
+  int16x8_t peak = vdupq_n_s16 (0);
+  uint64x2_t square_sum = vdupq_n_u64 (0);
+  unsigned vector_count = count & ~7u;
+  unsigned i = 0;
+  gint16 peak_lanes[8];
+
+  while (i < vector_count) {
+
+    unsigned block_end = MIN (vector_count, i + 8 * AUDIO_DSP_BLOCK_ROUNDS);
+    uint32x4_t abs_sum = vdupq_n_u32 (0);
+
+    for ( ; i < block_end ; i += 8) {
+
+      int16x8_t value = vld1q_s16 (samples + i);
+      int16x8_t abs_value = vqabsq_s16 (value);
+      int32x4_t square_low = vmull_s16 (vget_low_s16 (value), vget_low_s16 (value));
+      int32x4_t square_high = vmull_s16 (vget_high_s16 (value), vget_high_s16 (value));
+
+      peak = vmaxq_s16 (peak, abs_value);
+      abs_sum = vpadalq_u16 (abs_sum, vreinterpretq_u16_s16 (abs_value));
+      square_sum = vpadalq_u32 (square_sum, vreinterpretq_u32_s32 (square_low));
+      square_sum = vpadalq_u32 (square_sum, vreinterpretq_u32_s32 (square_high));
+    }
+
+    levels.abs_sum += vgetq_lane_u32 (abs_sum, 0) + (guint64) vgetq_lane_u32 (abs_sum, 1)
+      + vgetq_lane_u32 (abs_sum, 2) + vgetq_lane_u32 (abs_sum, 3);
+  }
+
+  levels.square_sum += vgetq_lane_u64 (square_sum, 0) + vgetq_lane_u64 (square_sum, 1);
+
+  vst1q_s16 (peak_lanes, peak);
+  for (unsigned j = 0 ; j < 8 ; j++)
+    if ((unsigned) peak_lanes[j] > levels.peak)
+      levels.peak = peak_lanes[j];
+
+  measure_scalar (samples + vector_count, count - vector_count, levels);
+}
+
+static void
+gain_neon (gint16* samples,
+           unsigned count,
+           unsigned gain)
+{
+  unsigned vector_count = count & ~7u;
+
+  for (unsigned i = 0 ; i < vector_count ; i += 8) {
+
+    int16x8_t value = vld1q_s16 (samples + i);
+    int32x4_t low = vmull_n_s16 (vget_low_s16 (value), (gint16) gain);
+    int32x4_t high = vmull_n_s16 (vget_high_s16 (value), (gint16) gain);
+
+    vst1q_s16 (samples + i, vcombine_s16 (vqshrn_n_s32 (low, 12),
+                                          vqshrn_n_s32 (high, 12)));
+  }
+
+  gain_scalar (samples + vector_count, count - vector_count, gain);
+}
+
+static void
+mix_neon (gint16* samples,
+          const gint16* other,
+          unsigned count)
+{
+  unsigned vector_count = count & ~7u;
+
+  for (unsigned i = 0 ; i < vector_count ; i += 8)
+    vst1q_s16 (samples + i, vqaddq_s16 (vld1q_s16 (samples + i),
+                                        vld1q_s16 (other + i)));
+
+  mix_scalar (samples + vector_count, other + vector_count, count - vector_count);
+}
+
+#endif
+
+
+static Kernels
+select_kernels ()
+{
+#ifdef AUDIO_DSP_X86
+  __builtin_cpu_init ();
+
+  if (__builtin_cpu_supports ("avx2")) {
+
+    Kernels kernels = { "avx2", measure_avx2, gain_avx2, mix_avx2 };
+    return kernels;
+  }
+
+  if (__builtin_cpu_supports ("sse2")) {
+
+    Kernels kernels = { "sse2", measure_sse2, gain_sse2, mix_sse2 };
+    return kernels;
+  }
+#endif
+
+#ifdef AUDIO_DSP_NEON
+  Kernels kernels = { "neon", measure_neon, gain_neon, mix_neon };
+#else
+  Kernels kernels = { "scalar", measure_scalar, gain_scalar, mix_scalar };
+#endif
+
+  return kernels;
+}
+
+static const Kernels&
+get_kernels ()
+{
+  static const Kernels kernels = select_kernels ();
+
+  return kernels;
+}
+
+
+double
+AudioDSP::Levels::get_mean () const
+{
+  return (count > 0) ? (double) abs_sum / count : 0;
+}
+
+double
+AudioDSP::Levels::get_rms () const
+{
+  return (count > 0) ? sqrt ((double) square_sum / count) : 0;
+}
+
+void
+AudioDSP::measure (const gint16* samples,
+                   unsigned count,
+                   Levels& levels)
+{
+  levels.abs_sum = 0;
+  levels.square_sum = 0;
+  levels.peak = 0;
+  levels.count = count;
+
+  get_kernels ().measure (samples, count, levels);
+}
+
+float
+AudioDSP::average_level (const gint16* samples,
+                         unsigned size)
+{
+  Levels levels;
+
+  if (size < 2)
+    return 0;
+
+  measure (samples, size >> 1, levels);
+
+  return log10 (9.0 * levels.abs_sum / size / 32767 + 1);
+}
+
+void
+AudioDSP::apply_gain (gint16* samples,
+                      unsigned count,
+                      unsigned gain)
+{
+  if (gain > 32767)
+    gain = 32767;
+
+  get_kernels ().gain (samples, count, gain);
+}
+
+void
+AudioDSP::apply_volume (gint16* samples,
+                        unsigned count,
+                        unsigned volume)
+{
+  if (volume >= 255)
+    return;
+
+  apply_gain (samples, count, volume * 4096 / 255);
+}
+
+void
+AudioDSP::mix (gint16* samples,
+               const gint16* other,
+               unsigned count)
+{
+  get_kernels ().mix (samples, other, count);
+}
+
+const char*
+AudioDSP::get_implementation ()
+{
+  return get_kernels ().name;
+}
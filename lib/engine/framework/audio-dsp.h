@@ -0,0 +1,120 @@
+
+/*
+ * Ekiga -- A VoIP and Video-Conferencing application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+/*
+ *                         audio-dsp.h  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014
+ *   description          : Declaration of small DSP kernels working on
+ *                          16 bit PCM (level metering, gain)
+ *
+ */
+
+#ifndef __AUDIO_DSP_H__
+#define __AUDIO_DSP_H__
+
+#include <glib.h>
+
+namespace Ekiga
+{
+  /* Those kernels work on native-endian signed 16 bit samples.
+   *
+   * The best implementation available on the running CPU (AVX2, SSE2, NEON,
+   * or the portable scalar one) is chosen the first time one of them is
+   * called ; they are all thread-safe.
+   */
+  namespace AudioDSP
+  {
+    /** The levels of a block of samples, as computed by measure().
+     */
+    struct Levels
+    {
+      guint64 abs_sum;    // sum of the absolute values
+      guint64 square_sum; // sum of the squares
+      unsigned peak;      // greatest absolute value
+      unsigned count;     // number of samples
+
+      /** Returns the mean absolute value (0..32768).
+       */
+      double get_mean () const;
+
+      /** Returns the root mean square (0..32768).
+       */
+      double get_rms () const;
+    };
+
+    /** Measures the levels of a block of samples.
+     * @param samples the samples.
+     * @param count the number of samples.
+     * @param levels the levels to fill.
+     */
+    void measure (const gint16* samples,
+                  unsigned count,
+                  Levels& levels);
+
+    /** Returns the average level of a buffer on a logarithmic 0..1 scale,
+     * as shown by the audio level meters.
+     * @param samples the samples.
+     * @param size the size of the buffer in bytes.
+     */
+    float average_level (const gint16* samples,
+                         unsigned size);
+
+    /** Multiplies in place a block of samples by a gain, with saturation.
+     * @param samples the samples.
+     * @param count the number of samples.
+     * @param gain the gain, in 1/4096th (4096 is unity, at most 32767).
+     */
+    void apply_gain (gint16* samples,
+                     unsigned count,
+                     unsigned gain);
+
+    /** Applies a volume in place, as software replacement for a device mixer.
+     * @param samples the samples.
+     * @param count the number of samples.
+     * @param volume the volume, from 0 (mute) to 255 (unchanged).
+     */
+    void apply_volume (gint16* samples,
+                       unsigned count,
+                       unsigned volume);
+
+    /** Adds a block of samples to another one, with saturation.
+     * @param samples the samples to mix into.
+     * @param other the samples to add.
+     * @param count the number of samples.
+     */
+    void mix (gint16* samples,
+              const gint16* other,
+              unsigned count);
+
+    /** Returns the name of the implementation in use ("avx2", "sse2",
+     * "neon" or "scalar").
+     */
+    const char* get_implementation ();
+  };
+};
+
+#endif
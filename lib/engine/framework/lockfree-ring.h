@@ -0,0 +1,190 @@
+/*
+ * Ekiga -- A VoIP and Video-Conferencing application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+/*
+ *                         lockfree-ring.h  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014
+ *   description          : a single-producer/single-consumer lock-free
+ *                          byte ring buffer
+ *
+ */
+
+#ifndef __LOCKFREE_RING_H__
+#define __LOCKFREE_RING_H__
+
+#include <string.h>
+#include <glib.h>
+#include <boost/noncopyable.hpp>
+
+namespace Ekiga
+{
+  /** A single-producer/single-consumer lock-free ring of bytes.
+   *
+   * Exactly one thread may call write() and get_free() (the producer)
+   * while exactly one other thread calls read() and get_fill() (the
+   * consumer), without any lock being taken on either side. The memory
+   * is allocated once by resize(), so that neither side ever allocates.
+   *
+   * resize() and clear() are NOT thread-safe : they must only be called
+   * while neither the producer nor the consumer is running.
+   *
+   * The read and write positions are free-running counters ; the capacity
+   * is always rounded up to a power of two so that they can wrap around
+   * safely.
+   */
+  class LockFreeRing:
+    public boost::noncopyable
+  {
+  public:
+
+    LockFreeRing (unsigned size = 0):
+      buffer(NULL), capacity(0), read_pos(0), write_pos(0)
+    { resize (size); }
+
+    ~LockFreeRing ()
+    { g_free (buffer); }
+
+    /** (Re)allocates the ring and empties it.
+     * @param size the minimum number of bytes the ring must hold.
+     */
+    void resize (unsigned size)
+    {
+      unsigned new_capacity = 1;
+
+      while (new_capacity < size)
+        new_capacity <<= 1;
+
+      if (size == 0)
+        new_capacity = 0;
+
+      if (new_capacity != capacity) {
+
+        g_free (buffer);
+        buffer = new_capacity ? (char*) g_malloc (new_capacity) : NULL;
+        capacity = new_capacity;
+      }
+      clear ();
+    }
+
+    /** Empties the ring.
+     */
+    void clear ()
+    {
+      g_atomic_int_set (&read_pos, 0);
+      g_atomic_int_set (&write_pos, 0);
+    }
+
+    unsigned get_capacity () const
+    { return capacity; }
+
+    /** Returns the number of bytes which can be read right now.
+     * For the consumer, that value can only grow until it reads.
+     */
+    unsigned get_fill () const
+    {
+      return (guint) g_atomic_int_get (&write_pos)
+        - (guint) g_atomic_int_get (&read_pos);
+    }
+
+    /** Returns the number of bytes which can be written right now.
+     * For the producer, that value can only grow until it writes.
+     */
+    unsigned get_free () const
+    { return capacity - get_fill (); }
+
+    /** Writes at most size bytes from data into the ring (producer side).
+     * @return the number of bytes actually written.
+     */
+    unsigned write (const char* data,
+                    unsigned size)
+    {
+      guint wpos = (guint) g_atomic_int_get (&write_pos);
+      unsigned available = get_free ();
+
+      if (size > available)
+        size = available;
+
+      copy_in (wpos & (capacity - 1), data, size);
+      g_atomic_int_set (&write_pos, (gint) (wpos + size));
+
+      return size;
+    }
+
+    /** Reads at most size bytes from the ring into data (consumer side).
+     * @return the number of bytes actually read.
+     */
+    unsigned read (char* data,
+                   unsigned size)
+    {
+      guint rpos = (guint) g_atomic_int_get (&read_pos);
+      unsigned available = get_fill ();
+
+      if (size > available)
+        size = available;
+
+      copy_out (rpos & (capacity - 1), data, size);
+      g_atomic_int_set (&read_pos, (gint) (rpos + size));
+
+      return size;
+    }
+
+  private:
+
+    void copy_in (unsigned offset,
+                  const char* data,
+                  unsigned size)
+    {
+      unsigned first = MIN (size, capacity - offset);
+
+      if (size == 0)
+        return;
+
+      memcpy (buffer + offset, data, first);
+      memcpy (buffer, data + first, size - first);
+    }
+
+    void copy_out (unsigned offset,
+                   char* data,
+                   unsigned size) const
+    {
+      unsigned first = MIN (size, capacity - offset);
+
+      if (size == 0)
+        return;
+
+      memcpy (data, buffer + offset, first);
+      memcpy (data + first, buffer, size - first);
+    }
+
+    char* buffer;
+    unsigned capacity;
+
+    volatile gint read_pos;
+    volatile gint write_pos;
+  };
+};
+
+#endif
@@ -40,8 +40,11 @@
 #include <boost/signals2.hpp>
 #include <boost/bind.hpp>
 #include <list>
+#include <map>
+#include <vector>
 
 #include <boost/smart_ptr.hpp>
+#include <boost/unordered_map.hpp>
 
 #include "live-object.h"
 #include "map-key-iterator.h"
@@ -73,6 +76,25 @@ namespace Ekiga
 
     int size () const;
 
+    /* Secondary indexes: each maps the string computed by its key function
+     * (an uri, a jid, an aor...) to the objects giving that string, and
+     * is kept up to date as objects are added, updated and removed.
+     * Objects with an empty key aren't indexed.
+     */
+    typedef boost::function1<std::string, boost::shared_ptr<ObjectType> > index_key_type;
+
+    /* returns the identifier to give to find_object */
+    int add_index (index_key_type key);
+
+    /* returns one of the objects having that key, or a null pointer */
+    boost::shared_ptr<ObjectType> find_object (int index,
+					       const std::string key) const;
+
+    /* visits all the objects having that key */
+    void visit_objects (int index,
+			const std::string key,
+			boost::function1<bool, boost::shared_ptr<ObjectType> > visitor) const;
+
     iterator begin ();
     iterator end ();
 
@@ -85,6 +107,17 @@ namespace Ekiga
 
   private:
     container_type objects;
+
+    typedef boost::unordered_multimap<std::string, boost::shared_ptr<ObjectType> > index_type;
+
+    void index_object (boost::shared_ptr<ObjectType> obj);
+    void unindex_object (boost::shared_ptr<ObjectType> obj);
+    void reindex_object (boost::shared_ptr<ObjectType> obj);
+
+    std::vector<index_key_type> index_keys;
+    std::vector<index_type> indexes;
+    /* the keys under which each object is currently indexed */
+    std::map<boost::shared_ptr<ObjectType>, std::vector<std::string> > indexed_keys;
   };
 
 };
@@ -108,6 +141,9 @@ Ekiga::RefLister<ObjectType>::add_object (boost::shared_ptr<ObjectType> obj)
   typename container_type::iterator iter = objects.find (obj);
   if (iter == objects.end ())
     objects[obj] = boost::shared_ptr<scoped_connections> (new scoped_connections);
+  reindex_object (obj);
+  /* the indexes should be right before the world learns about the update */
+  objects[obj]->add (obj->updated.connect (boost::bind (&Ekiga::RefLister<ObjectType>::reindex_object, this, obj)));
   objects[obj]->add (obj->updated.connect (boost::bind (boost::ref (object_updated), obj)));
   objects[obj]->add (obj->updated.connect (boost::ref (updated)));
   objects[obj]->add (obj->removed.connect (boost::bind (&Ekiga::RefLister<ObjectType>::remove_object, this, obj)));
@@ -131,6 +167,7 @@ template<typename ObjectType>
 void
 Ekiga::RefLister<ObjectType>::remove_object (boost::shared_ptr<ObjectType> obj)
 {
+  unindex_object (obj);
   objects.erase (objects.find (obj));
   object_removed (obj);
   updated ();
@@ -152,6 +189,119 @@ Ekiga::RefLister<ObjectType>::size () const
   return objects.size ();
 }
 
+template<typename ObjectType>
+int
+Ekiga::RefLister<ObjectType>::add_index (index_key_type key)
+{
+  index_keys.push_back (key);
+  indexes.push_back (index_type ());
+
+  for (typename container_type::iterator iter = objects.begin ();
+       iter != objects.end ();
+       ++iter)
+    reindex_object (iter->first);
+
+  return indexes.size () - 1;
+}
+
+template<typename ObjectType>
+boost::shared_ptr<ObjectType>
+Ekiga::RefLister<ObjectType>::find_object (int index,
+					   const std::string key) const
+{
+  boost::shared_ptr<ObjectType> result;
+  typename index_type::const_iterator iter = indexes[index].find (key);
+
+  if (iter != indexes[index].end ())
+    result = iter->second;
+
+  return result;
+}
+
+template<typename ObjectType>
+void
+Ekiga::RefLister<ObjectType>::visit_objects (int index,
+					     const std::string key,
+					     boost::function1<bool, boost::shared_ptr<ObjectType> > visitor) const
+{
+  bool go_on = true;
+  std::pair<typename index_type::const_iterator, typename index_type::const_iterator> range = indexes[index].equal_range (key);
+  /* the visitor may update the objects, hence the copy */
+  std::list<boost::shared_ptr<ObjectType> > found;
+
+  for (typename index_type::const_iterator iter = range.first;
+       iter != range.second;
+       ++iter)
+    found.push_back (iter->second);
+
+  for (typename std::list<boost::shared_ptr<ObjectType> >::iterator iter = found.begin ();
+       go_on && iter != found.end ();
+       ++iter)
+    go_on = visitor (*iter);
+}
+
+template<typename ObjectType>
+void
+Ekiga::RefLister<ObjectType>::index_object (boost::shared_ptr<ObjectType> obj)
+{
+  std::vector<std::string>& keys = indexed_keys[obj];
+
+  keys.clear ();
+  for (unsigned int ii = 0; ii < index_keys.size (); ++ii) {
+
+    keys.push_back (index_keys[ii] (obj));
+    if ( !keys.back ().empty ())
+      indexes[ii].insert (std::make_pair (keys.back (), obj));
+  }
+}
+
+template<typename ObjectType>
+void
+Ekiga::RefLister<ObjectType>::unindex_object (boost::shared_ptr<ObjectType> obj)
+{
+  typename std::map<boost::shared_ptr<ObjectType>, std::vector<std::string> >::iterator keys = indexed_keys.find (obj);
+
+  if (keys == indexed_keys.end ())
+    return;
+
+  for (unsigned int ii = 0; ii < keys->second.size (); ++ii) {
+
+    std::pair<typename index_type::iterator, typename index_type::iterator> range = indexes[ii].equal_range (keys->second[ii]);
+    for (typename index_type::iterator iter = range.first;
+	 iter != range.second;
+	 ++iter)
+      if (iter->second == obj) {
+
+	indexes[ii].erase (iter);
+	break;
+      }
+  }
+
+  indexed_keys.erase (keys);
+}
+
+template<typename ObjectType>
+void
+Ekiga::RefLister<ObjectType>::reindex_object (boost::shared_ptr<ObjectType> obj)
+{
+  if (index_keys.empty ())
+    return;
+
+  /* most updates (presence, status...) don't touch the keys */
+  typename std::map<boost::shared_ptr<ObjectType>, std::vector<std::string> >::const_iterator keys = indexed_keys.find (obj);
+  if (keys != indexed_keys.end () && keys->second.size () == index_keys.size ()) {
+
+    bool changed = false;
+    for (unsigned int ii = 0; !changed && ii < index_keys.size (); ++ii)
+      changed = (index_keys[ii] (obj) != keys->second[ii]);
+    if ( !changed)
+      return;
+  }
+
+  unindex_object (obj);
+  index_object (obj);
+}
+
 template<typename ObjectType>
 typename Ekiga::RefLister<ObjectType>::iterator
 Ekiga::RefLister<ObjectType>::begin ()
@@ -47,12 +47,15 @@ static GMainLoop* loop;
 struct message
 {
   message (boost::function0<void> _action,
-	   unsigned int _seconds): action(_action),
-				   seconds(_seconds)
+	   unsigned int _seconds,
+	   unsigned int _milliseconds = 0): action(_action),
+					    seconds(_seconds),
+					    milliseconds(_milliseconds)
   {}
 
   boost::function0<void> action;
   unsigned int seconds;
+  unsigned int milliseconds;
 };
 
 static void
@@ -107,7 +110,10 @@ dispatch (GSource *source,
 
   msg = (struct message *)g_async_queue_pop (src->queue);
 
-  if (msg->seconds == 0)
+  if (msg->milliseconds != 0)
+    g_timeout_add (msg->milliseconds,
+		   run_later_or_back_in_main_helper, (gpointer)msg);
+  else if (msg->seconds == 0)
     (void)run_later_or_back_in_main_helper ((gpointer)msg);
   else
     g_timeout_add_seconds (msg->seconds,
@@ -170,3 +176,11 @@ Ekiga::Runtime::run_in_main (boost::function0<void> action,
   if (queue != NULL)
     g_async_queue_push (queue, (gpointer)(new struct message (action, seconds)));
 }
+
+void
+Ekiga::Runtime::run_later_in_main (boost::function0<void> action,
+				   unsigned int milliseconds)
+{
+  if (queue != NULL)
+    g_async_queue_push (queue, (gpointer)(new struct message (action, 0, milliseconds)));
+}
@@ -60,6 +60,10 @@ namespace Ekiga
 
     void run_in_main (boost::function0<void> action,
 		      unsigned int seconds = 0); // depends on the implementation
+
+    /* same as above, for delays shorter than a second */
+    void run_later_in_main (boost::function0<void> action,
+			    unsigned int milliseconds); // depends on the implementation
   };
 
   /**
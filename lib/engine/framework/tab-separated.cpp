@@ -0,0 +1,112 @@
+
+/*
+ * Ekiga -- A VoIP and Video-Conferencing application
+ * Copyright (C) 2000-2009 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+/*
+ *                         tab-separated.cpp  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014
+ *   description          : implementation of helpers to keep records in
+ *                          text files, as a line of tab-separated fields
+ *
+ */
+
+#include "tab-separated.h"
+
+std::string
+Ekiga::tab_separated_escape (const std::string& field)
+{
+  std::string result;
+
+  for (std::string::const_iterator iter = field.begin ();
+       iter != field.end ();
+       ++iter) {
+
+    switch (*iter) {
+
+    case '\\':
+      result += "\\\\";
+      break;
+    case '\t':
+      result += "\\t";
+      break;
+    case '\n':
+      result += "\\n";
+      break;
+    default:
+      result += *iter;
+    }
+  }
+
+  return result;
+}
+
+std::vector<std::string>
+Ekiga::tab_separated_split (const std::string& line)
+{
+  std::vector<std::string> result (1);
+
+  for (std::string::const_iterator iter = line.begin ();
+       iter != line.end ();
+       ++iter) {
+
+    if (*iter == '\t')
+      result.push_back ("");
+    else if (*iter == '\\' && iter + 1 != line.end ()) {
+
+      ++iter;
+      if (*iter == 't')
+	result.back () += '\t';
+      else if (*iter == 'n')
+	result.back () += '\n';
+      else
+	result.back () += *iter;
+    } else
+      result.back () += *iter;
+  }
+
+  return result;
+}
+
+bool
+Ekiga::tab_separated_read_line (FILE* file,
+				std::string& line)
+{
+  char buffer[1024];
+
+  line.clear ();
+  while (fgets (buffer, sizeof (buffer), file) != NULL) {
+
+    line += buffer;
+    if (line[line.size () - 1] == '\n') {
+
+      line.erase (line.size () - 1);
+      return true;
+    }
+  }
+
+  /* a record without its end of line was cut while being written */
+  return false;
+}
@@ -0,0 +1,69 @@
+
+/*
+ * Ekiga -- A VoIP and Video-Conferencing application
+ * Copyright (C) 2000-2009 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+/*
+ *                         tab-separated.h  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014
+ *   description          : declaration of helpers to keep records in
+ *                          text files, as a line of tab-separated fields
+ *
+ */
+
+#ifndef __TAB_SEPARATED_H__
+#define __TAB_SEPARATED_H__
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+namespace Ekiga
+{
+  /* A record is a line of fields separated by tabs -- so tabs, newlines
+   * and backslashes in the fields are escaped with a backslash.
+   */
+
+  /* Returns the field escaped for use in a record
+   * @param field The raw field
+   */
+  std::string tab_separated_escape (const std::string& field);
+
+  /* Returns the unescaped fields of a record
+   * @param line The record, without its end of line
+   */
+  std::vector<std::string> tab_separated_split (const std::string& line);
+
+  /* Reads the next record from a file, however long it is
+   * @param file The file to read from
+   * @param line The record, without its end of line
+   * @return false if there was no complete record left to read
+   */
+  bool tab_separated_read_line (FILE* file,
+				std::string& line);
+};
+
+#endif
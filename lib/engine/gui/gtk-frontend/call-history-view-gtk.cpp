@@ -43,6 +43,12 @@
 #include "menu-builder-tools.h"
 #include "menu-builder-gtk.h"
 #include "gm-cell-renderer-bitext.h"
+#include "scoped-connections.h"
+
+/* the history can be long : it is shown a page at a time, and the next
+ * page is added when the user scrolls to the bottom
+ */
+#define CALL_HISTORY_VIEW_PAGE_SIZE 100
 
 
 struct _CallHistoryViewGtkPrivate
@@ -54,7 +60,7 @@ struct _CallHistoryViewGtkPrivate
   boost::shared_ptr<History::Book> book;
   GtkListStore* store;
   GtkTreeView* tree;
-  boost::signals2::scoped_connection connection;
+  Ekiga::scoped_connections connections;
 };
 
 /* this is what we put in the view */
@@ -76,10 +82,11 @@ static guint signals[LAST_SIGNAL] = { 0 };
 
 G_DEFINE_TYPE (CallHistoryViewGtk, call_history_view_gtk, GTK_TYPE_SCROLLED_WINDOW);
 
-/* react to a new call being inserted in history */
+/* fill a row for a call */
 static void
-on_contact_added (Ekiga::ContactPtr contact,
-		  GtkListStore *store)
+set_row (Ekiga::ContactPtr contact,
+	 GtkListStore *store,
+	 GtkTreeIter* iter)
 {
   time_t t;
   struct tm *timeinfo = NULL;
@@ -88,7 +95,6 @@ on_contact_added (Ekiga::ContactPtr contact,
   const gchar *id = NULL;
 
   boost::shared_ptr<History::Contact> hcontact = boost::dynamic_pointer_cast<History::Contact> (contact);
-  GtkTreeIter iter;
 
   if (hcontact) {
 
@@ -125,8 +131,7 @@ on_contact_added (Ekiga::ContactPtr contact,
   else
     info << hcontact->get_call_duration ();
 
-  gtk_list_store_prepend (store, &iter);
-  gtk_list_store_set (store, &iter,
+  gtk_list_store_set (store, iter,
 		      COLUMN_CONTACT, contact.get (),
 		      COLUMN_PIXBUF, id,
 		      COLUMN_NAME, contact->get_name ().c_str (),
@@ -134,19 +139,80 @@ on_contact_added (Ekiga::ContactPtr contact,
 		      -1);
 }
 
+/* react to a new call being inserted in history */
+static void
+on_contact_added (Ekiga::ContactPtr contact,
+		  GtkListStore *store)
+{
+  GtkTreeIter iter;
+
+  gtk_list_store_prepend (store, &iter);
+  set_row (contact, store, &iter);
+}
+
+/* the oldest calls get forgotten */
+static void
+on_contact_removed (Ekiga::ContactPtr contact,
+		    GtkListStore *store)
+{
+  GtkTreeIter iter;
+  Ekiga::Contact* row_contact = NULL;
+  gboolean go_on = FALSE;
+
+  go_on = gtk_tree_model_get_iter_first (GTK_TREE_MODEL (store), &iter);
+  while (go_on) {
+
+    gtk_tree_model_get (GTK_TREE_MODEL (store), &iter,
+			COLUMN_CONTACT, &row_contact,
+			-1);
+    if (row_contact == contact.get ()) {
+
+      gtk_list_store_remove (store, &iter);
+      break;
+    }
+    go_on = gtk_tree_model_iter_next (GTK_TREE_MODEL (store), &iter);
+  }
+}
+
+static void
+on_book_cleared (CallHistoryViewGtk* self)
+{
+  gtk_list_store_clear (self->priv->store);
+}
+
 static bool
-on_visit_contacts (Ekiga::ContactPtr contact,
+on_visit_contacts (History::ContactPtr contact,
 		   GtkListStore *store)
 {
-  on_contact_added (contact, store);
+  GtkTreeIter iter;
+
+  gtk_list_store_append (store, &iter);
+  set_row (contact, store, &iter);
   return true;
 }
 
+/* the rows are the latest calls, newest first : add the page after them */
 static void
-on_book_updated (CallHistoryViewGtk* self)
+load_next_page (CallHistoryViewGtk* self)
 {
-  gtk_list_store_clear (self->priv->store);
-  self->priv->book->visit_contacts (boost::bind (&on_visit_contacts, _1, self->priv->store));
+  gint shown = gtk_tree_model_iter_n_children (GTK_TREE_MODEL (self->priv->store),
+					       NULL);
+
+  self->priv->book->visit_latest_contacts (shown, CALL_HISTORY_VIEW_PAGE_SIZE,
+					   boost::bind (&on_visit_contacts, _1, self->priv->store));
+}
+
+static void
+on_scrolled (GtkAdjustment* adjustment,
+	     gpointer data)
+{
+  CallHistoryViewGtk* self = CALL_HISTORY_VIEW_GTK (data);
+
+  if (gtk_adjustment_get_value (adjustment) + gtk_adjustment_get_page_size (adjustment)
+      >= gtk_adjustment_get_upper (adjustment)
+      && self->priv->store != NULL
+      && (unsigned int)gtk_tree_model_iter_n_children (GTK_TREE_MODEL (self->priv->store), NULL) < self->priv->book->size ())
+    load_next_page (self);
 }
 
 /* react to user clicks */
@@ -226,6 +292,17 @@ call_history_view_gtk_dispose (GObject* obj)
 
   view = CALL_HISTORY_VIEW_GTK (obj);
 
+  /* the book signals refer to the store */
+  view->priv->connections.clear ();
+
+  g_signal_handlers_disconnect_matched (gtk_scrolled_window_get_vadjustment (GTK_SCROLLED_WINDOW (view)),
+					(GSignalMatchType) G_SIGNAL_MATCH_DATA,
+					0, /* signal_id */
+					(GQuark) 0, /* detail */
+					NULL, /* closure */
+					NULL, /* func */
+					view /* data */);
+
   if (view->priv->store) {
 
     g_object_unref (view->priv->store);
@@ -351,11 +428,15 @@ call_history_view_gtk_new (boost::shared_ptr<History::Book> book)
   g_signal_connect (self->priv->tree, "event-after",
 		    G_CALLBACK (on_clicked), &(*book));
 
-  /* connect to the signal */
-  self->priv->connection = book->updated.connect (boost::bind (&on_book_updated, self));
+  /* connect to the signals */
+  self->priv->connections.add (book->contact_added.connect (boost::bind (&on_contact_added, _1, self->priv->store)));
+  self->priv->connections.add (book->contact_removed.connect (boost::bind (&on_contact_removed, _1, self->priv->store)));
+  self->priv->connections.add (book->cleared.connect (boost::bind (&on_book_cleared, self)));
+  g_signal_connect (gtk_scrolled_window_get_vadjustment (GTK_SCROLLED_WINDOW (self)),
+		    "value-changed", G_CALLBACK (on_scrolled), self);
 
   /* initial populate */
-  on_book_updated(self);
+  load_next_page (self);
 
   return (GtkWidget*)self;
 }
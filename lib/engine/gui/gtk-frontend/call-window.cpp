@@ -35,6 +35,8 @@
  *                          build the call window.
  */
 
+#include <algorithm>
+
 #include <glib/gi18n.h>
 #include <gdk/gdkkeysyms.h>
 
@@ -165,6 +167,7 @@ struct _EkigaCallWindowPrivate
   GtkWidget *transfer_call_popup;
 
   Ekiga::scoped_connections connections;
+  boost::signals2::scoped_connection statistics_connection;
   boost::shared_ptr<Ekiga::Settings> video_display_settings;
 };
 
@@ -214,6 +217,12 @@ static void audio_volume_window_hidden_cb (GtkWidget * /*widget*/,
 static void video_settings_changed_cb (GtkAdjustment * /*adjustment*/,
                                        gpointer data);
 
+static void video_widget_mapped_cb (GtkWidget *widget,
+                                    gpointer data);
+
+static void video_widget_unmapped_cb (GtkWidget *widget,
+                                      gpointer data);
+
 static gboolean on_signal_level_refresh_cb (gpointer self);
 
 static void on_videooutput_device_opened_cb (Ekiga::VideoOutputManager & /* manager */,
@@ -340,6 +349,9 @@ static void on_stream_resumed_cb (boost::shared_ptr<Ekiga::CallManager>  /*manag
 
 static gboolean on_stats_refresh_cb (gpointer self);
 
+static void on_statistics_updated_cb (const Ekiga::CallStatistics& statistics,
+                                      gpointer self);
+
 static gboolean ekiga_call_window_delete_event_cb (GtkWidget *widget,
                                                    G_GNUC_UNUSED GdkEventAny *event);
 
@@ -537,6 +549,26 @@ audio_volume_window_hidden_cb (GtkWidget * /*widget*/,
   cw->priv->audiooutput_core->set_average_collection (false);
 }
 
+static void
+video_widget_mapped_cb (GtkWidget *widget,
+                        gpointer data)
+{
+  EkigaCallWindow *cw = EKIGA_CALL_WINDOW (data);
+
+  cw->priv->videooutput_core->set_display_info (gm_video_widget_get_stream (GM_VIDEO_WIDGET (widget), SECONDARY_STREAM), gm_video_widget_get_stream (GM_VIDEO_WIDGET (widget), PRIMARY_STREAM));
+}
+
+static void
+video_widget_unmapped_cb (GtkWidget *widget,
+                          gpointer data)
+{
+  EkigaCallWindow *cw = EKIGA_CALL_WINDOW (data);
+
+  /* Nothing shows the local video anymore : detach it, so that the
+   * preview stops grabbing frames until the widget is mapped again */
+  cw->priv->videooutput_core->set_display_info (NULL, gm_video_widget_get_stream (GM_VIDEO_WIDGET (widget), PRIMARY_STREAM));
+}
+
 static void
 video_settings_changed_cb (GtkAdjustment * /*adjustment*/,
                            gpointer data)
@@ -973,6 +1005,7 @@ on_established_call_cb (boost::shared_ptr<Ekiga::CallManager>  /*manager*/,
   cw->priv->current_call = call;
 
   cw->priv->timeout_id = g_timeout_add_seconds (1, on_stats_refresh_cb, self);
+  cw->priv->statistics_connection = call->statistics_updated.connect (boost::bind (&on_statistics_updated_cb, _1, self));
 }
 
 static void
@@ -993,6 +1026,7 @@ on_cleared_call_cb (G_GNUC_UNUSED boost::shared_ptr<Ekiga::CallManager> manager,
   ekiga_call_window_clear_stats (cw);
 
   if (cw->priv->current_call) {
+    cw->priv->statistics_connection.disconnect ();
     cw->priv->current_call = boost::shared_ptr<Ekiga::Call>();
     g_source_remove (cw->priv->timeout_id);
     cw->priv->timeout_id = -1;
@@ -1116,6 +1150,21 @@ on_stream_resumed_cb (boost::shared_ptr<Ekiga::CallManager>  /*manager*/,
 
 static gboolean
 on_stats_refresh_cb (gpointer self)
+{
+  EkigaCallWindow *cw = EKIGA_CALL_WINDOW (self);
+
+  if (cw->priv->calling_state == Connected && cw->priv->current_call)
+    ekiga_call_window_set_status (cw, _("Connected with %s\n%s"),
+                                  cw->priv->current_call->get_remote_party_name ().c_str (),
+                                  cw->priv->current_call->get_duration ().c_str ());
+
+  return true;
+}
+
+/* the statistics are pushed by the call about once a second */
+static void
+on_statistics_updated_cb (const Ekiga::CallStatistics& statistics,
+                          gpointer self)
 {
   EkigaCallWindow *cw = EKIGA_CALL_WINDOW (self);
   unsigned local_width = 0;
@@ -1125,19 +1174,17 @@ on_stats_refresh_cb (gpointer self)
 
   if (cw->priv->calling_state == Connected && cw->priv->current_call) {
 
-    ekiga_call_window_set_status (cw, _("Connected with %s\n%s"),
-                                  cw->priv->current_call->get_remote_party_name ().c_str (),
-                                  cw->priv->current_call->get_duration ().c_str ());
     ekiga_call_window_set_bandwidth (cw,
-                                     cw->priv->current_call->get_transmitted_audio_bandwidth (),
-                                     cw->priv->current_call->get_received_audio_bandwidth (),
-                                     cw->priv->current_call->get_transmitted_video_bandwidth (),
-                                     cw->priv->current_call->get_received_video_bandwidth ());
-
-    unsigned int jitter = cw->priv->current_call->get_jitter_size ();
-    double lost = cw->priv->current_call->get_lost_packets ();
-    double late = cw->priv->current_call->get_late_packets ();
-    double out_of_order = cw->priv->current_call->get_out_of_order_packets ();
+                                     statistics.transmitted_audio.bandwidth,
+                                     statistics.received_audio.bandwidth,
+                                     statistics.transmitted_video.bandwidth,
+                                     statistics.received_video.bandwidth);
+
+    double packets = std::max (statistics.received_audio.packets + statistics.received_video.packets, 1u);
+    unsigned int jitter = statistics.received_audio.jitter;
+    double lost = 100.0 * (statistics.received_audio.lost_packets + statistics.received_video.lost_packets) / packets;
+    double late = 100.0 * (statistics.received_audio.late_packets + statistics.received_video.late_packets) / packets;
+    double out_of_order = 100.0 * (statistics.received_audio.out_of_order_packets + statistics.received_video.out_of_order_packets) / packets;
     gm_video_widget_get_stream_natural_size (GM_VIDEO_WIDGET (cw->priv->video_widget),
                                              PRIMARY_STREAM, &remote_width, &remote_height);
     gm_video_widget_get_stream_natural_size (GM_VIDEO_WIDGET (cw->priv->video_widget),
@@ -1148,8 +1195,6 @@ on_stats_refresh_cb (gpointer self)
                                     cw->priv->transmitted_audio_codec.c_str (),
                                     cw->priv->transmitted_video_codec.c_str ());
   }
-
-  return true;
 }
 
 static gboolean
@@ -1411,9 +1456,9 @@ ekiga_call_window_update_stats (EkigaCallWindow *cw,
     quality_level = 0.2;
   }
 
-  if ( (lost > 0.02) ||
-       (late > 0.02) ||
-       (out_of_order > 0.02) ) {
+  if ( (lost > 2.0) ||
+       (late > 2.0) ||
+       (out_of_order > 2.0) ) {
     quality_level = 0;
   }
 
@@ -1874,7 +1919,12 @@ ekiga_call_window_init_clutter (EkigaCallWindow *cw)
   gm_video_widget_set_logo (GM_VIDEO_WIDGET (cw->priv->video_widget), filename);
   g_free (filename);
 
-  cw->priv->videooutput_core->set_display_info (gm_video_widget_get_stream (GM_VIDEO_WIDGET (cw->priv->video_widget), SECONDARY_STREAM), gm_video_widget_get_stream (GM_VIDEO_WIDGET (cw->priv->video_widget), PRIMARY_STREAM));
+  /* The local display is only attached while the video widget is on screen */
+  cw->priv->videooutput_core->set_display_info (NULL, gm_video_widget_get_stream (GM_VIDEO_WIDGET (cw->priv->video_widget), PRIMARY_STREAM));
+  g_signal_connect (cw->priv->video_widget, "map",
+                    G_CALLBACK (video_widget_mapped_cb), cw);
+  g_signal_connect (cw->priv->video_widget, "unmap",
+                    G_CALLBACK (video_widget_unmapped_cb), cw);
 }
 
 static void
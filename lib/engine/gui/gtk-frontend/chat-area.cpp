@@ -52,6 +52,8 @@
 #include <string.h>
 #include <stdarg.h>
 
+#include <deque>
+
 #include <glib/gi18n.h>
 #include <gdk/gdkkeysyms.h>
 
@@ -65,19 +67,40 @@ struct _ChatAreaPrivate
   GtkWidget* scrolled_text_window;
   GtkWidget* text_view;
   GtkWidget* message;
+
+  /* only a window of the conversation is in the buffer : the messages
+   * numbered [first_shown, first_shown + shown.size ()), each starting
+   * at the mark in shown
+   */
+  unsigned int first_shown;
+  std::deque<GtkTextMark*> shown;
 };
 
+/* how many messages are kept in the buffer when new ones arrive, and how
+ * many older ones get loaded when the user scrolls to the top
+ */
+#define CHAT_AREA_SHOWN_MESSAGES 200
+#define CHAT_AREA_OLDER_MESSAGES 50
+
 G_DEFINE_TYPE (ChatArea, chat_area, GTK_TYPE_PANED);
 
 /* declaration of internal api */
 
 static void chat_area_add_notice (ChatArea* self,
+				  GtkTextIter* iter,
 				  const gchar* txt);
 
 static void chat_area_add_message (ChatArea* self,
+				   GtkTextIter* iter,
 				   const gchar* from,
 				   const gchar* txt);
 
+static GtkTextMark* chat_area_insert_message (ChatArea* self,
+					      GtkTextIter* iter,
+					      const Ekiga::Message& message);
+
+static void chat_area_forget_oldest_message (ChatArea* self);
+
 /* a helper to shorten tag definitions
  * FIXME when C99 finally is supported everywhere, this
  * can be a variadic macro
@@ -126,6 +149,14 @@ static bool visit_messages (ChatArea* self,
 static void on_message_received (ChatArea* self,
 				 const Ekiga::Message& message);
 
+static bool visit_older_messages (ChatArea* self,
+				  GtkTextIter* iter,
+				  std::deque<GtkTextMark*>* marks,
+				  const Ekiga::Message& message);
+
+static void on_scrolled (GtkAdjustment* adjustment,
+			 gpointer data);
+
 static void on_conversation_removed (ChatArea* self);
 
 static void on_chat_area_grab_focus (GtkWidget*,
@@ -185,45 +216,74 @@ gm_chat_area_define_simple_text_tag (GtkTextBuffer* buffer,
 
 static void
 chat_area_add_notice (ChatArea* self,
+		      GtkTextIter* iter,
 		      const gchar* txt)
 {
   gchar* str = NULL;
-  GtkTextMark *mark = NULL;
-  GtkTextBuffer* buffer = NULL;
-  GtkTextIter iter;
 
   str = g_strdup_printf ("NOTICE: %s\n", txt);
-  buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (self->priv->text_view));
-  gtk_text_buffer_get_end_iter (buffer, &iter);
-  gm_text_buffer_enhancer_insert_text (self->priv->enhancer, &iter,
+  gm_text_buffer_enhancer_insert_text (self->priv->enhancer, iter,
 				       str, -1);
   g_free (str);
-
-  mark = gtk_text_buffer_get_mark (buffer, "current-position");
-  gtk_text_view_scroll_to_mark (GTK_TEXT_VIEW (self->priv->text_view), mark,
-                                0.0, FALSE, 0,0);
 }
 
 static void
 chat_area_add_message (ChatArea* self,
+		       GtkTextIter* iter,
 		       const gchar* from,
 		       const gchar* txt)
 {
   gchar* str = NULL;
-  GtkTextMark *mark = NULL;
-  GtkTextBuffer* buffer = NULL;
-  GtkTextIter iter;
 
   str = g_strdup_printf ("<b><i>%s %s</i></b>\n%s\n", from, _("says:"), txt);
-  buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (self->priv->text_view));
-  gtk_text_buffer_get_end_iter (buffer, &iter);
-  gm_text_buffer_enhancer_insert_text (self->priv->enhancer, &iter,
+  gm_text_buffer_enhancer_insert_text (self->priv->enhancer, iter,
 				       str, -1);
   g_free (str);
+}
 
-  mark = gtk_text_buffer_get_mark (buffer, "current-position");
-  gtk_text_view_scroll_to_mark (GTK_TEXT_VIEW (self->priv->text_view), mark,
-                                0.0, FALSE, 0,0);
+static GtkTextMark*
+chat_area_insert_message (ChatArea* self,
+			  GtkTextIter* iter,
+			  const Ekiga::Message& message)
+{
+  GtkTextBuffer* buffer = NULL;
+  GtkTextMark* mark = NULL;
+  Ekiga::Message::payload_type::const_iterator text
+    = message.payload.find ("text/plain");
+
+  /* the mark stays before what we insert */
+  buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (self->priv->text_view));
+  mark = gtk_text_buffer_create_mark (buffer, NULL, iter, TRUE);
+
+  if (text != message.payload.end ()) {
+
+    if (message.name == "")
+      chat_area_add_notice (self, iter, text->second.c_str ());
+    else
+      chat_area_add_message (self, iter, message.name.c_str (), text->second.c_str ());
+  }
+
+  return mark;
+}
+
+static void
+chat_area_forget_oldest_message (ChatArea* self)
+{
+  GtkTextBuffer* buffer = NULL;
+  GtkTextIter start;
+  GtkTextIter end;
+
+  buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (self->priv->text_view));
+  gtk_text_buffer_get_start_iter (buffer, &start);
+  if (self->priv->shown.size () > 1)
+    gtk_text_buffer_get_iter_at_mark (buffer, &end, self->priv->shown[1]);
+  else
+    gtk_text_buffer_get_end_iter (buffer, &end);
+
+  gtk_text_buffer_delete (buffer, &start, &end);
+  gtk_text_buffer_delete_mark (buffer, self->priv->shown.front ());
+  self->priv->shown.pop_front ();
+  self->priv->first_shown++;
 }
 
 /* implementation of callbacks */
@@ -569,20 +629,73 @@ static void
 on_message_received (ChatArea* self,
 		     const Ekiga::Message& message)
 {
-  if (message.name == "") {
+  GtkTextBuffer* buffer = NULL;
+  GtkTextMark* mark = NULL;
+  GtkTextIter iter;
 
+  buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (self->priv->text_view));
+  gtk_text_buffer_get_end_iter (buffer, &iter);
+  self->priv->shown.push_back (chat_area_insert_message (self, &iter, message));
 
-    Ekiga::Message::payload_type::const_iterator iter
-      = message.payload.find ("text/plain");
-    if (iter != message.payload.end ())
-      chat_area_add_notice (self, iter->second.c_str ());
-  } else {
+  /* we show the new message, so the older ones can go : the user will
+   * get them back by scrolling up */
+  while (self->priv->shown.size () > CHAT_AREA_SHOWN_MESSAGES)
+    chat_area_forget_oldest_message (self);
 
-    Ekiga::Message::payload_type::const_iterator iter
-      = message.payload.find ("text/plain");
-    if (iter != message.payload.end ())
-      chat_area_add_message (self, message.name.c_str (), iter->second.c_str ());
-  }
+  mark = gtk_text_buffer_get_mark (buffer, "current-position");
+  gtk_text_view_scroll_to_mark (GTK_TEXT_VIEW (self->priv->text_view), mark,
+                                0.0, FALSE, 0,0);
+}
+
+static bool
+visit_older_messages (ChatArea* self,
+		      GtkTextIter* iter,
+		      std::deque<GtkTextMark*>* marks,
+		      const Ekiga::Message& message)
+{
+  marks->push_back (chat_area_insert_message (self, iter, message));
+  return true;
+}
+
+static void
+on_scrolled (GtkAdjustment* adjustment,
+	     gpointer data)
+{
+  ChatArea* self = (ChatArea*)data;
+  GtkTextBuffer* buffer = NULL;
+  GtkTextIter iter;
+  std::deque<GtkTextMark*> marks;
+  unsigned int first = 0;
+
+  if (gtk_adjustment_get_value (adjustment) > gtk_adjustment_get_lower (adjustment)
+      || self->priv->first_shown == 0
+      || !self->priv->conversation)
+    return;
+
+  /* the user reached the top : add the previous messages there */
+  if (self->priv->first_shown > CHAT_AREA_OLDER_MESSAGES)
+    first = self->priv->first_shown - CHAT_AREA_OLDER_MESSAGES;
+
+  buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (self->priv->text_view));
+  gtk_text_buffer_get_start_iter (buffer, &iter);
+  self->priv->conversation->visit_messages_range (first,
+						  self->priv->first_shown - first,
+						  boost::bind (&visit_older_messages, self, &iter, &marks, _1));
+
+  /* the mark of the formerly first message had left gravity at the
+   * insertion point, so it stayed at the top : put it back where that
+   * message now starts, right after what we inserted */
+  if ( !self->priv->shown.empty ())
+    gtk_text_buffer_move_mark (buffer, self->priv->shown.front (), &iter);
+
+  self->priv->shown.insert (self->priv->shown.begin (), marks.begin (), marks.end ());
+  self->priv->first_shown = first;
+
+  /* don't make what the user was reading jump away */
+  if (self->priv->shown.size () > marks.size ())
+    gtk_text_view_scroll_to_mark (GTK_TEXT_VIEW (self->priv->text_view),
+				  self->priv->shown[marks.size ()],
+				  0.0, TRUE, 0.0, 0.0);
 }
 
 static void
@@ -675,6 +788,7 @@ chat_area_init (ChatArea* self)
 		NULL);
 
   self->priv = new ChatAreaPrivate;
+  self->priv->first_shown = 0;
 
   /* first the area has a text view to display
      the GtkScrolledWindow is there to make
@@ -708,6 +822,8 @@ chat_area_init (ChatArea* self)
 
   gtk_container_add (GTK_CONTAINER (self->priv->scrolled_text_window),
 		     self->priv->text_view);
+  g_signal_connect (gtk_scrolled_window_get_vadjustment (GTK_SCROLLED_WINDOW (self->priv->scrolled_text_window)),
+		    "value-changed", G_CALLBACK (on_scrolled), self);
 
   frame = gtk_frame_new (NULL);
   gtk_frame_set_shadow_type (GTK_FRAME (frame), GTK_SHADOW_IN);
@@ -907,6 +1023,7 @@ chat_area_new (Ekiga::ConversationPtr conversation)
 
   self = (ChatArea*)g_object_new (TYPE_CHAT_AREA, NULL);
   self->priv->conversation = conversation;
+  self->priv->first_shown = conversation->get_older_messages_count ();
   self->priv->connections.add (conversation->removed.connect (boost::bind (&on_conversation_removed, self)));
   self->priv->connections.add (conversation->message_received.connect (boost::bind (&on_message_received, self, _1)));
   conversation->visit_messages (boost::bind (&visit_messages, self, _1));
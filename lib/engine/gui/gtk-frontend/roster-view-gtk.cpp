@@ -36,6 +36,8 @@
  */
 
 #include <ctime>
+#include <map>
+#include <set>
 #include <glib/gi18n.h>
 #include <gdk/gdkkeysyms.h>
 
@@ -52,6 +54,14 @@
 /*
  * The Roster
  */
+struct RosterViewGtkGroupRow
+{
+  GtkTreeIter iter;
+  int total;
+  int offline; // offline or unknown, for the displayed counts
+  int online;  // shown when offline contacts are hidden (see COLUMN_OFFLINE)
+};
+
 struct _RosterViewGtkPrivate
 {
   Ekiga::scoped_connections connections;
@@ -60,6 +70,14 @@ struct _RosterViewGtkPrivate
   GtkTreeView *tree_view;
   GSList *folded_groups;
   gboolean show_offline_contacts;
+
+  /* GtkTreeStore iters persist as long as their row exists, so we index
+   * the rows instead of looking for them : beware that the indexes must
+   * be updated each time a row is removed!
+   */
+  std::map<Ekiga::Heap*, GtkTreeIter> heap_rows;
+  std::map<std::pair<Ekiga::Heap*, std::string>, RosterViewGtkGroupRow> group_rows;
+  std::map<Ekiga::Presentity*, std::map<std::string, GtkTreeIter> > presentity_rows;
 };
 
 typedef struct _StatusIconInfo {
@@ -314,6 +332,16 @@ static void on_presentity_updated (RosterViewGtk* self,
 				   Ekiga::PresentityPtr presentity);
 
 
+/* DESCRIPTION  : Called when the presentities_updated signal has been emitted
+ *                by the PresenceCore.
+ * BEHAVIOR     : Update all the given Presentity, then the groups of the
+ *                affected Heap only once.
+ * PRE          : /
+ */
+static void on_presentities_updated (RosterViewGtk* self,
+				     const std::list<Ekiga::PresenceCore::PresentityUpdate>& updates);
+
+
 /* DESCRIPTION  : Called when the presentity_removed signal has been emitted
  *                by the SignalCentralizer of the BookViewGtk.
  * BEHAVIOR     : Remove the given Presentity from the given Heap.
@@ -368,10 +396,35 @@ static void roster_view_gtk_find_iter_for_group (RosterViewGtk *view,
  */
 static void roster_view_gtk_find_iter_for_presentity (RosterViewGtk *view,
                                                       GtkTreeIter *group_iter,
+                                                      const std::string group,
                                                       Ekiga::PresentityPtr presentity,
                                                       GtkTreeIter *iter);
 
 
+/* DESCRIPTION  : /
+ * BEHAVIOR     : Update the (online/total) counters of the given group
+ *                when one of its presentities goes from the old presence
+ *                to the new one (NULL meaning that it isn't in the group).
+ * PRE          : /
+ */
+static void roster_view_gtk_count_presence (RosterViewGtk *view,
+                                            Ekiga::Heap *heap,
+                                            const std::string group,
+                                            const gchar *old_presence,
+                                            const gchar *new_presence);
+
+
+/* DESCRIPTION  : /
+ * BEHAVIOR     : Remove the given presentity row from the given group,
+ *                the caller has to forget about it in the index.
+ * PRE          : /
+ */
+static void roster_view_gtk_remove_presentity_row (RosterViewGtk *view,
+                                                   Ekiga::Heap *heap,
+                                                   const std::string group,
+                                                   GtkTreeIter *iter);
+
+
 /* DESCRIPTION  : /
  * BEHAVIOR     : Do a clean up in the RosterViewGtk to clean all empty groups
  *                from the view. It also folds or unfolds groups following
@@ -381,6 +434,63 @@ static void roster_view_gtk_find_iter_for_presentity (RosterViewGtk *view,
 static void roster_view_gtk_update_groups (RosterViewGtk *view,
                                            GtkTreeIter *heap_iter);
 
+
+/* DESCRIPTION  : /
+ * BEHAVIOR     : Same as roster_view_gtk_update_groups, but only for the
+ *                given group row.
+ * PRE          : /
+ * RETURN       : FALSE if the group row was removed.
+ */
+static gboolean roster_view_gtk_update_group (RosterViewGtk *view,
+                                              GtkTreeIter *heap_iter,
+                                              GtkTreeIter *iter);
+
+
+/* DESCRIPTION  : /
+ * BEHAVIOR     : Same as roster_view_gtk_update_groups, but only for the
+ *                given groups of the heap : a presentity change only
+ *                needs its own groups to be updated.
+ * PRE          : /
+ */
+static void roster_view_gtk_update_some_groups (RosterViewGtk *view,
+                                                Ekiga::Heap *heap,
+                                                GtkTreeIter *heap_iter,
+                                                const std::set<std::string>& groups);
+
+
+/* DESCRIPTION  : /
+ * BEHAVIOR     : Add to the set the groups the presentity is in, and those
+ *                it has rows in (it may be leaving some).
+ * PRE          : /
+ */
+static void roster_view_gtk_get_presentity_groups (RosterViewGtk *view,
+                                                   Ekiga::PresentityPtr presentity,
+                                                   std::set<std::string>& groups);
+
+
+/* DESCRIPTION  : /
+ * BEHAVIOR     : Add or update the rows of the given presentity in all
+ *                its groups, without cleaning the groups.
+ * PRE          : A valid Heap iter.
+ * RETURN       : TRUE if one of the rows is selected.
+ */
+static gboolean roster_view_gtk_add_presentity_rows (RosterViewGtk *view,
+						     Ekiga::HeapPtr heap,
+						     GtkTreeIter *heap_iter,
+						     Ekiga::PresentityPtr presentity);
+
+
+/* DESCRIPTION  : /
+ * BEHAVIOR     : Same as above, and also remove the rows of the given
+ *                presentity from the groups it isn't in anymore.
+ * PRE          : A valid Heap iter.
+ * RETURN       : TRUE if one of the rows is selected.
+ */
+static gboolean roster_view_gtk_update_presentity_rows (RosterViewGtk *view,
+							Ekiga::HeapPtr heap,
+							GtkTreeIter *heap_iter,
+							Ekiga::PresentityPtr presentity);
+
 /* Implementation of the debuggers */
 
 // static void
@@ -604,33 +714,29 @@ update_offline_count (RosterViewGtk* self,
 		      GtkTreeIter* iter)
 {
   GtkTreeModel *model = NULL;
-  GtkTreeIter loop_iter;
   gint total = 0;
   gint offline_count = 0;
-  gint column_type;
-  Ekiga::Presentity* presentity = NULL;
+  Ekiga::Heap* heap = NULL;
   gchar *name = NULL;
   gchar *name_with_count = NULL;
 
   model = GTK_TREE_MODEL (self->priv->store);
 
-  if (gtk_tree_model_iter_nth_child (model, &loop_iter, iter, 0)) {
+  gtk_tree_model_get (model, iter,
+                      COLUMN_HEAP, &heap,
+                      COLUMN_GROUP_NAME, &name, -1);
+
+  if (name != NULL) {
 
-    do {
+    std::map<std::pair<Ekiga::Heap*, std::string>, RosterViewGtkGroupRow>::const_iterator group
+      = self->priv->group_rows.find (std::make_pair (heap, std::string (name)));
+    if (group != self->priv->group_rows.end ()) {
 
-      gtk_tree_model_get (model, &loop_iter,
-                          COLUMN_TYPE, &column_type,
-                          COLUMN_PRESENTITY, &presentity,
-                          -1);
-      if (column_type == TYPE_PRESENTITY
-          && (presentity->get_presence () == "offline"
-              || presentity->get_presence () == "unknown"))
-        offline_count++;
-    } while (gtk_tree_model_iter_next (model, &loop_iter));
+      total = group->second.total;
+      offline_count = group->second.offline;
+    }
   }
 
-  total = gtk_tree_model_iter_n_children (model, iter);
-  gtk_tree_model_get (model, iter, COLUMN_GROUP_NAME, &name, -1);
   name_with_count = g_strdup_printf ("%s - (%d/%d)", name, total - offline_count, total);
   gtk_tree_store_set (GTK_TREE_STORE (model), iter,
                       COLUMN_NAME, name_with_count, -1);
@@ -797,13 +903,20 @@ group_hide_show_offline (RosterViewGtk* self,
     result = TRUE;
   else {
 
-    GtkTreeIter child_iter;
-    if (gtk_tree_model_iter_nth_child (model, &child_iter, iter, 0)) {
+    // the counts are kept up to date : no need to look at the children
+    Ekiga::Heap* heap = NULL;
+    gchar* name = NULL;
 
-      do {
+    gtk_tree_model_get (model, iter,
+                        COLUMN_HEAP, &heap,
+                        COLUMN_GROUP_NAME, &name,
+                        -1);
+    if (name != NULL) {
 
-        result = presentity_hide_show_offline (self, model, &child_iter);
-      } while (!result && gtk_tree_model_iter_next (model, &child_iter));
+      std::map<std::pair<Ekiga::Heap*, std::string>, RosterViewGtkGroupRow>::const_iterator row
+        = self->priv->group_rows.find (std::make_pair (heap, std::string (name)));
+      result = (row != self->priv->group_rows.end () && row->second.online > 0);
+      g_free (name);
     }
   }
 
@@ -967,9 +1080,13 @@ on_heap_removed (RosterViewGtk* self,
   GtkTreeIter group_iter;
   guint timeout = 0;
 
+  Ekiga::Presentity* presentity = NULL;
+  gchar* group_name = NULL;
+
   roster_view_gtk_find_iter_for_heap (self, heap, &heap_iter);
 
-  // Remove all timeout-based effects for the heap presentities
+  // Remove all timeout-based effects for the heap presentities,
+  // and forget about all the rows we're about to remove
   if (gtk_tree_model_iter_nth_child (GTK_TREE_MODEL (self->priv->store),
                                      &group_iter, &heap_iter, 0)) {
     do {
@@ -978,14 +1095,25 @@ on_heap_removed (RosterViewGtk* self,
         do {
           gtk_tree_model_get (GTK_TREE_MODEL (self->priv->store), &iter,
                               COLUMN_TIMEOUT, &timeout,
+                              COLUMN_PRESENTITY, &presentity,
                               -1);
           if (timeout > 0)
             g_source_remove (timeout);
+          self->priv->presentity_rows.erase (presentity);
         } while (gtk_tree_model_iter_next (GTK_TREE_MODEL (self->priv->store), &iter));
       }
+      gtk_tree_model_get (GTK_TREE_MODEL (self->priv->store), &group_iter,
+                          COLUMN_GROUP_NAME, &group_name,
+                          -1);
+      if (group_name != NULL) {
+
+        self->priv->group_rows.erase (std::make_pair (heap.get (), std::string (group_name)));
+        g_free (group_name);
+      }
     } while (gtk_tree_model_iter_next (GTK_TREE_MODEL (self->priv->store), &group_iter));
   }
 
+  self->priv->heap_rows.erase (heap.get ());
   gtk_tree_store_remove (self->priv->store, &heap_iter);
 }
 
@@ -1008,6 +1136,29 @@ on_presentity_added (RosterViewGtk* self,
 		     Ekiga::PresentityPtr presentity)
 {
   GtkTreeIter heap_iter;
+  std::set<std::string> groups;
+  gboolean should_emit = FALSE;
+
+  roster_view_gtk_find_iter_for_heap (self, heap, &heap_iter);
+
+  should_emit = roster_view_gtk_add_presentity_rows (self, heap, &heap_iter, presentity);
+
+  // no need to refilter : the filter follows the row changes, and the
+  // group rows are changed when their counts are updated
+  roster_view_gtk_get_presentity_groups (self, presentity, groups);
+  roster_view_gtk_update_some_groups (self, heap.get (), &heap_iter, groups);
+
+  if (should_emit)
+    g_signal_emit (self, signals[SELECTION_CHANGED_SIGNAL], 0);
+}
+
+
+static gboolean
+roster_view_gtk_add_presentity_rows (RosterViewGtk *self,
+				     Ekiga::HeapPtr heap,
+				     GtkTreeIter *heap_iter,
+				     Ekiga::PresentityPtr presentity)
+{
   std::set<std::string> groups = presentity->get_groups ();
   GtkTreeSelection* selection = gtk_tree_view_get_selection (self->priv->tree_view);
   GtkTreeModelFilter* filtered_model = GTK_TREE_MODEL_FILTER (gtk_tree_view_get_model (self->priv->tree_view));
@@ -1021,8 +1172,6 @@ on_presentity_added (RosterViewGtk* self,
   gchar *old_presence = NULL;
   gboolean should_emit = FALSE;
 
-  roster_view_gtk_find_iter_for_heap (self, heap, &heap_iter);
-
   active = presentity->get_presence () != "offline";
   away = presentity->get_presence () == "away";
 
@@ -1033,19 +1182,20 @@ on_presentity_added (RosterViewGtk* self,
        group != groups.end ();
        group++) {
 
-    roster_view_gtk_find_iter_for_group (self, heap, &heap_iter,
+    roster_view_gtk_find_iter_for_group (self, heap, heap_iter,
 					 *group, &group_iter);
-    roster_view_gtk_find_iter_for_presentity (self, &group_iter, presentity, &iter);
+    roster_view_gtk_find_iter_for_presentity (self, &group_iter, *group, presentity, &iter);
 
-    if (gtk_tree_store_iter_is_valid (self->priv->store, &iter)
-        && gtk_tree_store_iter_is_valid (self->priv->store, &filtered_iter)
-        && gtk_tree_model_filter_convert_child_iter_to_iter (filtered_model, &filtered_iter, &iter))
+    // (gtk_tree_store_iter_is_valid walks the whole store, don't use it here)
+    if (gtk_tree_model_filter_convert_child_iter_to_iter (filtered_model, &filtered_iter, &iter))
       if (gtk_tree_selection_iter_is_selected (selection, &filtered_iter))
 	should_emit = TRUE;
 
     // Find out what our presence was
     gtk_tree_model_get (GTK_TREE_MODEL (self->priv->store), &iter,
                         COLUMN_PRESENCE, &old_presence, -1);
+    roster_view_gtk_count_presence (self, heap.get (), *group,
+                                    old_presence, presentity->get_presence ().c_str ());
 
     if (old_presence && presentity->get_presence () != old_presence
         && presentity->get_presence () != "unknown" && presentity->get_presence () != "offline"
@@ -1104,10 +1254,26 @@ on_presentity_added (RosterViewGtk* self,
     g_free (old_presence);
   }
 
-  GtkTreeModel* model = gtk_tree_view_get_model (self->priv->tree_view);
-  gtk_tree_model_filter_refilter (GTK_TREE_MODEL_FILTER (model));
+  return should_emit;
+}
 
-  roster_view_gtk_update_groups (self, &heap_iter);
+
+static void
+on_presentity_updated (RosterViewGtk* self,
+		       G_GNUC_UNUSED Ekiga::ClusterPtr cluster,
+		       Ekiga::HeapPtr heap,
+		       Ekiga::PresentityPtr presentity)
+{
+  GtkTreeIter heap_iter;
+  std::set<std::string> groups;
+  gboolean should_emit = FALSE;
+
+  roster_view_gtk_find_iter_for_heap (self, heap, &heap_iter);
+
+  roster_view_gtk_get_presentity_groups (self, presentity, groups);
+  should_emit = roster_view_gtk_update_presentity_rows (self, heap, &heap_iter, presentity);
+
+  roster_view_gtk_update_some_groups (self, heap.get (), &heap_iter, groups);
 
   if (should_emit)
     g_signal_emit (self, signals[SELECTION_CHANGED_SIGNAL], 0);
@@ -1115,58 +1281,68 @@ on_presentity_added (RosterViewGtk* self,
 
 
 static void
-on_presentity_updated (RosterViewGtk* self,
-		       Ekiga::ClusterPtr cluster,
-		       Ekiga::HeapPtr heap,
-		       Ekiga::PresentityPtr presentity)
+on_presentities_updated (RosterViewGtk* self,
+			 const std::list<Ekiga::PresenceCore::PresentityUpdate>& updates)
 {
-  GtkTreeModel *model;
   GtkTreeIter heap_iter;
-  GtkTreeIter group_iter;
-  GtkTreeIter iter;
-  gchar *group_name = NULL;
-  int timeout = 0;
-  std::set<std::string> groups = presentity->get_groups ();
+  std::map<Ekiga::Heap*, std::pair<Ekiga::HeapPtr, std::set<std::string> > > heaps;
+  gboolean should_emit = FALSE;
 
-  model = GTK_TREE_MODEL (self->priv->store);
+  for (std::list<Ekiga::PresenceCore::PresentityUpdate>::const_iterator iter = updates.begin ();
+       iter != updates.end ();
+       ++iter) {
+
+    std::pair<Ekiga::HeapPtr, std::set<std::string> >& heap = heaps[iter->heap.get ()];
+
+    heap.first = iter->heap;
+    roster_view_gtk_get_presentity_groups (self, iter->presentity, heap.second);
+    roster_view_gtk_find_iter_for_heap (self, iter->heap, &heap_iter);
+    if (roster_view_gtk_update_presentity_rows (self, iter->heap, &heap_iter, iter->presentity))
+      should_emit = TRUE;
+  }
+
+  for (std::map<Ekiga::Heap*, std::pair<Ekiga::HeapPtr, std::set<std::string> > >::iterator iter = heaps.begin ();
+       iter != heaps.end ();
+       ++iter) {
+
+    roster_view_gtk_find_iter_for_heap (self, iter->second.first, &heap_iter);
+    roster_view_gtk_update_some_groups (self, iter->first, &heap_iter, iter->second.second);
+  }
+
+  if (should_emit)
+    g_signal_emit (self, signals[SELECTION_CHANGED_SIGNAL], 0);
+}
+
+
+static gboolean
+roster_view_gtk_update_presentity_rows (RosterViewGtk *self,
+					Ekiga::HeapPtr heap,
+					GtkTreeIter *heap_iter,
+					Ekiga::PresentityPtr presentity)
+{
+  std::set<std::string> groups = presentity->get_groups ();
+  gboolean should_emit = FALSE;
 
   if (groups.empty ())
     groups.insert (_("Unsorted"));
 
   // This makes sure we are in all groups where we should
-  on_presentity_added (self, cluster, heap, presentity);
+  should_emit = roster_view_gtk_add_presentity_rows (self, heap, heap_iter, presentity);
 
   // Now let's remove from all the others
-  roster_view_gtk_find_iter_for_heap (self, heap, &heap_iter);
+  std::map<std::string, GtkTreeIter>& rows = self->priv->presentity_rows[presentity.get ()];
+  std::map<std::string, GtkTreeIter>::iterator row = rows.begin ();
+  while (row != rows.end ()) {
 
-  if (gtk_tree_model_iter_nth_child (model, &group_iter, &heap_iter, 0)) {
+    if (groups.find (row->first) == groups.end ()) {
 
-    do {
-
-      gtk_tree_model_get (model, &group_iter,
-                          COLUMN_GROUP_NAME, &group_name,
-                          -1);
-      if (group_name != NULL) {
-
-        if (groups.find (group_name) == groups.end ()) {
-
-          roster_view_gtk_find_iter_for_presentity (self, &group_iter, presentity, &iter);
-          gtk_tree_model_get (GTK_TREE_MODEL (self->priv->store), &iter,
-                              COLUMN_TIMEOUT, &timeout,
-                              -1);
-          if (timeout > 0)
-            g_source_remove (timeout);
-          gtk_tree_store_remove (self->priv->store, &iter);
-        }
-        g_free (group_name);
-      }
-    } while (gtk_tree_model_iter_next (model, &group_iter));
+      roster_view_gtk_remove_presentity_row (self, heap.get (), row->first, &row->second);
+      rows.erase (row++);
+    } else
+      ++row;
   }
 
-  model = gtk_tree_view_get_model (self->priv->tree_view);
-  gtk_tree_model_filter_refilter (GTK_TREE_MODEL_FILTER (model));
-
-  roster_view_gtk_update_groups (self, &heap_iter);
+  return should_emit;
 }
 
 
@@ -1176,30 +1352,24 @@ on_presentity_removed (RosterViewGtk* self,
 		       Ekiga::HeapPtr heap,
 		       Ekiga::PresentityPtr presentity)
 {
-  GtkTreeModel *model = NULL;
   GtkTreeIter heap_iter;
-  GtkTreeIter group_iter;
-  GtkTreeIter iter;
-  int timeout = 0;
+  std::set<std::string> groups;
+  std::map<Ekiga::Presentity*, std::map<std::string, GtkTreeIter> >::iterator rows;
 
   roster_view_gtk_find_iter_for_heap (self, heap, &heap_iter);
-  model = GTK_TREE_MODEL (self->priv->store);
 
-  if (gtk_tree_model_iter_nth_child (model, &group_iter, &heap_iter, 0)) {
-
-    do {
+  roster_view_gtk_get_presentity_groups (self, presentity, groups);
+  rows = self->priv->presentity_rows.find (presentity.get ());
+  if (rows != self->priv->presentity_rows.end ()) {
 
-      roster_view_gtk_find_iter_for_presentity (self, &group_iter, presentity, &iter);
-      gtk_tree_model_get (GTK_TREE_MODEL (self->priv->store), &iter,
-                          COLUMN_TIMEOUT, &timeout,
-                          -1);
-      if (timeout > 0)
-        g_source_remove (timeout);
-      gtk_tree_store_remove (self->priv->store, &iter);
-    } while (gtk_tree_model_iter_next (model, &group_iter));
+    for (std::map<std::string, GtkTreeIter>::iterator row = rows->second.begin ();
+         row != rows->second.end ();
+         ++row)
+      roster_view_gtk_remove_presentity_row (self, heap.get (), row->first, &row->second);
+    self->priv->presentity_rows.erase (rows);
   }
 
-  roster_view_gtk_update_groups (self, &heap_iter);
+  roster_view_gtk_update_some_groups (self, heap.get (), &heap_iter, groups);
 }
 
 static bool
@@ -1223,24 +1393,17 @@ roster_view_gtk_find_iter_for_heap (RosterViewGtk *view,
                                     Ekiga::HeapPtr heap,
                                     GtkTreeIter *iter)
 {
-  GtkTreeModel *model = NULL;
-  Ekiga::Heap *iter_heap = NULL;
-  gboolean found = FALSE;
-
-  model = GTK_TREE_MODEL (view->priv->store);
+  std::map<Ekiga::Heap*, GtkTreeIter>::const_iterator row
+    = view->priv->heap_rows.find (heap.get ());
 
-  if (gtk_tree_model_get_iter_first (model, iter)) {
+  if (row != view->priv->heap_rows.end ()) {
 
-    do {
-
-      gtk_tree_model_get (model, iter, COLUMN_HEAP, &iter_heap, -1);
-      if (iter_heap == heap.get ())
-        found = TRUE;
-    } while (!found && gtk_tree_model_iter_next (model, iter));
+    *iter = row->second;
+    return;
   }
 
-  if (!found)
-    gtk_tree_store_append (view->priv->store, iter, NULL);
+  gtk_tree_store_append (view->priv->store, iter, NULL);
+  view->priv->heap_rows[heap.get ()] = *iter;
 }
 
 
@@ -1251,61 +1414,190 @@ roster_view_gtk_find_iter_for_group (RosterViewGtk *view,
                                      const std::string name,
                                      GtkTreeIter *iter)
 {
-  GtkTreeModel *model = NULL;
-  gchar *group_name = NULL;
-  gboolean found = FALSE;
-
-  model = GTK_TREE_MODEL (view->priv->store);
-
-  if (gtk_tree_model_iter_nth_child (model, iter, heap_iter, 0)) {
+  std::pair<Ekiga::Heap*, std::string> key (heap.get (), name);
+  std::map<std::pair<Ekiga::Heap*, std::string>, RosterViewGtkGroupRow>::const_iterator row
+    = view->priv->group_rows.find (key);
 
-    do {
+  if (row != view->priv->group_rows.end ()) {
 
-      gtk_tree_model_get (model, iter, COLUMN_GROUP_NAME, &group_name, -1);
-      if (group_name != NULL && name == group_name)
-        found = TRUE;
-      if (group_name != NULL)
-        g_free (group_name);
-    } while (!found && gtk_tree_model_iter_next (model, iter));
+    *iter = row->second.iter;
+    return;
   }
 
-  if (!found) {
-
-    gtk_tree_store_append (view->priv->store, iter, heap_iter);
-    gtk_tree_store_set (view->priv->store, iter,
-                        COLUMN_TYPE, TYPE_GROUP,
-                        COLUMN_HEAP, heap.get (),
-                        COLUMN_NAME, name.c_str (),
-                        COLUMN_GROUP_NAME, name.c_str (),
-                        -1);
-  }
+  gtk_tree_store_append (view->priv->store, iter, heap_iter);
+  gtk_tree_store_set (view->priv->store, iter,
+                      COLUMN_TYPE, TYPE_GROUP,
+                      COLUMN_HEAP, heap.get (),
+                      COLUMN_NAME, name.c_str (),
+                      COLUMN_GROUP_NAME, name.c_str (),
+                      -1);
+
+  RosterViewGtkGroupRow group_row;
+  group_row.iter = *iter;
+  group_row.total = 0;
+  group_row.offline = 0;
+  group_row.online = 0;
+  view->priv->group_rows[key] = group_row;
 }
 
 
 static void
 roster_view_gtk_find_iter_for_presentity (RosterViewGtk *view,
                                           GtkTreeIter *group_iter,
+                                          const std::string group,
                                           Ekiga::PresentityPtr presentity,
                                           GtkTreeIter *iter)
+{
+  std::map<std::string, GtkTreeIter>& rows = view->priv->presentity_rows[presentity.get ()];
+  std::map<std::string, GtkTreeIter>::const_iterator row = rows.find (group);
+
+  if (row != rows.end ()) {
+
+    *iter = row->second;
+    return;
+  }
+
+  gtk_tree_store_append (view->priv->store, iter, group_iter);
+  rows[group] = *iter;
+}
+
+
+static gboolean
+is_offline_presence (const gchar *presence)
+{
+  return (!g_strcmp0 (presence, "offline") || !g_strcmp0 (presence, "unknown"));
+}
+
+
+/* as COLUMN_OFFLINE : whether the row is shown with offline contacts hidden */
+static gboolean
+is_shown_presence (const gchar *presence)
+{
+  return g_strcmp0 (presence, "offline") != 0;
+}
+
+
+static void
+roster_view_gtk_count_presence (RosterViewGtk *view,
+                                Ekiga::Heap *heap,
+                                const std::string group,
+                                const gchar *old_presence,
+                                const gchar *new_presence)
+{
+  std::map<std::pair<Ekiga::Heap*, std::string>, RosterViewGtkGroupRow>::iterator row
+    = view->priv->group_rows.find (std::make_pair (heap, group));
+
+  if (row == view->priv->group_rows.end ())
+    return;
+
+  if (old_presence != NULL) {
+
+    row->second.total--;
+    if (is_offline_presence (old_presence))
+      row->second.offline--;
+    if (is_shown_presence (old_presence))
+      row->second.online--;
+  }
+
+  if (new_presence != NULL) {
+
+    row->second.total++;
+    if (is_offline_presence (new_presence))
+      row->second.offline++;
+    if (is_shown_presence (new_presence))
+      row->second.online++;
+  }
+}
+
+
+static void
+roster_view_gtk_remove_presentity_row (RosterViewGtk *view,
+                                       Ekiga::Heap *heap,
+                                       const std::string group,
+                                       GtkTreeIter *iter)
+{
+  gchar *presence = NULL;
+  int timeout = 0;
+
+  gtk_tree_model_get (GTK_TREE_MODEL (view->priv->store), iter,
+                      COLUMN_TIMEOUT, &timeout,
+                      COLUMN_PRESENCE, &presence,
+                      -1);
+  if (timeout > 0)
+    g_source_remove (timeout);
+
+  roster_view_gtk_count_presence (view, heap, group, presence, NULL);
+  g_free (presence);
+
+  gtk_tree_store_remove (view->priv->store, iter);
+}
+
+
+static gboolean
+roster_view_gtk_update_group (RosterViewGtk *view,
+                              GtkTreeIter *heap_iter,
+                              GtkTreeIter *iter)
 {
   GtkTreeModel *model = NULL;
-  Ekiga::Presentity *iter_presentity = NULL;
-  gboolean found = FALSE;
+  GtkTreePath *path = NULL;
+  GSList *existing_group = NULL;
+  Ekiga::Heap* heap = NULL;
+  gchar *name = NULL;
 
   model = GTK_TREE_MODEL (view->priv->store);
 
-  if (gtk_tree_model_iter_nth_child (model, iter, group_iter, 0)) {
+  // If this node has no children, remove it
+  if (!gtk_tree_model_iter_has_child (model, iter)) {
 
-    do {
+    gtk_tree_model_get (model, iter,
+                        COLUMN_HEAP, &heap,
+                        COLUMN_GROUP_NAME, &name,
+                        -1);
+    if (name != NULL) {
 
-      gtk_tree_model_get (model, iter, COLUMN_PRESENTITY, &iter_presentity, -1);
-      if (iter_presentity == presentity.get ())
-        found = TRUE;
-    } while (!found && gtk_tree_model_iter_next (model, iter));
+      view->priv->group_rows.erase (std::make_pair (heap, std::string (name)));
+      g_free (name);
+    }
+    gtk_tree_store_remove (view->priv->store, iter);
+    return FALSE;
   }
 
-  if (!found)
-    gtk_tree_store_append (view->priv->store, iter, group_iter);
+  // Else see if it must be folded or unfolded
+  update_offline_count (view, iter);
+  gtk_tree_model_get (model, iter,
+                      COLUMN_GROUP_NAME, &name, -1);
+  if (name) {
+
+    if (view->priv->folded_groups)
+      existing_group = g_slist_find_custom (view->priv->folded_groups,
+                                            name,
+                                            (GCompareFunc) g_ascii_strcasecmp);
+
+    path = gtk_tree_model_get_path (model, heap_iter);
+    gtk_tree_view_expand_row (view->priv->tree_view, path, FALSE);
+    gtk_tree_path_free (path);
+
+    path = gtk_tree_model_get_path (model, iter);
+    if (path) {
+
+      if (existing_group == NULL) {
+        if (!gtk_tree_view_row_expanded (view->priv->tree_view, path)) {
+          gtk_tree_view_expand_row (view->priv->tree_view, path, TRUE);
+        }
+      }
+      else {
+        if (gtk_tree_view_row_expanded (view->priv->tree_view, path)) {
+          gtk_tree_view_collapse_row (view->priv->tree_view, path);
+        }
+      }
+
+      gtk_tree_path_free (path);
+    }
+
+    g_free (name);
+  }
+
+  return TRUE;
 }
 
 
@@ -1314,14 +1606,9 @@ roster_view_gtk_update_groups (RosterViewGtk *view,
                                GtkTreeIter *heap_iter)
 {
   GtkTreeModel *model = NULL;
-  GtkTreePath *path = NULL;
   GtkTreeIter iter;
-
-  GSList *existing_group = NULL;
-
-  int timeout = 0;
+  GtkTreeIter next;
   gboolean go_on = FALSE;
-  gchar *name = NULL;
 
   model = GTK_TREE_MODEL (view->priv->store);
 
@@ -1329,58 +1616,58 @@ roster_view_gtk_update_groups (RosterViewGtk *view,
 
     do {
 
-      // If this node has children, see if it must be
-      // folded or unfolded
-      if (gtk_tree_model_iter_has_child (model, &iter)) {
-
-        update_offline_count (view, &iter);
-        gtk_tree_model_get (model, &iter,
-                            COLUMN_GROUP_NAME, &name, -1);
-        if (name) {
-
-          if (view->priv->folded_groups)
-            existing_group = g_slist_find_custom (view->priv->folded_groups,
-                                                  name,
-                                                  (GCompareFunc) g_ascii_strcasecmp);
-
-          path = gtk_tree_model_get_path (model, heap_iter);
-          gtk_tree_view_expand_row (view->priv->tree_view, path, FALSE);
-          gtk_tree_path_free (path);
-
-          path = gtk_tree_model_get_path (model, &iter);
-          if (path) {
-
-            if (existing_group == NULL) {
-              if (!gtk_tree_view_row_expanded (view->priv->tree_view, path)) {
-                gtk_tree_view_expand_row (view->priv->tree_view, path, TRUE);
-              }
-            }
-            else {
-              if (gtk_tree_view_row_expanded (view->priv->tree_view, path)) {
-                gtk_tree_view_collapse_row (view->priv->tree_view, path);
-              }
-            }
-
-            gtk_tree_path_free (path);
-          }
-
-          go_on = gtk_tree_model_iter_next (model, &iter);
-        }
+      // the store iters persist, so next stays valid if iter goes away
+      next = iter;
+      go_on = gtk_tree_model_iter_next (model, &next);
+      roster_view_gtk_update_group (view, heap_iter, &iter);
+      iter = next;
+    } while (go_on);
+  }
+}
 
-        g_free (name);
-      }
-      // else remove the node (no children)
-      else {
 
-        gtk_tree_model_get (GTK_TREE_MODEL (view->priv->store), &iter,
-                            COLUMN_TIMEOUT, &timeout,
-                            -1);
-        go_on = gtk_tree_store_remove (view->priv->store, &iter);
-      }
-    } while (go_on);
+static void
+roster_view_gtk_update_some_groups (RosterViewGtk *view,
+                                    Ekiga::Heap *heap,
+                                    GtkTreeIter *heap_iter,
+                                    const std::set<std::string>& groups)
+{
+  for (std::set<std::string>::const_iterator group = groups.begin ();
+       group != groups.end ();
+       ++group) {
+
+    std::map<std::pair<Ekiga::Heap*, std::string>, RosterViewGtkGroupRow>::iterator row
+      = view->priv->group_rows.find (std::make_pair (heap, *group));
+
+    if (row != view->priv->group_rows.end ()) {
+
+      GtkTreeIter iter = row->second.iter;
+      roster_view_gtk_update_group (view, heap_iter, &iter);
+    }
   }
 }
 
+
+static void
+roster_view_gtk_get_presentity_groups (RosterViewGtk *view,
+                                       Ekiga::PresentityPtr presentity,
+                                       std::set<std::string>& groups)
+{
+  std::map<Ekiga::Presentity*, std::map<std::string, GtkTreeIter> >::const_iterator rows
+    = view->priv->presentity_rows.find (presentity.get ());
+  std::set<std::string> current = presentity->get_groups ();
+
+  if (current.empty ())
+    current.insert (_("Unsorted"));
+  groups.insert (current.begin (), current.end ());
+
+  if (rows != view->priv->presentity_rows.end ())
+    for (std::map<std::string, GtkTreeIter>::const_iterator row = rows->second.begin ();
+         row != rows->second.end ();
+         ++row)
+      groups.insert (row->first);
+}
+
 /*
  * GObject stuff
  */
@@ -1569,6 +1856,8 @@ roster_view_gtk_new (boost::shared_ptr<Ekiga::PresenceCore> core)
   self->priv->connections.add (conn);
   conn = core->presentity_updated.connect (boost::bind (&on_presentity_updated, self, _1, _2, _3));
   self->priv->connections.add (conn);
+  conn = core->presentities_updated.connect (boost::bind (&on_presentities_updated, self, _1));
+  self->priv->connections.add (conn);
   conn = core->presentity_removed.connect (boost::bind (&on_presentity_removed, self, _1, _2, _3));
   self->priv->connections.add (conn);
   conn = core->questions.connect (boost::bind (&on_handle_questions, self, _1));
@@ -37,11 +37,16 @@
 
 #include "presence-core.h"
 #include "personal-details.h"
+#include "runtime.h"
 
 
-Ekiga::PresenceCore::PresenceCore ( boost::shared_ptr<Ekiga::PersonalDetails> _details): details(_details)
+Ekiga::PresenceCore::PresenceCore ( boost::shared_ptr<Ekiga::PersonalDetails> _details): update_window(0), flush_scheduled(false), details(_details)
 {
   conns.add (details->updated.connect(boost::bind (&Ekiga::PresenceCore::publish, this)));
+
+  contacts_settings = boost::shared_ptr<Settings> (new Settings (CONTACTS_SCHEMA));
+  conns.add (contacts_settings->changed.connect (boost::bind (&Ekiga::PresenceCore::on_contacts_settings_changed, this, _1)));
+  on_contacts_settings_changed ("presence-update-window");
 }
 
 void
@@ -101,6 +106,16 @@ Ekiga::PresenceCore::on_heap_updated (HeapPtr heap,
 void
 Ekiga::PresenceCore::on_heap_removed (HeapPtr heap, ClusterPtr cluster)
 {
+  std::list<PresentityUpdate>::iterator iter = pending_updates.begin ();
+
+  while (iter != pending_updates.end ())
+    if (iter->heap == heap) {
+
+      pending_presentities.erase (iter->presentity);
+      iter = pending_updates.erase (iter);
+    } else
+      ++iter;
+
   heap_removed (cluster, heap);
 }
 
@@ -117,7 +132,26 @@ Ekiga::PresenceCore::on_presentity_updated (HeapPtr heap,
 					    PresentityPtr presentity,
 					    ClusterPtr cluster)
 {
-  presentity_updated (cluster, heap, presentity);
+  if (update_window == 0) {
+
+    presentity_updated (cluster, heap, presentity);
+    return;
+  }
+
+  if (pending_presentities.insert (presentity).second) {
+
+    PresentityUpdate update;
+    update.cluster = cluster;
+    update.heap = heap;
+    update.presentity = presentity;
+    pending_updates.push_back (update);
+  }
+
+  if ( !flush_scheduled) {
+
+    flush_scheduled = true;
+    Ekiga::Runtime::run_later_in_main (boost::bind (&Ekiga::PresenceCore::flush_presentity_updates, this), update_window);
+  }
 }
 
 void
@@ -125,9 +159,44 @@ Ekiga::PresenceCore::on_presentity_removed (HeapPtr heap,
 					    PresentityPtr presentity,
 					    ClusterPtr cluster)
 {
+  if (pending_presentities.erase (presentity) > 0) {
+
+    for (std::list<PresentityUpdate>::iterator iter = pending_updates.begin ();
+	 iter != pending_updates.end ();
+	 ++iter)
+      if (iter->presentity == presentity) {
+
+	pending_updates.erase (iter);
+	break;
+      }
+  }
+
   presentity_removed (cluster, heap, presentity);
 }
 
+void
+Ekiga::PresenceCore::on_contacts_settings_changed (const std::string key)
+{
+  if (key == "presence-update-window") {
+
+    int window = contacts_settings->get_int ("presence-update-window");
+    update_window = (window > 0) ? window : 0;
+  }
+}
+
+void
+Ekiga::PresenceCore::flush_presentity_updates ()
+{
+  std::list<PresentityUpdate> updates;
+
+  flush_scheduled = false;
+  updates.swap (pending_updates);
+  pending_presentities.clear ();
+
+  if ( !updates.empty ())
+    presentities_updated (updates);
+}
+
 void
 Ekiga::PresenceCore::add_presentity_decorator (boost::shared_ptr<PresentityDecorator> decorator)
 {
@@ -203,7 +272,13 @@ void
 Ekiga::PresenceCore::on_presence_received (const std::string uri,
 					   const std::string presence)
 {
-  uri_infos[uri].presence = presence;
+  uri_info& info = uri_infos[uri];
+
+  // servers like to repeat themselves, especially right after login
+  if (info.presence == presence)
+    return;
+
+  info.presence = presence;
   presence_received (uri, presence);
 }
 
@@ -211,7 +286,12 @@ void
 Ekiga::PresenceCore::on_status_received (const std::string uri,
 					 const std::string status)
 {
-  uri_infos[uri].status = status;
+  uri_info& info = uri_infos[uri];
+
+  if (info.status == status)
+    return;
+
+  info.status = status;
   status_received (uri, status);
 }
 
@@ -42,6 +42,7 @@
 #include "scoped-connections.h"
 #include "cluster.h"
 #include "personal-details.h"
+#include "ekiga-settings.h"
 
 namespace Ekiga
 {
@@ -184,11 +185,26 @@ namespace Ekiga
 
     /** Those signals are forwarding the presentity_added, presentity_updated
      * and presentity_removed from the given Heap of the given Cluster.
+     * When the update window isn't zero, the updates are collected and
+     * delivered together through presentities_updated instead of
+     * presentity_updated.
      */
     boost::signals2::signal<void(ClusterPtr , HeapPtr , PresentityPtr )> presentity_added;
     boost::signals2::signal<void(ClusterPtr , HeapPtr , PresentityPtr )> presentity_updated;
     boost::signals2::signal<void(ClusterPtr , HeapPtr , PresentityPtr )> presentity_removed;
 
+    struct PresentityUpdate
+    {
+      ClusterPtr cluster;
+      HeapPtr heap;
+      PresentityPtr presentity;
+    };
+
+    /** This signal is emitted at the end of each update window, with
+     * the presentities updated during it, each of them given once.
+     */
+    boost::signals2::signal<void(const std::list<PresentityUpdate>&)> presentities_updated;
+
   private:
 
     std::set<ClusterPtr > clusters;
@@ -205,6 +221,14 @@ namespace Ekiga
 				PresentityPtr presentity,
 				ClusterPtr cluster);
 
+    void on_contacts_settings_changed (const std::string key);
+    void flush_presentity_updates ();
+
+    unsigned int update_window; // in milliseconds
+    bool flush_scheduled;
+    std::list<PresentityUpdate> pending_updates;
+    std::set<PresentityPtr> pending_presentities;
+
     /*** API to act on presentities ***/
   public:
 
@@ -312,6 +336,7 @@ namespace Ekiga
   private:
 
     boost::shared_ptr<PersonalDetails> details;
+    boost::shared_ptr<Settings> contacts_settings;
     Ekiga::scoped_connections conns;
   };
 
@@ -0,0 +1,206 @@
+
+/*
+ * Ekiga -- A VoIP and Video-Conferencing application
+ * Copyright (C) 2000-2009 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+/*
+ *                         call-statistics.cpp  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014
+ *   description          : implementation of the statistics of a call
+ *                          and of their history.
+ *
+ */
+
+#include <sstream>
+#include <iomanip>
+
+#include "call-statistics.h"
+
+using namespace Ekiga;
+
+static const char* stream_names[] = {
+  "received_audio", "transmitted_audio", "received_video", "transmitted_video"
+};
+
+static const StreamStatistics&
+get_stream (const CallStatistics& statistics,
+	    unsigned ii)
+{
+  switch (ii) {
+
+  case 0:
+    return statistics.received_audio;
+  case 1:
+    return statistics.transmitted_audio;
+  case 2:
+    return statistics.received_video;
+  default:
+    return statistics.transmitted_video;
+  }
+}
+
+/* codec names are plain encoding names, but let's be careful */
+static std::string
+json_escape (const std::string& str)
+{
+  std::ostringstream result;
+
+  for (std::string::const_iterator iter = str.begin ();
+       iter != str.end ();
+       ++iter) {
+
+    if (*iter == '"' || *iter == '\\')
+      result << '\\' << *iter;
+    else if ((unsigned char)*iter < 0x20)
+      result << "\\u" << std::hex << std::setw (4) << std::setfill ('0') << (int)*iter << std::dec;
+    else
+      result << *iter;
+  }
+
+  return result.str ();
+}
+
+
+StreamStatistics::StreamStatistics ():
+  bandwidth(0.0), packets(0), lost_packets(0), late_packets(0),
+  out_of_order_packets(0), jitter(0), width(0), height(0)
+{
+}
+
+
+CallStatistics::CallStatistics (): elapsed(0)
+{
+}
+
+
+CallStatisticsHistory::CallStatisticsHistory (unsigned capacity_):
+  first(0), capacity(capacity_ > 0 ? capacity_ : 1)
+{
+}
+
+
+void
+CallStatisticsHistory::push_back (const CallStatistics& statistics)
+{
+  if (samples.size () < capacity)
+    samples.push_back (statistics);
+  else {
+
+    samples[first] = statistics;
+    first = (first + 1) % capacity;
+  }
+}
+
+
+unsigned
+CallStatisticsHistory::size () const
+{
+  return samples.size ();
+}
+
+
+const CallStatistics&
+CallStatisticsHistory::operator[] (unsigned index) const
+{
+  return samples[(first + index) % samples.size ()];
+}
+
+
+std::string
+CallStatisticsHistory::to_csv () const
+{
+  std::ostringstream result;
+
+  result << "elapsed";
+  for (unsigned ii = 0; ii < 4; ii++)
+    result << "," << stream_names[ii] << "_codec"
+	   << "," << stream_names[ii] << "_bandwidth"
+	   << "," << stream_names[ii] << "_packets"
+	   << "," << stream_names[ii] << "_lost"
+	   << "," << stream_names[ii] << "_late"
+	   << "," << stream_names[ii] << "_out_of_order"
+	   << "," << stream_names[ii] << "_jitter"
+	   << "," << stream_names[ii] << "_width"
+	   << "," << stream_names[ii] << "_height";
+  result << "\n";
+
+  for (unsigned index = 0; index < size (); index++) {
+
+    const CallStatistics& statistics = (*this)[index];
+
+    result << statistics.elapsed;
+    for (unsigned ii = 0; ii < 4; ii++) {
+
+      const StreamStatistics& stream = get_stream (statistics, ii);
+      result << "," << stream.codec
+	     << "," << stream.bandwidth
+	     << "," << stream.packets
+	     << "," << stream.lost_packets
+	     << "," << stream.late_packets
+	     << "," << stream.out_of_order_packets
+	     << "," << stream.jitter
+	     << "," << stream.width
+	     << "," << stream.height;
+    }
+    result << "\n";
+  }
+
+  return result.str ();
+}
+
+
+std::string
+CallStatisticsHistory::to_json () const
+{
+  std::ostringstream result;
+
+  result << "[";
+  for (unsigned index = 0; index < size (); index++) {
+
+    const CallStatistics& statistics = (*this)[index];
+
+    result << (index > 0 ? ",\n " : "\n ")
+	   << "{\"elapsed\": " << statistics.elapsed;
+    for (unsigned ii = 0; ii < 4; ii++) {
+
+      const StreamStatistics& stream = get_stream (statistics, ii);
+      result << ", \"" << stream_names[ii] << "\": {"
+	     << "\"codec\": \"" << json_escape (stream.codec) << "\""
+	     << ", \"bandwidth\": " << stream.bandwidth
+	     << ", \"packets\": " << stream.packets
+	     << ", \"lost\": " << stream.lost_packets
+	     << ", \"late\": " << stream.late_packets
+	     << ", \"out_of_order\": " << stream.out_of_order_packets
+	     << ", \"jitter\": " << stream.jitter
+	     << ", \"width\": " << stream.width
+	     << ", \"height\": " << stream.height
+	     << "}";
+    }
+    result << "}";
+  }
+  result << "\n]\n";
+
+  return result.str ();
+}
@@ -0,0 +1,125 @@
+
+/*
+ * Ekiga -- A VoIP and Video-Conferencing application
+ * Copyright (C) 2000-2009 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+/*
+ *                         call-statistics.h  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014
+ *   description          : declaration of the statistics of a call
+ *                          and of their history.
+ *
+ */
+
+#ifndef __CALL_STATISTICS_H__
+#define __CALL_STATISTICS_H__
+
+#include <string>
+#include <vector>
+
+/* one sample a second : an hour of history */
+#define CALL_STATISTICS_HISTORY_SIZE 3600
+
+namespace Ekiga
+{
+
+/**
+ * @addtogroup calls
+ * @{
+ */
+
+  /** What is known about one media stream of a call at a given time.
+   * The packet counters are cumulated since the stream was opened, and
+   * are only known for received streams.
+   */
+  struct StreamStatistics
+  {
+    StreamStatistics ();
+
+    std::string codec;
+    double bandwidth;          // in kbytes/s
+    unsigned packets;
+    unsigned lost_packets;
+    unsigned late_packets;
+    unsigned out_of_order_packets;
+    unsigned jitter;           // the jitter buffer size in ms
+    unsigned width;            // the frame size, for video streams
+    unsigned height;
+  };
+
+  /** A snapshot of the statistics of all the streams of a call.
+   */
+  struct CallStatistics
+  {
+    CallStatistics ();
+
+    unsigned elapsed;          // in seconds since the call started
+
+    StreamStatistics received_audio;
+    StreamStatistics transmitted_audio;
+    StreamStatistics received_video;
+    StreamStatistics transmitted_video;
+  };
+
+  /** The latest snapshots of a call, in a fixed-size ring buffer : once
+   * it is full, each new snapshot replaces the oldest one.
+   */
+  class CallStatisticsHistory
+  {
+  public:
+
+    CallStatisticsHistory (unsigned capacity = CALL_STATISTICS_HISTORY_SIZE);
+
+    void push_back (const CallStatistics& statistics);
+
+    unsigned size () const;
+
+    /** Return a snapshot
+     * @param index is 0 for the oldest snapshot kept
+     */
+    const CallStatistics& operator[] (unsigned index) const;
+
+    /** Return the history as CSV, one line per snapshot and a header line
+     */
+    std::string to_csv () const;
+
+    /** Return the history as a JSON array of snapshots
+     */
+    std::string to_json () const;
+
+  private:
+
+    std::vector<CallStatistics> samples;
+    unsigned first;
+    unsigned capacity;
+  };
+
+/**
+ * @}
+ */
+
+};
+
+#endif
@@ -44,6 +44,8 @@
 
 #include <boost/smart_ptr.hpp>
 
+#include "call-statistics.h"
+
 namespace Ekiga
 {
 
@@ -190,6 +192,12 @@ namespace Ekiga
        */
       virtual double get_out_of_order_packets () const = 0;
 
+      /** Return the statistics recorded since the call started, or the
+       * latest of them for long calls
+       * @return the history of the call statistics
+       */
+      virtual const CallStatisticsHistory& get_statistics_history () const = 0;
+
 
 
       /*
@@ -258,6 +266,12 @@ namespace Ekiga
        */
       boost::signals2::signal<void(std::string, StreamType)> stream_resumed;
 
+      /* Signal emitted about once a second while media flows, with the
+       * latest statistics of all the streams (also added to the history)
+       * @param the statistics
+       */
+      boost::signals2::signal<void(const CallStatistics&)> statistics_updated;
+
       /** This signal is emitted when the Call is removed.
        */
       boost::signals2::signal<void(void)> removed;
@@ -51,10 +51,11 @@ VideoInputCore::VideoPreviewManager::VideoPreviewManager (VideoInputCore& _video
   videooutput_core (_videooutput_core)
 {
   width = 176;
-  height = 144;;
+  height = 144;
+  fps = 30;
+  current_frame = 0;
   pause_thread = true;
   end_thread = false;
-  frame = NULL;
   // Since windows does not like to restart a thread that
   // was never started, we do so here
   this->Resume ();
@@ -66,6 +67,7 @@ void VideoInputCore::VideoPreviewManager::quit ()
     PWaitAndSignal q(exit_mutex);
     end_thread = true;
   }
+  run_thread.Signal ();
 
   {
     PWaitAndSignal m(thread_mutex);
@@ -73,7 +75,7 @@ void VideoInputCore::VideoPreviewManager::quit ()
   }
 }
 
-void VideoInputCore::VideoPreviewManager::start (unsigned _width, unsigned _height)
+void VideoInputCore::VideoPreviewManager::start (unsigned _width, unsigned _height, unsigned _fps)
 {
   PTRACE(4, "PreviewManager\tStarting Preview");
 
@@ -81,14 +83,15 @@ void VideoInputCore::VideoPreviewManager::start (unsigned _width, unsigned _heig
     PWaitAndSignal c(capture_mutex);
     width = _width;
     height = _height;
+    fps = (_fps < 1 || _fps > 30) ? 30 : _fps;
+    frames[0] = videooutput_core->get_frame (width, height);
+    frames[1] = videooutput_core->get_frame (width, height);
+    current_frame = 0;
     pause_thread = false;
   }
-  {
-    PWaitAndSignal c(frame_mutex);
-    frame = (char*) malloc (unsigned (width * height * 3 / 2));
-  }
 
   videooutput_core->start();
+  run_thread.Signal ();
 }
 
 void VideoInputCore::VideoPreviewManager::stop ()
@@ -97,46 +100,65 @@ void VideoInputCore::VideoPreviewManager::stop ()
 
   videooutput_core->stop();
 
-  {
-    PWaitAndSignal c(capture_mutex);
-    if (pause_thread)
-      return;
-    pause_thread = true;
-  }
+  PWaitAndSignal c(capture_mutex);
+  if (pause_thread)
+    return;
+  pause_thread = true;
+  frames[0].reset ();
+  frames[1].reset ();
+}
 
-  {
-    PWaitAndSignal c(frame_mutex);
-    if (frame)
-      free (frame);
-  }
+VideoFramePtr VideoInputCore::VideoPreviewManager::get_free_frame ()
+{
+  VideoFramePtr & frame = frames[current_frame];
+
+  current_frame = 1 - current_frame;
+
+  // The display may still hold the frame we displayed two rounds ago,
+  // in which case we do not overwrite it
+  if (!frame.unique () || frame->width != width || frame->height != height)
+    frame = videooutput_core->get_frame (width, height);
+
+  return frame;
 }
 
 void VideoInputCore::VideoPreviewManager::Main ()
 {
   PWaitAndSignal m(thread_mutex);
+  PAdaptiveDelay delay;
   bool exit = end_thread;
   bool capture = !pause_thread;
+  unsigned frame_time = 1000 / fps;
 
   while (!exit) {
 
     {
       PWaitAndSignal c(capture_mutex);
       capture = !pause_thread;
-    }
-    if (capture) {
-      {
-        PWaitAndSignal c(frame_mutex);
-        if (frame) {
-          videoinput_core.get_frame_data(frame);
-          videooutput_core->set_frame_data(frame, width, height, VideoOutputManager::LOCAL, 1);
-        }
+      frame_time = 1000 / fps;
+
+      if (capture && videooutput_core->has_display (VideoOutputManager::LOCAL)) {
+
+        VideoFramePtr frame = get_free_frame ();
+        videoinput_core.get_frame_data (frame->data);
+        videooutput_core->set_frame (frame, VideoOutputManager::LOCAL, 1);
       }
     }
     {
        PWaitAndSignal q(exit_mutex);
        exit = end_thread;
     }
-    Current()->Sleep (50);
+
+    if (exit)
+      break;
+
+    if (capture)
+      delay.Delay (frame_time);
+    else {
+
+      run_thread.Wait ();
+      delay.Restart ();
+    }
   }
 }
 
@@ -171,6 +193,8 @@ VideoInputCore::VideoInputCore (Ekiga::ServiceCore & _core,
   desired_settings.contrast = 0;
 
   current_manager = NULL;
+  grabbed_frames = 0;
+  dropped_frames = 0;
   notification_core = core.get<Ekiga::NotificationCore> ("notification-core");
 
   device_settings = new Settings (VIDEO_DEVICES_SCHEMA);
@@ -407,7 +431,7 @@ void VideoInputCore::set_preview_config (unsigned width, unsigned height, unsign
     internal_close();
 
     internal_open(new_preview_config.width, new_preview_config.height, new_preview_config.fps);
-    preview_manager->start(new_preview_config.width, new_preview_config.height);
+    preview_manager->start(new_preview_config.width, new_preview_config.height, new_preview_config.fps);
   }
 
   preview_config = new_preview_config;
@@ -421,7 +445,7 @@ void VideoInputCore::start_preview ()
   PTRACE(4, "VidInputCore\tStarting preview " << preview_config);
   if (!preview_config.active && !stream_config.active) {
     internal_open(preview_config.width, preview_config.height, preview_config.fps);
-    preview_manager->start(preview_config.width, preview_config.height);
+    preview_manager->start(preview_config.width, preview_config.height, preview_config.fps);
   }
 
   preview_config.active = true;
@@ -474,6 +498,8 @@ void VideoInputCore::start_stream ()
     internal_open(stream_config.width, stream_config.height, stream_config.fps);
   }
 
+  g_atomic_int_set (&grabbed_frames, 0);
+  g_atomic_int_set (&dropped_frames, 0);
   stream_config.active = true;
 }
 
@@ -488,7 +514,7 @@ void VideoInputCore::stop_stream ()
       internal_close();
       internal_open(preview_config.width, preview_config.height, preview_config.fps);
     }
-    preview_manager->start(preview_config.width, preview_config.height);
+    preview_manager->start(preview_config.width, preview_config.height, preview_config.fps);
   }
 
   if (!preview_config.active && stream_config.active) {
@@ -501,8 +527,11 @@ void VideoInputCore::stop_stream ()
 void VideoInputCore::get_frame_data (char *data)
 {
   if (current_manager) {
-    if (!current_manager->get_frame_data(data)) {
+    if (current_manager->get_frame_data(data))
+      g_atomic_int_inc (&grabbed_frames);
+    else {
 
+      g_atomic_int_inc (&dropped_frames);
       PWaitAndSignal m(core_mutex);
       internal_close();
 
@@ -519,6 +548,13 @@ void VideoInputCore::get_frame_data (char *data)
   }
 }
 
+void VideoInputCore::get_capture_statistics (unsigned & grabbed,
+                                             unsigned & dropped) const
+{
+  grabbed = g_atomic_int_get (&grabbed_frames);
+  dropped = g_atomic_int_get (&dropped_frames);
+}
+
 void VideoInputCore::set_colour (unsigned colour)
 {
   PWaitAndSignal m(settings_mutex);
@@ -579,7 +615,7 @@ void VideoInputCore::internal_set_device(const VideoInputDevice & device, int ch
 
   if (preview_config.active && !stream_config.active) {
     internal_open(preview_config.width, preview_config.height, preview_config.fps);
-    preview_manager->start(preview_config.width,preview_config.height);
+    preview_manager->start(preview_config.width, preview_config.height, preview_config.fps);
   }
 
   if (stream_config.active)
@@ -265,6 +265,15 @@ namespace Ekiga
        */
       void get_frame_data (char *data);
 
+      /** Get the capture statistics
+       * The counters are reset each time the stream is started.
+       * @param grabbed the number of frames read from the device.
+       * @param dropped the number of frames the device failed to return,
+       * and which were read from the fallback device instead.
+       */
+      void get_capture_statistics (unsigned & grabbed,
+                                   unsigned & dropped) const;
+
 
       /** See vidinput-manager.h for the API
        */
@@ -321,6 +330,11 @@ private:
         * used for displaying the preview video. This thread will run only 
         * while preview is active. It is called from the VideoInputCore, which
         * has the interface to the application for enabling and disabling the preview.
+        *
+        * The thread is paced at the configured frame rate, and grabs directly
+        * into two preallocated frames of the video output frame pool, which are
+        * displayed without any copy. When no local display is attached, frames
+        * are neither grabbed nor displayed.
         */
       class VideoPreviewManager : public PThread
       {
@@ -341,8 +355,9 @@ private:
         * In case the resolution is changed, the preview manager has to be stopped and restarted.
         * @param width the frame width in pixels of the preview video.
         * @param height the frame width in pixels of the preview video.
+        * @param fps the frame rate of the preview video.
         */
-        virtual void start(unsigned _width, unsigned _height);
+        virtual void start(unsigned _width, unsigned _height, unsigned _fps);
 
         /** Stop the preview thread.
         * Stop the thread represented by the Main() function. Blocks until the thread has terminated.
@@ -351,20 +366,24 @@ private:
 
       protected:
         void Main ();
-        char* frame;
+        VideoFramePtr get_free_frame ();
+
+        VideoFramePtr frames[2];
+        unsigned current_frame;
 
         bool end_thread;
         bool pause_thread;
 
         PMutex exit_mutex;
         PMutex thread_mutex;
-        PMutex frame_mutex;
         PMutex capture_mutex;
+        PSyncPoint run_thread;
 
         VideoInputCore  & videoinput_core;
         boost::shared_ptr<VideoOutputCore> videooutput_core;
         unsigned width;
         unsigned height;
+        unsigned fps;
       };
 
       /** Class for storing the device configuration.
@@ -438,6 +457,9 @@ private:
       PMutex core_mutex;
       PMutex settings_mutex;
 
+      volatile gint grabbed_frames;
+      volatile gint dropped_frames;
+
       Ekiga::ServiceCore & core;
       VideoPreviewManager* preview_manager;
       boost::shared_ptr<Ekiga::NotificationCore> notification_core;
@@ -41,16 +41,21 @@
 
 using namespace Ekiga;
 
-VideoOutputCore::VideoOutputCore ()
+VideoOutputCore::VideoOutputCore ():
+  frame_pool(new VideoFramePool)
 {
   PWaitAndSignal m(core_mutex);
 
   number_times_started = 0;
+
+  for (int i = 0 ; i < VideoOutputManager::MAX_VIEWS ; i++)
+    display_attached[i] = 0;
 }
 
 VideoOutputCore::~VideoOutputCore ()
 {
   PWaitAndSignal m(core_mutex);
+  PWriteWaitAndSignal w(managers_mutex);
 
   for (std::set<VideoOutputManager *>::iterator iter = managers.begin ();
        iter != managers.end ();
@@ -64,6 +69,7 @@ VideoOutputCore::~VideoOutputCore ()
 void VideoOutputCore::add_manager (VideoOutputManager &manager)
 {
   PWaitAndSignal m(core_mutex);
+  PWriteWaitAndSignal w(managers_mutex);
 
   managers.insert (&manager);
   manager_added (manager);
@@ -128,7 +134,7 @@ void VideoOutputCore::set_frame_data (const char *data,
                                       VideoOutputManager::VideoView type,
                                       int devices_nbr)
 {
-  PWaitAndSignal m(core_mutex);
+  PReadWaitAndSignal m(managers_mutex);
 
   for (std::set<VideoOutputManager *>::iterator iter = managers.begin ();
        iter != managers.end ();
@@ -137,11 +143,33 @@ void VideoOutputCore::set_frame_data (const char *data,
   }
 }
 
+VideoFramePtr VideoOutputCore::get_frame (unsigned width,
+                                          unsigned height)
+{
+  return frame_pool->get_frame (width, height);
+}
+
+void VideoOutputCore::set_frame (VideoFramePtr frame,
+                                 VideoOutputManager::VideoView type,
+                                 int devices_nbr)
+{
+  PReadWaitAndSignal m(managers_mutex);
+
+  for (std::set<VideoOutputManager *>::iterator iter = managers.begin ();
+       iter != managers.end ();
+       iter++) {
+    (*iter)->set_frame (frame, type, devices_nbr);
+  }
+}
+
 void VideoOutputCore::set_display_info (const gpointer _local,
                                         const gpointer _remote)
 {
   PWaitAndSignal m(core_mutex);
 
+  g_atomic_int_set (&display_attached[VideoOutputManager::LOCAL], _local != NULL);
+  g_atomic_int_set (&display_attached[VideoOutputManager::REMOTE], _remote != NULL);
+
   for (std::set<VideoOutputManager *>::iterator iter = managers.begin ();
        iter != managers.end ();
        iter++) {
@@ -153,6 +181,8 @@ void VideoOutputCore::set_ext_display_info (const gpointer _ext)
 {
   PWaitAndSignal m(core_mutex);
 
+  g_atomic_int_set (&display_attached[VideoOutputManager::EXTENDED], _ext != NULL);
+
   for (std::set<VideoOutputManager *>::iterator iter = managers.begin ();
        iter != managers.end ();
        iter++) {
@@ -160,6 +190,11 @@ void VideoOutputCore::set_ext_display_info (const gpointer _ext)
   }
 }
 
+bool VideoOutputCore::has_display (VideoOutputManager::VideoView type) const
+{
+  return g_atomic_int_get (&display_attached[type]);
+}
+
 
 void VideoOutputCore::on_device_opened (VideoOutputManager::VideoView type,
                                         unsigned width,
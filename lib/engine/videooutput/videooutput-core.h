@@ -46,6 +46,7 @@
 #include <glib.h>
 #include <ptlib.h>
 
+#include "videooutput-frame.h"
 #include "videooutput-manager.h"
 
 namespace Ekiga
@@ -59,7 +60,11 @@ namespace Ekiga
   /** Core object for the video display support
    *
    * The VideoOutputCore will control the different VideoOutputManagers and pass pointers to 
-   * the frames to all of them.
+   * the frames to all of them. Producers can also get refcounted frames from the core
+   * frame pool, fill them in place, and hand them over with set_frame(), which avoids
+   * any per-frame allocation and lets the displays use the frames without copying them.
+   * Frames for the different views (local, remote, extended) can be passed concurrently
+   * from different threads : they do not serialize on a common lock.
    * Before passing the first frame, start() has to be called. In order to close the video,
    * stop() has to be called. The video output core interacts with the GUI when switching to fullscreen,
    * when the size of the video has been changed and when a device is opened and closed.
@@ -139,9 +144,40 @@ namespace Ekiga
                            VideoOutputManager::VideoView type,
                            int devices_nbr);
 
+      /** Get a frame from the frame pool
+       * The frame is to be filled and then passed to set_frame(), so that the
+       * displays can use it without copying it. It is recycled once every
+       * display is done with it. This function is thread-safe and does not
+       * take the core lock.
+       * @param width the width in pixels of the frame.
+       * @param height the height in pixels of the frame.
+       * @return a frame big enough for a width x height YUV420P image.
+       */
+      VideoFramePtr get_frame (unsigned width,
+                               unsigned height);
+
+      /** Display a single pooled frame
+       * Pass the frame to all registered managers.
+       * The video output must have been started before.
+       * @param frame a frame obtained with get_frame() and filled.
+       * @param type the type of the frame: 0 - local video source or >0 from the remote end.
+       * @param devices_nbr 1 if only local or remote device has been opened, 2 if both have been opened.
+       */
+      void set_frame (VideoFramePtr frame,
+                      VideoOutputManager::VideoView type,
+                      int devices_nbr);
+
       void set_display_info (const gpointer _local, const gpointer _remote);
       void set_ext_display_info (const gpointer _ext);
 
+      /** Check whether a display is attached to a view
+       * Producers can use this to avoid grabbing frames nobody will see.
+       * This function is thread-safe and does not take the core lock.
+       * @param type the view to check.
+       * @return true if set_display_info() attached a display to that view.
+       */
+      bool has_display (VideoOutputManager::VideoView type) const;
+
 
       /*** Signals ***/
 
@@ -171,7 +207,17 @@ namespace Ekiga
 
       int number_times_started;
 
+      boost::shared_ptr<VideoFramePool> frame_pool;
+
+      volatile gint display_attached[VideoOutputManager::MAX_VIEWS];
+
       PMutex core_mutex;
+
+      /* Frames only need the list of managers not to change : they take
+       * this lock for reading, so that the different views never wait
+       * for each other
+       */
+      PReadWriteMutex managers_mutex;
     };
 /**
  * @}
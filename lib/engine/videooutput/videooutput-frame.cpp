@@ -0,0 +1,120 @@
+
+/*
+ * Ekiga -- A VoIP and Video-Conferencing application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+/*
+ *                         videooutput-frame.cpp  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014
+ *   description          : Implementation of refcounted video frames,
+ *                          recycled by a frame pool.
+ *
+ */
+
+#include <stdlib.h>
+
+#include <boost/bind.hpp>
+
+#include "videooutput-frame.h"
+
+using namespace Ekiga;
+
+VideoFrame::VideoFrame (unsigned _capacity):
+  capacity(_capacity), width(0), height(0)
+{
+  data = (char*) malloc (capacity);
+}
+
+VideoFrame::~VideoFrame ()
+{
+  free (data);
+}
+
+
+VideoFramePool::VideoFramePool (unsigned _max_frames):
+  max_frames(_max_frames)
+{
+}
+
+VideoFramePool::~VideoFramePool ()
+{
+  PWaitAndSignal m(pool_mutex);
+
+  for (std::vector<VideoFrame*>::iterator iter = frames.begin ();
+       iter != frames.end ();
+       ++iter)
+    delete *iter;
+  frames.clear ();
+}
+
+VideoFramePtr
+VideoFramePool::get_frame (unsigned width,
+                           unsigned height)
+{
+  VideoFrame* frame = NULL;
+  unsigned size = width * height * 3 / 2;
+
+  {
+    PWaitAndSignal m(pool_mutex);
+
+    for (std::vector<VideoFrame*>::iterator iter = frames.begin ();
+         iter != frames.end ();
+         ++iter) {
+
+      if ((*iter)->capacity >= size) {
+
+        frame = *iter;
+        frames.erase (iter);
+        break;
+      }
+    }
+  }
+
+  if (frame == NULL)
+    frame = new VideoFrame (size);
+
+  frame->width = width;
+  frame->height = height;
+
+  // the deleter holds a reference on the pool
+  return VideoFramePtr (frame, boost::bind (&VideoFramePool::release,
+                                            shared_from_this (), _1));
+}
+
+void
+VideoFramePool::release (VideoFrame* frame)
+{
+  {
+    PWaitAndSignal m(pool_mutex);
+
+    if (frames.size () < max_frames) {
+
+      frames.push_back (frame);
+      frame = NULL;
+    }
+  }
+
+  delete frame;
+}
@@ -0,0 +1,132 @@
+
+/*
+ * Ekiga -- A VoIP and Video-Conferencing application
+ * Copyright (C) 2000-2014 Damien Sandras <dsandras@seconix.com>
+
+ * This program is free software; you can  redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version. This program is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the
+ * implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Ekiga is licensed under the GPL license and as a special exception, you
+ * have permission to link or otherwise combine this program with the
+ * programs OPAL, OpenH323 and PWLIB, and distribute the combination, without
+ * applying the requirements of the GNU GPL to the OPAL, OpenH323 and PWLIB
+ * programs, as long as you do follow the requirements of the GNU GPL for all
+ * the rest of the software thus combined.
+ */
+
+
+/*
+ *                         videooutput-frame.h  -  description
+ *                         ------------------------------------------
+ *   begin                : written in 2014
+ *   description          : Declaration of refcounted video frames, recycled
+ *                          by a frame pool.
+ *
+ */
+
+#ifndef __VIDEOOUTPUT_FRAME_H__
+#define __VIDEOOUTPUT_FRAME_H__
+
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/noncopyable.hpp>
+#include <ptlib.h>
+
+namespace Ekiga
+{
+
+/**
+ * @addtogroup videooutput
+ * @{
+ */
+
+  /** A YUV420P video frame.
+   *
+   * Frames are obtained from a VideoFramePool, filled by the producer
+   * (decoder, preview grabber) and then handed over to the displays.
+   * When the last reference is dropped, the memory goes back to the pool
+   * instead of being freed, so that no memory is allocated per frame.
+   */
+  class VideoFrame:
+    public boost::noncopyable
+  {
+  public:
+
+    VideoFrame (unsigned _capacity);
+
+    ~VideoFrame ();
+
+    /** Frame data, at least width*height*3/2 bytes.
+     */
+    char* data;
+
+    /** The allocated size of data, in bytes.
+     */
+    unsigned capacity;
+
+    unsigned width;
+    unsigned height;
+
+    /** Returns the size of the image in bytes.
+     */
+    unsigned get_size () const
+    { return width * height * 3 / 2; }
+  };
+
+  typedef boost::shared_ptr<VideoFrame> VideoFramePtr;
+
+
+  /** A pool of recycled VideoFrame.
+   *
+   * The pool is thread-safe, and it stays alive as long as one of its
+   * frames is referenced, so frames can be held by a display pipeline
+   * after their producer is gone.
+   */
+  class VideoFramePool:
+    public boost::enable_shared_from_this<VideoFramePool>,
+    public boost::noncopyable
+  {
+  public:
+
+    /** The constructor
+     * @param max_frames the maximum number of unused frames kept around.
+     */
+    VideoFramePool (unsigned max_frames = 4);
+
+    ~VideoFramePool ();
+
+    /** Get a frame, recycled if possible.
+     * The pool MUST be held by a boost::shared_ptr.
+     * @param width the width in pixels of the frame.
+     * @param height the height in pixels of the frame.
+     * @return a frame big enough for a width x height YUV420P image.
+     */
+    VideoFramePtr get_frame (unsigned width,
+                             unsigned height);
+
+  private:
+
+    void release (VideoFrame* frame);
+
+    PMutex pool_mutex;
+    std::vector<VideoFrame*> frames;
+    unsigned max_frames;
+  };
+
+/**
+ * @}
+ */
+
+};
+
+#endif
@@ -43,6 +43,7 @@
 #include <glib.h>
 
 #include "videooutput-core.h"
+#include "videooutput-frame.h"
 
 namespace Ekiga
 {
@@ -86,6 +87,9 @@ namespace Ekiga
 
       /** Set one video frame buffer.
        * Requires the device to be opened.
+       * Frames of different views can be set concurrently from different
+       * threads, also while the device is being opened or closed : the
+       * manager is responsible for its own locking.
        * @param data a pointer to the buffer with the data to be written. It will not be freed.
        * @param width the width in pixels of the frame to be written.
        * @param height the height in pixels of the frame to be written.
@@ -98,6 +102,21 @@ namespace Ekiga
                                    VideoView type,
                                    int devices_nbr) = 0;
 
+      /** Set one video frame.
+       * Requires the device to be opened.
+       * The frame is refcounted : managers able to display it without
+       * copying should reimplement this and keep a reference to the frame
+       * as long as they need it. The default implementation falls back
+       * to set_frame_data().
+       * @param frame the frame to be displayed.
+       * @param type the type of the frame: 0 - local video source or >0 from the remote end.
+       * @param devices_nbr 1 if only local or remote device has been opened, 2 if both have been opened.
+       */
+      virtual void set_frame (VideoFramePtr frame,
+                              VideoView type,
+                              int devices_nbr)
+      { set_frame_data (frame->data, frame->width, frame->height, type, devices_nbr); }
+
       virtual void set_display_info (G_GNUC_UNUSED const gpointer local,
                                      G_GNUC_UNUSED const gpointer remote) { };
       virtual void set_ext_display_info (G_GNUC_UNUSED const gpointer ext) { };
@@ -179,8 +179,9 @@ gm_text_buffer_enhancer_insert_text (GmTextBufferEnhancer* self,
   gint best_length = 0;
   GSList* helper_ptr = NULL;
   GmTextBufferEnhancerHelper* considered_helper = NULL;
-  gint considered_start = 0;
-  gint considered_length = 0;
+  gint* considered_starts = NULL;
+  gint* considered_lengths = NULL;
+  gint ii = 0;
   GSList* tag_ptr = NULL;
   GtkTextMark* mark = NULL;
   GtkTextIter tag_start_iter;
@@ -198,6 +199,23 @@ gm_text_buffer_enhancer_insert_text (GmTextBufferEnhancer* self,
 
   mark = gtk_text_buffer_create_mark (priv->buffer, NULL, iter, TRUE);
 
+  /* what each helper answered last time : the answer is still good as
+   * long as we didn't go past the match it gave, so a helper only gets
+   * asked again once its match has been used or skipped -- otherwise
+   * each helper would scan the rest of the text after each decoration,
+   * which is quadratic on long messages.
+   * Nothing is known at first, hence the fake match before the start.
+   */
+  considered_starts = g_new (gint, g_slist_length (priv->helpers));
+  considered_lengths = g_new (gint, g_slist_length (priv->helpers));
+  for (ii = 0, helper_ptr = priv->helpers;
+       helper_ptr != NULL;
+       ii++, helper_ptr = g_slist_next (helper_ptr)) {
+
+    considered_starts[ii] = -1;
+    considered_lengths[ii] = 1;
+  }
+
   while (position < length) {
 
     /* try to find the best helper,
@@ -205,24 +223,31 @@ gm_text_buffer_enhancer_insert_text (GmTextBufferEnhancer* self,
     best_helper = NULL;
     best_start = length;
     best_length = 0;
-    for (helper_ptr = priv->helpers ;
+    for (ii = 0, helper_ptr = priv->helpers ;
 	 helper_ptr != NULL ;
-	 helper_ptr = g_slist_next (helper_ptr)) {
+	 ii++, helper_ptr = g_slist_next (helper_ptr)) {
 
       considered_helper
 	= GM_TEXT_BUFFER_ENHANCER_HELPER (helper_ptr->data);
-      gm_text_buffer_enhancer_helper_check (considered_helper,
-					    text, position,
-					    &considered_start,
-					    &considered_length);
-      if (((considered_start < best_start)
-	   && (considered_length > 0))
-	  || ((considered_start == best_start)
-	      && (considered_length > best_length))) {
+
+      /* a helper which found nothing won't find anything further down */
+      if (considered_lengths[ii] > 0 && considered_starts[ii] < position) {
+
+	considered_starts[ii] = length;
+	gm_text_buffer_enhancer_helper_check (considered_helper,
+					      text, position,
+					      &considered_starts[ii],
+					      &considered_lengths[ii]);
+      }
+
+      if (((considered_starts[ii] < best_start)
+	   && (considered_lengths[ii] > 0))
+	  || ((considered_starts[ii] == best_start)
+	      && (considered_lengths[ii] > best_length))) {
 
 	best_helper = considered_helper;
-	best_start = considered_start;
-	best_length = considered_length;
+	best_start = considered_starts[ii];
+	best_length = considered_lengths[ii];
       }
     }
 
@@ -259,4 +284,6 @@ gm_text_buffer_enhancer_insert_text (GmTextBufferEnhancer* self,
 
   gtk_text_buffer_delete_mark (priv->buffer, mark);
   g_slist_free (active_tags);
+  g_free (considered_starts);
+  g_free (considered_lengths);
 }
@@ -64,6 +64,42 @@ G_DEFINE_TYPE_EXTENDED (GmTextSmiley, gm_text_smiley, G_TYPE_OBJECT, 0,
 			G_IMPLEMENT_INTERFACE (GM_TYPE_TEXT_BUFFER_ENHANCER_HELPER,
 					       enhancer_helper_interface_init));
 
+/* the smileys (as indices in the gm_get_smileys table), sorted by their
+ * first character and then longest first : that way the text is scanned
+ * once, and only the few smileys which could start at a given place are
+ * compared there
+ */
+static GSList* smileys_by_first_char[256];
+
+static gint
+compare_smiley_lengths (gconstpointer a,
+			gconstpointer b)
+{
+  const gchar **smileys = gm_get_smileys ();
+
+  return strlen (smileys[GPOINTER_TO_INT (b)])
+    - strlen (smileys[GPOINTER_TO_INT (a)]);
+}
+
+/* returns the index of the longest smiley at the start of text, or -1 */
+static gint
+find_smiley_at (const gchar* text)
+{
+  const gchar **smileys = gm_get_smileys ();
+  GSList* ptr = NULL;
+
+  for (ptr = smileys_by_first_char[(guchar)text[0]];
+       ptr != NULL;
+       ptr = g_slist_next (ptr)) {
+
+    const gchar* smiley = smileys[GPOINTER_TO_INT (ptr->data)];
+    if (strncmp (text, smiley, strlen (smiley)) == 0)
+      return GPOINTER_TO_INT (ptr->data);
+  }
+
+  return -1;
+}
+
 /* implementation of the GmTextBufferEnhancerHelperInterface code */
 
 static void
@@ -74,42 +110,25 @@ enhancer_helper_check (G_GNUC_UNUSED GmTextBufferEnhancerHelper* self,
 		       gint* length)
 {
   const gchar **smileys = gm_get_smileys ();
-  gint smiley = 0;
-  gint best_start = 0;
-  gint best_smiley = -1;
-  char* found = NULL;
-  gint found_start = 0;
+  const gchar* ptr = NULL;
+  gint smiley = -1;
 
-  /* all smileys are checked, and the one chosen is:
+  /* the smiley chosen is:
      - the one which starts the soonest;
      - in case of equality, the one which is the longest.
   */
-  for (smiley = 0;
-       smileys[smiley] != NULL;
-       smiley = smiley + 2) {
-
-    found = strstr (full_text + from, smileys[smiley]);
-    if (found != NULL) {
-
-      found_start = found - full_text;
-      if ((best_smiley == -1)
-          || (found_start < best_start)
-	  || ((found_start == best_start)
-	      && (strlen (smileys[smiley]) > strlen (smileys[best_smiley])))) {
-
-	best_smiley = smiley;
-	best_start = found_start;
-      }
-    }
-  }
+  for (ptr = full_text + from; *ptr != '\0'; ptr++) {
 
+    smiley = find_smiley_at (ptr);
+    if (smiley != -1) {
 
-  if (best_smiley != -1) {
+      *start = ptr - full_text;
+      *length = strlen (smileys[smiley]);
+      return;
+    }
+  }
 
-    *start = best_start;
-    *length = strlen (smileys[best_smiley]);
-  } else
-    *length = 0;
+  *length = 0;
 }
 
 static void
@@ -117,38 +136,24 @@ enhancer_helper_enhance (G_GNUC_UNUSED GmTextBufferEnhancerHelper* self,
 			 GtkTextBuffer* buffer,
 			 GtkTextIter* iter,
 			 G_GNUC_UNUSED GSList** tags,
-			 G_GNUC_UNUSED const gchar* full_text,
+			 const gchar* full_text,
 			 gint* start,
 			 gint length)
 {
   const gchar **smileys = gm_get_smileys ();
-  gchar* smiley = NULL;
-  gint ii = 0;
-  const gchar* pixbuf_name = NULL;
+  gint smiley = -1;
   GdkPixbuf* pixbuf = NULL;
 
-  smiley = g_malloc0 (length + 1);
-
-  strncpy (smiley, full_text + *start, length);
+  smiley = find_smiley_at (full_text + *start);
 
-  for (ii = 0;
-       smileys[ii] != NULL;
-       ii = ii + 2) {
-
-    if (g_strcmp0 (smiley, smileys[ii]) == 0)
-      pixbuf_name = smileys[ii + 1];
-  }
-
-  if (pixbuf_name != NULL) {
+  if (smiley != -1 && (gint)strlen (smileys[smiley]) == length) {
 
     pixbuf = gtk_icon_theme_load_icon (gtk_icon_theme_get_default (),
-				       pixbuf_name, 16, 0, NULL);
+				       smileys[smiley + 1], 16, 0, NULL);
     gtk_text_buffer_insert_pixbuf (buffer, iter, pixbuf);
     g_object_unref (pixbuf);
     *start = *start + length;
   }
-
-  g_free (smiley);
 }
 
 static void
@@ -163,6 +168,13 @@ enhancer_helper_interface_init (GmTextBufferEnhancerHelperInterface* iface)
 static void
 gm_text_smiley_class_init (G_GNUC_UNUSED GmTextSmileyClass* g_class)
 {
+  const gchar **smileys = gm_get_smileys ();
+  gint ii = 0;
+
+  for (ii = 0; smileys[ii] != NULL; ii = ii + 2)
+    smileys_by_first_char[(guchar)smileys[ii][0]]
+      = g_slist_insert_sorted (smileys_by_first_char[(guchar)smileys[ii][0]],
+			       GINT_TO_POINTER (ii), compare_smiley_lengths);
 }
 
 static void
@@ -111,6 +111,7 @@ GST::AudioInputManager::open (unsigned channels,
 
   worker = gst_helper_new (command);
   g_free (command);
+  gst_helper_enable_software_volume (worker);
 
   Ekiga::AudioInputSettings settings;
   gfloat vol = gst_helper_get_volume (worker);
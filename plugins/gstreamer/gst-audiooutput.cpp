@@ -109,6 +109,7 @@ GST::AudioOutputManager::open (Ekiga::AudioOutputPS ps,
   command = g_strdup_printf ("appsrc"
 			     " is-live=true format=time do-timestamp=true"
 			     " min-latency=1 max-latency=5000000"
+			     " max-bytes=%d"
 			     " name=ekiga_src"
 			     " caps=audio/x-raw-int"
 			     ",rate=%d"
@@ -117,10 +118,13 @@ GST::AudioOutputManager::open (Ekiga::AudioOutputPS ps,
 			     ",depth=%d"
 			     ",signed=true,endianness=1234"
 			     " ! %s",
+			     // the appsrc queue holds 60 ms of sound at most
+			     3 * samplerate * channels * (bits_per_sample / 8) / 50,
 			     samplerate, channels, bits_per_sample, bits_per_sample,
 			     devices_by_name[std::pair<std::string,std::string>(current_state[ii].device.source, current_state[ii].device.name)].c_str ());
   worker[ii] = gst_helper_new (command);
   g_free (command);
+  gst_helper_enable_software_volume (worker[ii]);
 
   Ekiga::AudioOutputSettings settings;
   gfloat vol = gst_helper_get_volume (worker[ii]);
@@ -36,24 +36,198 @@
  */
 
 #include "gst-helper.h"
+#include "audio-dsp.h"
+
+#include <ptlib.h>
+#include <deque>
+#include <vector>
 
 #include <gst/base/gstadapter.h>
 #include <gst/app/gstappsrc.h>
 #include <gst/app/gstappsink.h>
 #include <gst/app/gstappbuffer.h>
 
+/* How long (in ms) we wait for the pipeline before giving up on a frame */
+#define GST_HELPER_TIMEOUT 100
+
+/* How many pulled buffers wait for the reader at most : like the
+ * max_buffers=2 drop=true of the appsinks, the oldest go first
+ */
+#define GST_HELPER_MAX_QUEUED 2
+
+/* How many pushed memory blocks we keep around for reuse */
+#define GST_HELPER_POOL_SIZE 8
+
+/* The memory pushed into an appsrc comes from a pool of recycled blocks :
+ * gstreamer may release a buffer after the helper is gone, so the pool is
+ * refcounted by the helper and by each block in flight.
+ */
+struct gst_helper_pool
+{
+  PMutex mutex;
+  std::vector<struct gst_helper_block*> blocks;
+  gint refcount;
+};
+
+struct gst_helper_block
+{
+  gst_helper_pool* pool;
+  gchar* data;
+  unsigned capacity;
+};
+
 struct gst_helper
 {
   GstElement* pipeline;
   GstElement* active;
   GstElement* volume;
   GstAdapter* adapter;
+
+  /* used on 16 bit audio when there is no volume element (-1 otherwise) */
+  gfloat soft_volume;
+
+  /* appsink side : the buffers are pulled as soon as they arrive, so the
+   * reader finds them here and never blocks in the appsink */
+  PMutex queue_mutex;
+  std::deque<GstBuffer*> queue;
+  PSyncPoint data_available;
+
+  /* appsrc side */
+  PSyncPoint data_needed;
+  gint need_data;
+  gst_helper_pool* pool;
 };
 
+static void
+gst_helper_pool_unref (gst_helper_pool* pool)
+{
+  if (g_atomic_int_dec_and_test (&pool->refcount)) {
+
+    for (std::vector<gst_helper_block*>::iterator iter = pool->blocks.begin ();
+	 iter != pool->blocks.end ();
+	 ++iter) {
+
+      g_free ((*iter)->data);
+      delete *iter;
+    }
+    delete pool;
+  }
+}
+
+static gst_helper_block*
+gst_helper_pool_acquire (gst_helper_pool* pool,
+			 unsigned size)
+{
+  gst_helper_block* block = NULL;
+
+  {
+    PWaitAndSignal m(pool->mutex);
+    if ( !pool->blocks.empty ()) {
+
+      block = pool->blocks.back ();
+      pool->blocks.pop_back ();
+    }
+  }
+
+  if (block == NULL) {
+
+    block = new gst_helper_block;
+    block->pool = pool;
+    block->data = NULL;
+    block->capacity = 0;
+  }
+
+  if (block->capacity < size) {
+
+    g_free (block->data);
+    block->data = (gchar*)g_malloc (size);
+    block->capacity = size;
+  }
+
+  g_atomic_int_inc (&pool->refcount);
+
+  return block;
+}
+
+static void
+gst_helper_pool_release (gst_helper_block* block)
+{
+  gst_helper_pool* pool = block->pool;
+
+  {
+    PWaitAndSignal m(pool->mutex);
+    if (pool->blocks.size () < GST_HELPER_POOL_SIZE) {
+
+      pool->blocks.push_back (block);
+      block = NULL;
+    }
+  }
+
+  if (block) {
+
+    g_free (block->data);
+    delete block;
+  }
+
+  gst_helper_pool_unref (pool);
+}
+
+static GstFlowReturn
+on_new_buffer (GstAppSink* sink,
+	       gpointer data)
+{
+  gst_helper* self = (gst_helper*)data;
+  GstBuffer* buffer = NULL;
+
+  /* called from the streaming thread when a buffer is there : this
+   * doesn't block */
+  buffer = gst_app_sink_pull_buffer (sink);
+  if (buffer == NULL)
+    return GST_FLOW_OK;
+
+  {
+    PWaitAndSignal m(self->queue_mutex);
+    self->queue.push_back (buffer);
+    if (self->queue.size () > GST_HELPER_MAX_QUEUED) {
+
+      gst_buffer_unref (self->queue.front ());
+      self->queue.pop_front ();
+    }
+  }
+  self->data_available.Signal ();
+
+  return GST_FLOW_OK;
+}
+
+static void
+on_need_data (G_GNUC_UNUSED GstAppSrc* src,
+	      G_GNUC_UNUSED guint length,
+	      gpointer data)
+{
+  gst_helper* self = (gst_helper*)data;
+
+  g_atomic_int_set (&self->need_data, 1);
+  self->data_needed.Signal ();
+}
+
+static void
+on_enough_data (G_GNUC_UNUSED GstAppSrc* src,
+		gpointer data)
+{
+  gst_helper* self = (gst_helper*)data;
+
+  g_atomic_int_set (&self->need_data, 0);
+}
+
 static void
 gst_helper_destroy (gst_helper* self)
 {
   gst_element_set_state (self->pipeline, GST_STATE_NULL);
+  while ( !self->queue.empty ()) {
+
+    gst_buffer_unref (self->queue.front ());
+    self->queue.pop_front ();
+  }
   gst_object_unref (self->adapter);
   self->adapter = NULL;
   g_object_unref (self->active);
@@ -63,20 +237,38 @@ gst_helper_destroy (gst_helper* self)
   self->volume = NULL;
   g_object_unref (self->pipeline);
   self->pipeline = NULL;
-  g_free (self);
+  gst_helper_pool_unref (self->pool);
+  self->pool = NULL;
+  delete self;
 }
 
 gst_helper*
 gst_helper_new (const gchar* command)
 {
-  gst_helper* self = g_new0 (gst_helper, 1);
+  gst_helper* self = new gst_helper;
   self->adapter = gst_adapter_new ();
+  self->need_data = 1;
+  self->pool = new gst_helper_pool;
+  self->pool->refcount = 1;
   self->pipeline = gst_parse_launch (command, NULL);
   self->volume = gst_bin_get_by_name (GST_BIN (self->pipeline), "ekiga_volume");
+  self->soft_volume = -1;
   self->active = gst_bin_get_by_name (GST_BIN (self->pipeline), "ekiga_sink");
-  if (self->active == NULL) {
+  if (self->active != NULL) {
+
+    GstAppSinkCallbacks callbacks = { NULL, NULL, on_new_buffer, NULL, { NULL } };
+    gst_app_sink_set_callbacks (GST_APP_SINK (self->active),
+				&callbacks, self, NULL);
+  }
+  else {
 
     self->active = gst_bin_get_by_name (GST_BIN (self->pipeline), "ekiga_src");
+    if (self->active != NULL) {
+
+      GstAppSrcCallbacks callbacks = { on_need_data, on_enough_data, NULL, { NULL } };
+      gst_app_src_set_callbacks (GST_APP_SRC (self->active),
+				 &callbacks, self, NULL);
+    }
   }
   (void)gst_element_set_state (self->pipeline, GST_STATE_PLAYING);
 
@@ -97,14 +289,35 @@ gst_helper_get_frame_data (gst_helper* self,
 {
   GstBuffer* buffer = NULL;
 
-  buffer = gst_app_sink_pull_buffer (GST_APP_SINK (self->active));
-  if (buffer != NULL)
-    gst_adapter_push (self->adapter, buffer);
+  /* we only wait when nothing is queued, so we never block more than
+   * GST_HELPER_TIMEOUT on a stalled pipeline
+   */
+  while (gst_adapter_available (self->adapter) < size) {
+
+    {
+      PWaitAndSignal m(self->queue_mutex);
+      if ( !self->queue.empty ()) {
+
+	buffer = self->queue.front ();
+	self->queue.pop_front ();
+      }
+      else
+	buffer = NULL;
+    }
+
+    if (buffer != NULL)
+      gst_adapter_push (self->adapter, buffer);
+    else if ( !self->data_available.Wait (GST_HELPER_TIMEOUT))
+      break;
+  }
 
   read = MIN(size, gst_adapter_available (self->adapter));
   gst_adapter_copy (self->adapter, (guint8*)data, 0, read);
   gst_adapter_flush (self->adapter, read);
-  g_usleep (20 * G_TIME_SPAN_MILLISECOND);
+
+  if (self->soft_volume >= 0)
+    Ekiga::AudioDSP::apply_volume ((gint16*)data, read >> 1,
+				   (unsigned)(255 * self->soft_volume));
 
   return true;
 }
@@ -114,25 +327,46 @@ gst_helper_set_frame_data (gst_helper* self,
 			   const char* data,
 			   unsigned size)
 {
-  gchar* tmp = NULL;
+  gst_helper_block* block = NULL;
   GstBuffer* buffer = NULL;
 
   if (self->active) {
 
-    tmp = (gchar*)g_malloc0 (size);
-    memcpy (tmp, data, size);
-    buffer = gst_app_buffer_new (tmp, size,
-				 (GstAppBufferFinalizeFunc)g_free, tmp);
+    /* the appsrc paces us : wait until it wants data again */
+    if ( !g_atomic_int_get (&self->need_data)
+	 && !self->data_needed.Wait (GST_HELPER_TIMEOUT)
+	 && !g_atomic_int_get (&self->need_data)) {
+
+      PTRACE(4, "GStreamer\tPipeline is stalled, dropping " << size << " bytes");
+      return;
+    }
+
+    block = gst_helper_pool_acquire (self->pool, size);
+    memcpy (block->data, data, size);
+    if (self->soft_volume >= 0)
+      Ekiga::AudioDSP::apply_volume ((gint16*)block->data, size >> 1,
+				     (unsigned)(255 * self->soft_volume));
+    buffer = gst_app_buffer_new (block->data, size,
+				 (GstAppBufferFinalizeFunc)gst_helper_pool_release,
+				 block);
     gst_app_src_push_buffer (GST_APP_SRC (self->active), buffer);
-    g_usleep (20 * G_TIME_SPAN_MILLISECOND);
   }
 }
 
+void
+gst_helper_enable_software_volume (gst_helper* self)
+{
+  if (self->volume == NULL && self->soft_volume < 0)
+    self->soft_volume = 1;
+}
+
 void
 gst_helper_set_volume (gst_helper* self,
 		       gfloat valf)
 {
-  if (self->volume)
+  if (self->soft_volume >= 0)
+    self->soft_volume = CLAMP (valf, 0, 1);
+  else if (self->volume)
     g_object_set (G_OBJECT (self->volume),
 		  "volume", valf,
 		  NULL);
@@ -141,7 +375,7 @@ gst_helper_set_volume (gst_helper* self,
 gfloat
 gst_helper_get_volume (gst_helper* self)
 {
-  gfloat result = -1;
+  gfloat result = self->soft_volume;
   if (self->volume)
     g_object_get (G_OBJECT (self->volume),
 		  "volume", &result,
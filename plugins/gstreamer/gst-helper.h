@@ -44,7 +44,12 @@
  * - it should be possible to ask this helper to just kill itself ;
  * - it should be possible to either put data into it, or get data from it ;
  * - the optional volume should be modifyable (-1 means the option is disabled) ;
+ *   on 16 bit audio, a software volume can replace a missing volume element ;
  * - it should be possible to set the buffer size.
+ *
+ * Getting and putting data is paced by the pipeline itself (the appsink
+ * telling a buffer is available, the appsrc telling it needs data), with
+ * a bounded wait, so that no fixed delay is added on top of the stream.
  */
 
 
@@ -65,6 +70,8 @@ void gst_helper_set_frame_data (gst_helper* self,
 				const char* data,
 				unsigned size);
 
+void gst_helper_enable_software_volume (gst_helper* self);
+
 void gst_helper_set_volume (gst_helper* self,
 			    gfloat valf);
 
@@ -52,6 +52,29 @@
 
 #define EKIGA_NET_URI "ldap://ekiga.net"
 
+/* how many entries the server sends at once (if it knows about paged
+ * results), and how long we accept to wait for it (in seconds)
+ */
+#define LDAP_PAGE_SIZE 100
+#define LDAP_TIMEOUT 30
+
+/* the connection is watched from the main loop, so the requests don't
+ * block the user interface
+ */
+static gboolean
+on_ldap_readable (G_GNUC_UNUSED GIOChannel* channel,
+		  G_GNUC_UNUSED GIOCondition condition,
+		  gpointer data)
+{
+  return ((OPENLDAP::Book*)data)->refresh_result ();
+}
+
+static gboolean
+on_ldap_timeout (gpointer data)
+{
+  return ((OPENLDAP::Book*)data)->refresh_timeout ();
+}
+
 /* little helper function... can probably be made more complete */
 static const std::string
 fix_to_utf8 (const std::string str)
@@ -73,6 +96,79 @@ fix_to_utf8 (const std::string str)
   return result;
 }
 
+/* A complete search for "ab" has all the results for "xaby", which can
+ * then be found without the server, if we match as it would : this gives
+ * the (lowercase) attributes the filter template searches the term in,
+ * or nothing if that can't be done locally. That is when :
+ * - the template asserts the term on attributes the contacts don't hold,
+ * as only the name and call attributes are asked for ;
+ * - the server uses other matching rules than a case-insensitive
+ * substring match, as for telephone numbers, which ignore spaces and
+ * dashes, and for approximate, ordering and extensible matches ;
+ * - the assertions are negated or combined with an and, which a match
+ * on any of them doesn't mimic.
+ * The assertions without the term are the same for both searches.
+ */
+static std::list<std::string>
+narrowing_attributes (const char* filter_template,
+		      char** attributes)
+{
+  std::list<std::string> result;
+  std::string filter;
+  std::string::size_type start = 0;
+  bool combined = false;
+
+  if (filter_template == NULL || attributes == NULL || attributes[0] == NULL)
+    return result;
+
+  filter = filter_template;
+  if (filter.find ('!') != std::string::npos)
+    return result;
+  combined = (filter.find ('&') != std::string::npos);
+
+  while ((start = filter.find ('(', start)) != std::string::npos) {
+
+    std::string::size_type equal = 0;
+    std::string::size_type end = 0;
+    std::string attribute;
+    bool held = false;
+
+    start++;
+    if (start < filter.length () && (filter[start] == '|' || filter[start] == '&'))
+      continue;
+
+    equal = filter.find ('=', start);
+    end = filter.find (')', start);
+    if (equal == std::string::npos || end == std::string::npos || end < equal)
+      return std::list<std::string> ();
+
+    if (filter.find ('$', equal) > end)
+      continue; // the same for all searches
+
+    attribute = filter.substr (start, equal - start);
+    if (attribute.empty ()
+	|| attribute.find_first_of ("~<>:") != std::string::npos
+	|| (combined && !result.empty ()))
+      return std::list<std::string> ();
+
+    gchar* lower = g_ascii_strdown (attribute.c_str (), -1);
+    attribute = lower;
+    g_free (lower);
+    if (attribute.find ("phone") != std::string::npos
+	|| attribute == "mobile" || attribute == "pager")
+      return std::list<std::string> ();
+
+    for (int i = 0; !held && attributes[i]; i++)
+      held = !g_ascii_strcasecmp (attributes[i], attribute.c_str ());
+    if ( !held)
+      return std::list<std::string> ();
+
+    result.push_back (attribute);
+  }
+
+  return result;
+}
+
 /* parses a message to construct a nice contact */
 OPENLDAP::ContactPtr
 OPENLDAP::Book::parse_result (LDAPMessage* message)
@@ -82,6 +178,7 @@ OPENLDAP::Book::parse_result (LDAPMessage* message)
   struct berval bv, *bvals;
   std::string username;
   std::map<std::string, std::string> call_addresses;
+  std::map<std::string, std::string> values;
   char **attributes = bookinfo.urld->lud_attrs;
   int i, rc;
 
@@ -91,6 +188,15 @@ OPENLDAP::Book::parse_result (LDAPMessage* message)
   while (rc == LDAP_SUCCESS) {
     rc = ldap_get_attribute_ber (ldap_context, message, ber, &bv, &bvals);
     if (bv.bv_val == NULL) break;
+    if (bvals) {
+
+      /* all the values, as the server matches any of them */
+      gchar* attribute = g_ascii_strdown (bv.bv_val, -1);
+      std::string& value = values[attribute];
+      for (i = 0; bvals[i].bv_val != NULL; i++)
+	value += fix_to_utf8 (std::string (bvals[i].bv_val, bvals[i].bv_len)) + "\n";
+      g_free (attribute);
+    }
     if (attributes[0] == NULL || !g_ascii_strcasecmp(bv.bv_val, attributes[0])) {
       username = std::string (bvals[0].bv_val, bvals[0].bv_len);
     } else {
@@ -114,7 +220,7 @@ OPENLDAP::Book::parse_result (LDAPMessage* message)
 
   if (!username.empty () && !call_addresses.empty()) {
 
-    result = ContactPtr(new Contact (core, fix_to_utf8 (username), call_addresses));
+    result = ContactPtr(new Contact (core, fix_to_utf8 (username), call_addresses, values));
   }
 
   return result;
@@ -174,11 +280,15 @@ OPENLDAP::Book::Book (Ekiga::ServiceCore &_core,
 		      xmlNodePtr _node):
   saslform(NULL), core(_core), doc(_doc), node(_node),
   name_node(NULL), uri_node(NULL), authcID_node(NULL), password_node(NULL),
-  ldap_context(NULL), patience(0)
+  cache_ttl_node(NULL), cache_size_node(NULL), ldap_context(NULL), connecting(NULL), bound(false), msgid(-1), io_watch(0), timeout_watch(0),
+  found(0)
 {
   xmlChar *xml_str;
   bool upgrade_config = false;
 
+  page_cookie.bv_len = 0;
+  page_cookie.bv_val = NULL;
+
   /* for previous config */
   std::string hostname="", port="", base="", scope="", call_attribute="";
   xmlNodePtr hostname_node = NULL, port_node = NULL, base_node = NULL,
@@ -191,6 +301,8 @@ OPENLDAP::Book::Book (Ekiga::ServiceCore &_core,
   bookinfo.saslMech = "";
   bookinfo.sasl = false;
   bookinfo.starttls = false;
+  bookinfo.cache_ttl = LDAP_CACHE_TTL;
+  bookinfo.cache_size = LDAP_CACHE_SIZE;
 
   for (xmlNodePtr child = node->children ;
        child != NULL;
@@ -283,6 +395,24 @@ OPENLDAP::Book::Book (Ekiga::ServiceCore &_core,
 	xmlFree (xml_str);
 	continue;
       }
+
+      if (xmlStrEqual (BAD_CAST ("cache_ttl"), child->name)) {
+
+	xml_str = xmlNodeGetContent (child);
+	bookinfo.cache_ttl = strtoul ((const char *)xml_str, NULL, 10);
+	cache_ttl_node = child;
+	xmlFree (xml_str);
+	continue;
+      }
+
+      if (xmlStrEqual (BAD_CAST ("cache_size"), child->name)) {
+
+	xml_str = xmlNodeGetContent (child);
+	bookinfo.cache_size = strtoul ((const char *)xml_str, NULL, 10);
+	cache_size_node = child;
+	xmlFree (xml_str);
+	continue;
+      }
     }
   }
   if (upgrade_config) {
@@ -346,8 +476,12 @@ OPENLDAP::Book::Book (Ekiga::ServiceCore &_core,
 		      OPENLDAP::BookInfo _bookinfo):
   saslform(NULL), core(_core), doc(_doc), name_node(NULL),
   uri_node(NULL), authcID_node(NULL), password_node(NULL),
-  ldap_context(NULL), patience(0)
+  cache_ttl_node(NULL), cache_size_node(NULL), ldap_context(NULL), connecting(NULL), bound(false), msgid(-1), io_watch(0), timeout_watch(0),
+  found(0)
 {
+  page_cookie.bv_len = 0;
+  page_cookie.bv_val = NULL;
+
   node = xmlNewNode (NULL, BAD_CAST "server");
 
   bookinfo = _bookinfo;
@@ -371,6 +505,20 @@ OPENLDAP::Book::Book (Ekiga::ServiceCore &_core,
 			       BAD_CAST "password",
 			       BAD_CAST robust_xmlEscape (node->doc,
 							  bookinfo.password).c_str ());
+
+  {
+    std::stringstream ttl;
+    std::stringstream size;
+
+    ttl << bookinfo.cache_ttl;
+    size << bookinfo.cache_size;
+    cache_ttl_node = xmlNewChild (node, NULL,
+				  BAD_CAST "cache_ttl",
+				  BAD_CAST ttl.str ().c_str ());
+    cache_size_node = xmlNewChild (node, NULL,
+				   BAD_CAST "cache_size",
+				   BAD_CAST size.str ().c_str ());
+  }
   OPENLDAP::BookInfoParse (bookinfo);
   if (bookinfo.uri_host == EKIGA_NET_URI)
     I_am_an_ekiga_net_book = true;
@@ -380,6 +528,7 @@ OPENLDAP::Book::Book (Ekiga::ServiceCore &_core,
 
 OPENLDAP::Book::~Book ()
 {
+  refresh_end ();
 }
 
 bool
@@ -439,7 +588,10 @@ void
 OPENLDAP::Book::set_search_filter (const std::string _search_filter)
 {
   search_filter = _search_filter;
-  refresh ();
+
+  /* the user is typing : don't go to the server if we already know */
+  if ( !search_in_cache ())
+    refresh ();
 }
 
 const std::string
@@ -461,8 +613,20 @@ OPENLDAP::Book::refresh ()
   /* we flush */
   remove_all_objects ();
 
-  if (ldap_context == NULL)
+  if (ldap_context == NULL && connecting == NULL)
     refresh_start ();
+  else if (bound) {
+
+    /* the results of the previous search are now useless */
+    if (msgid != -1)
+      ldap_abandon_ext (ldap_context, msgid, NULL, NULL);
+    ber_memfree (page_cookie.bv_val);
+    page_cookie.bv_val = NULL;
+    page_cookie.bv_len = 0;
+    refresh_search ();
+  }
+  /* else we're still connecting or binding, and the search will use the
+   * new filter */
 }
 
 void
@@ -670,74 +834,148 @@ extern "C" {
 
 } /* extern "C" */
 
+/* Connecting, with the TLS handshake, and sending the simple bind can take
+ * as long as the network wants : that is done in a thread, which hands the
+ * context back to the main loop. If the book stops waiting for it in the
+ * meantime (refresh_end), the connection is dropped when it comes back.
+ */
+struct OPENLDAP::Book::Connection
+{
+  OPENLDAP::Book* book; // only used in the main thread
+  std::string uri;
+  bool starttls;
+  bool simple_bind;
+  std::string authcID;
+  std::string password;
+
+  struct ldap* context;
+  bool initialized;
+  int result;
+  int msgid;
+};
+
+static void
+on_ldap_connected (OPENLDAP::Book::Connection* connection)
+{
+  if (connection->book != NULL)
+    connection->book->refresh_connected (connection);
+  else if (connection->context != NULL)
+    ldap_unbind_ext (connection->context, NULL, NULL);
+
+  delete connection;
+}
+
+static gpointer
+ldap_connect_thread (gpointer data)
+{
+  OPENLDAP::Book::Connection* connection = (OPENLDAP::Book::Connection*)data;
+  int ldap_version = LDAP_VERSION3;
+
+  connection->result = ldap_initialize (&connection->context,
+					connection->uri.c_str ());
+  connection->initialized = (connection->result == LDAP_SUCCESS);
+
+  if (connection->initialized) {
+
+    /* the openldap code shows I don't have to check the result of this
+     * (see for example tests/prog/slapd-search.c)
+     */
+    (void)ldap_set_option (connection->context,
+			   LDAP_OPT_PROTOCOL_VERSION, &ldap_version);
+
+    if (connection->starttls)
+      connection->result = ldap_start_tls_s (connection->context, NULL, NULL);
+  }
+
+  if (connection->initialized && connection->result == LDAP_SUCCESS
+      && connection->simple_bind) {
+
+    struct berval passwd = { 0, NULL };
+
+    /* only sent : the answer will come through the main loop */
+    if ( !connection->password.empty ()) {
+
+      passwd.bv_val = g_strdup (connection->password.c_str ());
+      passwd.bv_len = connection->password.length ();
+    }
+    connection->result = ldap_sasl_bind (connection->context,
+					 connection->password.empty () ? NULL : connection->authcID.c_str (),
+					 LDAP_SASL_SIMPLE, &passwd,
+					 NULL, NULL,
+					 &connection->msgid);
+    g_free (passwd.bv_val);
+  }
+
+  Ekiga::Runtime::run_in_main (boost::bind (&on_ldap_connected, connection));
+
+  return NULL;
+}
+
 void
 OPENLDAP::Book::refresh_start ()
 {
-  int msgid = -1;
-  int result = LDAP_SUCCESS;
-  int ldap_version = LDAP_VERSION3;
+  Connection* connection = new Connection;
+  GThread* thread = NULL;
 
   status = std::string (_("Refreshing"));
   updated ();
 
-  result = ldap_initialize (&ldap_context, bookinfo.uri_host.c_str());
-  if (result != LDAP_SUCCESS) {
+  connection->book = this;
+  connection->uri = bookinfo.uri_host;
+  connection->starttls = bookinfo.starttls;
+  connection->simple_bind = !bookinfo.sasl;
+  connection->authcID = bookinfo.authcID;
+  connection->password = bookinfo.password;
+  connection->context = NULL;
+  connection->initialized = false;
+  connection->result = LDAP_SUCCESS;
+  connection->msgid = -1;
+  connecting = connection;
+
+  /* a server which doesn't answer shouldn't keep us waiting */
+  timeout_watch = g_timeout_add_seconds (LDAP_TIMEOUT, on_ldap_timeout, this);
+
+#if GLIB_CHECK_VERSION(2,32,0)
+  thread = g_thread_new ("ldap-connect", ldap_connect_thread, connection);
+  g_thread_unref (thread);
+#else
+  thread = g_thread_create (ldap_connect_thread, connection, FALSE, NULL);
+  if (thread == NULL)
+    ldap_connect_thread (connection);
+#endif
+}
 
+void
+OPENLDAP::Book::refresh_connected (Connection* connection)
+{
+  int result = connection->result;
+
+  connecting = NULL;
+  if (timeout_watch != 0)
+    g_source_remove (timeout_watch);
+  timeout_watch = 0;
+
+  ldap_context = connection->context;
+  msgid = connection->msgid;
+
+  if ( !connection->initialized) {
+
+    ldap_context = NULL;
     status = std::string (_("Could not initialize server"));
     updated ();
     return;
   }
 
-  /* the openldap code shows I don't have to check the result of this
-   * (see for example tests/prog/slapd-search.c)
-   */
-  (void)ldap_set_option (ldap_context,
-			 LDAP_OPT_PROTOCOL_VERSION, &ldap_version);
-
-  if (bookinfo.starttls) {
-    result = ldap_start_tls_s (ldap_context, NULL, NULL);
-    if (result != LDAP_SUCCESS) {
-      status = std::string (_("LDAP Error: ")) +
-        std::string (ldap_err2string (result));
-      updated ();
-      ldap_unbind_ext (ldap_context, NULL, NULL);
-      ldap_context = NULL;
-      return;
-    }
-  }
-
-  if (bookinfo.sasl) {
+  if (result == LDAP_SUCCESS && bookinfo.sasl) {
     interctx ctx;
 
     ctx.book = this;
     ctx.authcID = bookinfo.authcID;
     ctx.password = bookinfo.password;
+    /* this one has to be synchronous, since it may need to ask the user */
     result = ldap_sasl_interactive_bind_s (ldap_context, NULL,
 					   bookinfo.saslMech.c_str(), NULL, NULL, LDAP_SASL_QUIET,
 					   book_saslinter, &ctx);
-
-  } else {
-    /* Simple Bind */
-    if (bookinfo.password.empty ()) {
-      struct berval bv={0,NULL};
-
-      result = ldap_sasl_bind (ldap_context, NULL,
-			       LDAP_SASL_SIMPLE, &bv,
-			       NULL, NULL,
-			       &msgid);
-    } else {
-
-      struct berval passwd = { 0, NULL };
-      passwd.bv_val = g_strdup (bookinfo.password.c_str ());
-      passwd.bv_len = bookinfo.password.length();
-
-      result = ldap_sasl_bind (ldap_context, bookinfo.authcID.c_str(),
-			       LDAP_SASL_SIMPLE, &passwd,
-			       NULL, NULL,
-			       &msgid);
-
-      g_free (passwd.bv_val);
-    }
   }
 
   if (result != LDAP_SUCCESS) {
@@ -748,63 +986,64 @@ OPENLDAP::Book::refresh_start ()
 
     ldap_unbind_ext (ldap_context, NULL, NULL);
     ldap_context = NULL;
+    msgid = -1;
     return;
   }
 
   status = std::string (_("Contacted server"));
   updated ();
 
-  patience = 3;
-  refresh_bound ();
-}
-
-void
-OPENLDAP::Book::refresh_bound ()
-{
-  int result = LDAP_SUCCESS;
-  struct timeval timeout = { 1, 0}; /* block 1s */
-  LDAPMessage *msg_entry = NULL;
-  int msgid;
-  std::string filter, fterm;
-  const char *fstr;
-  size_t pos;
-
-  if (bookinfo.sasl)
-    goto sasl_bound;
+  if ( !refresh_watch ())
+    return;
 
-  result = ldap_result (ldap_context, LDAP_RES_ANY, LDAP_MSG_ALL,
-			&timeout, &msg_entry);
+  if (bookinfo.sasl) {
 
-  if (result <= 0) {
+    bound = true;
+    refresh_search ();
+  }
+  /* else we'll search when the answer to the bind comes */
+}
 
-    if (patience == 3) {
-      patience--;
-      Ekiga::Runtime::run_in_main (boost::bind (&OPENLDAP::Book::refresh_bound, this), 12);
-    } else if (patience == 2) {
+bool
+OPENLDAP::Book::refresh_watch ()
+{
+  int fd = -1;
+  GIOChannel* channel = NULL;
 
-      patience--;
-      Ekiga::Runtime::run_in_main (boost::bind (&OPENLDAP::Book::refresh_bound, this), 21);
-    } else if (patience == 1) {
+  if (ldap_get_option (ldap_context, LDAP_OPT_DESC, &fd) != LDAP_OPT_SUCCESS
+      || fd < 0) {
 
-      patience--;
-      Ekiga::Runtime::run_in_main (boost::bind (&OPENLDAP::Book::refresh_bound, this), 30);
-    } else { // patience == 0
+    status = std::string (_("Could not connect to server"));
+    updated ();
+    refresh_end ();
+    return false;
+  }
 
-      status = std::string (_("Could not connect to server"));
-      updated ();
+#ifdef G_OS_WIN32
+  channel = g_io_channel_win32_new_socket (fd);
+#else
+  channel = g_io_channel_unix_new (fd);
+#endif
+  io_watch = g_io_add_watch (channel,
+			     (GIOCondition)(G_IO_IN | G_IO_HUP | G_IO_ERR),
+			     on_ldap_readable, this);
+  g_io_channel_unref (channel);
 
-      ldap_unbind_ext (ldap_context, NULL, NULL);
-      ldap_context = NULL;
-    }
+  timeout_watch = g_timeout_add_seconds (LDAP_TIMEOUT, on_ldap_timeout, this);
 
-    if (msg_entry != NULL)
-      ldap_msgfree (msg_entry);
+  return true;
+}
 
-    return;
-  }
-  (void) ldap_msgfree (msg_entry);
+void
+OPENLDAP::Book::refresh_search ()
+{
+  int result = LDAP_SUCCESS;
+  LDAPControl* page_control = NULL;
+  LDAPControl* controls[2] = { NULL, NULL };
+  std::string filter, fterm;
+  const char *fstr;
+  size_t pos;
 
- sasl_bound:
   if (!search_filter.empty ()) {
     if (search_filter[0] == '(' &&
         search_filter[search_filter.length()-1] == ')') {
@@ -827,92 +1066,199 @@ OPENLDAP::Book::refresh_bound ()
   fstr = filter.c_str();
 
  do_search:
-  msgid = ldap_search_ext (ldap_context,
-			   bookinfo.urld->lud_dn,
-			   bookinfo.urld->lud_scope,
-			   fstr,
-			   bookinfo.urld->lud_attrs,
-			   0, /* attrsonly */
-			   NULL, NULL,
-			   NULL, 0, &msgid);
+  /* ask for the results in pages (RFC 2696) : they will come in as they
+   * are found, and not all at once after the whole directory was searched
+   * -- servers which don't know about it will just ignore this
+   */
+  if (ldap_create_page_control (ldap_context, LDAP_PAGE_SIZE,
+				page_cookie.bv_val != NULL ? &page_cookie : NULL,
+				0, &page_control) == LDAP_SUCCESS)
+    controls[0] = page_control;
+
+  result = ldap_search_ext (ldap_context,
+			    bookinfo.urld->lud_dn,
+			    bookinfo.urld->lud_scope,
+			    fstr,
+			    bookinfo.urld->lud_attrs,
+			    0, /* attrsonly */
+			    controls, NULL,
+			    NULL, 0, &msgid);
+
+  if (page_control != NULL)
+    ldap_control_free (page_control);
 
-  if (msgid == -1) {
+  if (result != LDAP_SUCCESS) {
 
     status = std::string (_("Could not search"));
     updated ();
 
-    ldap_unbind_ext (ldap_context, NULL, NULL);
-    ldap_context = NULL;
+    refresh_end ();
     return;
-  } else {
+  }
+
+  if (page_cookie.bv_val == NULL) {
 
+    found = 0;
+    searched_filter = search_filter;
+    search_results.clear ();
     status = std::string (_("Waiting for search results"));
     updated ();
   }
-
-  patience = 3;
-  refresh_result ();
 }
 
-void
+bool
 OPENLDAP::Book::refresh_result ()
 {
-  int result = LDAP_SUCCESS;
-  int nbr = 0;
-  struct timeval timeout = { 1, 0}; /* block 1s */
+  int result = 0;
+  int code = LDAP_SUCCESS;
+  struct timeval poll = { 0, 0}; /* don't block */
   LDAPMessage *msg_entry = NULL;
-  LDAPMessage *msg_result = NULL;
-  gchar* c_status = NULL;
+  LDAPControl** controls = NULL;
+  LDAPControl* page_control = NULL;
+
+  /* the server is alive */
+  if (timeout_watch != 0)
+    g_source_remove (timeout_watch);
+  timeout_watch = g_timeout_add_seconds (LDAP_TIMEOUT, on_ldap_timeout, this);
+
+  while ((result = ldap_result (ldap_context, msgid, LDAP_MSG_ONE,
+				&poll, &msg_entry)) > 0) {
+
+    switch (result) {
+
+    case LDAP_RES_BIND:
+
+      if (ldap_parse_result (ldap_context, msg_entry, &code,
+			     NULL, NULL, NULL, NULL, 1) != LDAP_SUCCESS)
+	code = LDAP_OTHER;
+      msg_entry = NULL;
+
+      if (code != LDAP_SUCCESS) {
+
+	status = std::string (_("LDAP Error: ")) +
+	  std::string (ldap_err2string (code));
+	updated ();
+
+	refresh_end ();
+	return false;
+      }
 
-  result = ldap_result (ldap_context, LDAP_RES_ANY, LDAP_MSG_ALL,
-			&timeout, &msg_entry);
+      bound = true;
+      refresh_search ();
+      if (ldap_context == NULL)
+	return false;
+      break;
 
+    case LDAP_RES_SEARCH_ENTRY: {
 
-  if (result <= 0) {
+      ContactPtr contact = parse_result (msg_entry);
+      if (contact) {
+
+	add_contact (contact);
+	search_results.push_back (contact);
+	found++;
+      }
+      break;
+    }
+
+    case LDAP_RES_SEARCH_RESULT:
+
+      if (ldap_parse_result (ldap_context, msg_entry, &code,
+			     NULL, NULL, NULL, &controls, 1) != LDAP_SUCCESS)
+	code = LDAP_OTHER;
+      msg_entry = NULL;
+
+      ber_memfree (page_cookie.bv_val);
+      page_cookie.bv_val = NULL;
+      page_cookie.bv_len = 0;
+      if (controls != NULL) {
 
-    if (patience == 3) {
+	page_control = ldap_control_find (LDAP_CONTROL_PAGEDRESULTS,
+					  controls, NULL);
+	if (page_control == NULL
+	    || ldap_parse_pageresponse_control (ldap_context, page_control,
+						NULL, &page_cookie) != LDAP_SUCCESS) {
+
+	  page_cookie.bv_val = NULL;
+	  page_cookie.bv_len = 0;
+	}
+	ldap_controls_free (controls);
+	controls = NULL;
+      }
+
+      if (code != LDAP_SUCCESS && found == 0) {
+
+	status = std::string (_("Could not search"));
+	updated ();
+
+	refresh_end ();
+	return false;
+      }
 
-      patience--;
-      Ekiga::Runtime::run_in_main (boost::bind (&OPENLDAP::Book::refresh_result, this),
-				   12);
-    } else if (patience == 2) {
+      refresh_status ();
 
-      patience--;
-      Ekiga::Runtime::run_in_main (boost::bind (&OPENLDAP::Book::refresh_result, this),
-				   21);
-    } else if (patience == 1) {
+      /* an empty cookie means that was the last page */
+      if (code == LDAP_SUCCESS && page_cookie.bv_len > 0) {
 
-      patience--;
-      Ekiga::Runtime::run_in_main (boost::bind (&OPENLDAP::Book::refresh_result, this),
-				   30);
-    } else { // patience == 0
+	refresh_search ();
+	if (ldap_context == NULL)
+	  return false;
+      } else {
 
-      status = std::string (_("Could not search"));
-      updated ();
+	/* if the server stopped early (size limit...), that can't be
+	 * narrowed down later */
+	CachedSearch search;
+	search.filter = searched_filter;
+	search.contacts = search_results;
+	search.time = g_get_monotonic_time ();
+	search.complete = (code == LDAP_SUCCESS);
+	add_to_cache (search);
+	search_results.clear ();
 
-      ldap_unbind_ext (ldap_context, NULL, NULL);
-      ldap_context = NULL;
+	refresh_end ();
+	return false;
+      }
+      break;
+
+    default:
+      break;
     }
 
     if (msg_entry != NULL)
       ldap_msgfree (msg_entry);
+    msg_entry = NULL;
+  }
 
-    return;
+  if (result < 0) {
+
+    status = std::string (bound ? _("Could not search") : _("Could not connect to server"));
+    updated ();
+
+    refresh_end ();
+    return false;
   }
 
-  msg_result = ldap_first_message (ldap_context, msg_entry);
-  do {
+  return true;
+}
 
-    if (ldap_msgtype (msg_result) == LDAP_RES_SEARCH_ENTRY) {
+bool
+OPENLDAP::Book::refresh_timeout ()
+{
+  timeout_watch = 0;
 
-      ContactPtr contact = parse_result (msg_result);
-      if (contact) {
-	add_contact (contact);
-        nbr++;
-      }
-    }
-    msg_result = ldap_next_message (ldap_context, msg_result);
-  } while (msg_result != NULL);
+  status = std::string (bound ? _("Could not search") : _("Could not connect to server"));
+  updated ();
+
+  refresh_end ();
+
+  return false;
+}
+
+void
+OPENLDAP::Book::refresh_status ()
+{
+  int nbr = found;
+  gchar* c_status = NULL;
 
   // Do not count ekiga.net's first entry "Search Results ... 100 entries"
   if (bookinfo.uri_host == EKIGA_NET_URI)
@@ -923,11 +1269,140 @@ OPENLDAP::Book::refresh_result ()
   g_free (c_status);
 
   updated ();
+}
+
+bool
+OPENLDAP::Book::search_in_cache ()
+{
+  gint64 now = g_get_monotonic_time ();
+  gchar* folded = NULL;
+  std::string folded_filter;
+  std::list<CachedSearch>::iterator best = cache.end ();
+  std::list<std::string> attributes;
+  CachedSearch search;
+
+  /* forget what is too old */
+  for (std::list<CachedSearch>::iterator iter = cache.begin ();
+       iter != cache.end ();
+       )
+    if (now - iter->time > (gint64)bookinfo.cache_ttl * G_USEC_PER_SEC)
+      iter = cache.erase (iter);
+    else
+      ++iter;
+
+  folded = g_utf8_casefold (search_filter.c_str (), -1);
+  folded_filter = folded;
+  g_free (folded);
+
+  for (std::list<CachedSearch>::iterator iter = cache.begin ();
+       iter != cache.end () && best == cache.end ();
+       ++iter) {
+
+    if (iter->filter == search_filter)
+      best = iter;
+  }
+
+  /* a complete search for "ab" has all the results for "xaby" -- that
+   * doesn't work with raw ldap filters, nor with filter templates we
+   * can't match as the server does, and ekiga.net never gives all its
+   * entries
+   */
+  if (best == cache.end ()
+      && !I_am_an_ekiga_net_book
+      && !(!search_filter.empty () && search_filter[0] == '('))
+    attributes = narrowing_attributes (bookinfo.urld->lud_filter,
+				       bookinfo.urld->lud_attrs);
+
+  if ( !attributes.empty ()) {
+
+    for (std::list<CachedSearch>::iterator iter = cache.begin ();
+	 iter != cache.end () && best == cache.end ();
+	 ++iter) {
+
+      if ( !iter->complete
+	  || (!iter->filter.empty () && iter->filter[0] == '('))
+	continue;
+
+      folded = g_utf8_casefold (iter->filter.c_str (), -1);
+      if (folded_filter.find (folded) != std::string::npos)
+	best = iter;
+      g_free (folded);
+    }
+  }
+
+  if (best == cache.end ())
+    return false;
+
+  search.filter = search_filter;
+  search.time = best->time;
+  search.complete = best->complete;
+  if (best->filter == search_filter)
+    search.contacts = best->contacts;
+  else
+    for (std::list<ContactPtr>::const_iterator iter = best->contacts.begin ();
+	 iter != best->contacts.end ();
+	 ++iter)
+      if ((*iter)->matches (attributes, folded_filter))
+	search.contacts.push_back (*iter);
+
+  /* what the server may still be sending is for an older filter */
+  refresh_end ();
+  remove_all_objects ();
+
+  for (std::list<ContactPtr>::const_iterator iter = search.contacts.begin ();
+       iter != search.contacts.end ();
+       ++iter)
+    add_contact (*iter);
+  found = search.contacts.size ();
+  refresh_status ();
+
+  add_to_cache (search);
 
-  (void)ldap_msgfree (msg_entry);
+  return true;
+}
 
-  ldap_unbind_ext (ldap_context, NULL, NULL);
+void
+OPENLDAP::Book::add_to_cache (const CachedSearch& search)
+{
+  for (std::list<CachedSearch>::iterator iter = cache.begin ();
+       iter != cache.end ();
+       ++iter)
+    if (iter->filter == search.filter) {
+
+      cache.erase (iter);
+      break;
+    }
+
+  cache.push_front (search);
+  while (cache.size () > bookinfo.cache_size)
+    cache.pop_back ();
+}
+
+void
+OPENLDAP::Book::refresh_end ()
+{
+  /* the thread will drop what it connected */
+  if (connecting != NULL)
+    connecting->book = NULL;
+  connecting = NULL;
+
+  if (io_watch != 0)
+    g_source_remove (io_watch);
+  io_watch = 0;
+
+  if (timeout_watch != 0)
+    g_source_remove (timeout_watch);
+  timeout_watch = 0;
+
+  ber_memfree (page_cookie.bv_val);
+  page_cookie.bv_val = NULL;
+  page_cookie.bv_len = 0;
+
+  if (ldap_context != NULL)
+    ldap_unbind_ext (ldap_context, NULL, NULL);
   ldap_context = NULL;
+  bound = false;
+  msgid = -1;
 }
 
 void
@@ -984,6 +1459,15 @@ OPENLDAP::BookForm (boost::shared_ptr<Ekiga::FormRequestSimple> request,
    */
   request->text ("authcID", _("Bind _ID:"), info.authcID, _("User ID; leave blank for anonymous / nonauthenticated"));
   request->private_text ("password", _("_Password:"), info.password, _("The password for the user ID above, if any"));
+  {
+    std::stringstream ttl;
+    std::stringstream size;
+
+    ttl << info.cache_ttl;
+    size << info.cache_size;
+    request->text ("cacheTTL", _("Cache _lifetime:"), ttl.str (), _("How many seconds the results of a search are reused"));
+    request->text ("cacheSize", _("Cache si_ze:"), size.str (), _("How many searches are remembered; 0 to always ask the server"));
+  }
   request->boolean ("startTLS", _("Use _TLS"), info.starttls);
   request->boolean ("sasl", _("Use SAS_L"), info.sasl);
   {
@@ -1027,6 +1511,8 @@ OPENLDAP::BookFormInfo (Ekiga::Form &result,
   std::string nameAttr = result.text ("nameAttr");
   std::string callAttr = result.text ("callAttr");
   std::string filter = result.text ("filter");
+  std::string cache_ttl = result.text ("cacheTTL");
+  std::string cache_size = result.text ("cacheSize");
 
   errmsg = "";
 
@@ -1045,6 +1531,12 @@ OPENLDAP::BookFormInfo (Ekiga::Form &result,
   if (ldap_url_parse (uri.c_str(), &url_host))
     errmsg += _("Invalid Server URI\n");
 
+  if (cache_ttl.empty ()
+      || cache_ttl.find_first_not_of ("0123456789") != std::string::npos
+      || cache_size.empty ()
+      || cache_size.find_first_not_of ("0123456789") != std::string::npos)
+    errmsg += _("Please provide numbers for the cache settings\n");
+
   if (!errmsg.empty()) {
     return -1;
   }
@@ -1064,6 +1556,8 @@ OPENLDAP::BookFormInfo (Ekiga::Form &result,
   bookinfo.starttls = result.boolean ("startTLS");
   bookinfo.sasl = result.boolean ("sasl");
   bookinfo.saslMech = result.single_choice ("saslMech");
+  bookinfo.cache_ttl = strtoul (cache_ttl.c_str (), NULL, 10);
+  bookinfo.cache_size = strtoul (cache_size.c_str (), NULL, 10);
 
   if (bookinfo.sasl || bookinfo.starttls) {
     new_bits += "?";
@@ -1139,6 +1633,19 @@ OPENLDAP::Book::on_edit_form_submitted (bool submitted,
 
   robust_xmlNodeSetContent (node, &password_node, "password", bookinfo.password);
 
+  {
+    std::stringstream ttl;
+    std::stringstream size;
+
+    ttl << bookinfo.cache_ttl;
+    size << bookinfo.cache_size;
+    robust_xmlNodeSetContent (node, &cache_ttl_node, "cache_ttl", ttl.str ());
+    robust_xmlNodeSetContent (node, &cache_size_node, "cache_size", size.str ());
+  }
+
+  /* the server or the filter template may have changed */
+  cache.clear ();
+
   if (bookinfo.uri_host == EKIGA_NET_URI)
     I_am_an_ekiga_net_book = true;
   else
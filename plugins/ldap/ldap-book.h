@@ -40,6 +40,7 @@
 #define __LDAP_BOOK_H__
 
 #include <vector>
+#include <list>
 #include <boost/smart_ptr.hpp>
 #include <libxml/tree.h>
 #include <glib/gi18n.h>
@@ -54,6 +55,12 @@
 
 #include <ldap.h>
 
+/* by default, the results of the last twenty searches are kept for five
+ * minutes
+ */
+#define LDAP_CACHE_TTL 300
+#define LDAP_CACHE_SIZE 20
+
 namespace OPENLDAP
 {
   struct ldap_url_desc_deleter
@@ -72,6 +79,8 @@ namespace OPENLDAP
     boost::shared_ptr<LDAPURLDesc> urld;
     bool sasl;
     bool starttls;
+    unsigned int cache_ttl; // in seconds
+    unsigned int cache_size; // how many searches
   };
 
   void BookForm (boost::shared_ptr<Ekiga::FormRequestSimple> req,
@@ -131,12 +140,34 @@ namespace OPENLDAP
     /* public for access from C */
     void on_sasl_form_submitted (bool, Ekiga::Form &);
     Ekiga::FormBuilder *saslform;
+    bool refresh_result ();
+    bool refresh_timeout ();
+    struct Connection;
+    void refresh_connected (Connection* connection);
 
   private:
 
     void refresh_start ();
-    void refresh_bound ();
-    void refresh_result ();
+    bool refresh_watch ();
+    void refresh_search ();
+    void refresh_end ();
+    void refresh_status ();
+
+    /* the results of the last searches, most recently used first : they
+     * answer the same searches again, and also the more precise ones
+     * (as the user types) when they were complete
+     */
+    struct CachedSearch
+    {
+      std::string filter;
+      std::list<ContactPtr> contacts;
+      gint64 time;
+      bool complete;
+    };
+    std::list<CachedSearch> cache;
+
+    bool search_in_cache ();
+    void add_to_cache (const CachedSearch& search);
 
     ContactPtr parse_result(struct ldapmsg *);
 
@@ -154,11 +185,21 @@ namespace OPENLDAP
     xmlNodePtr uri_node;
     xmlNodePtr authcID_node;
     xmlNodePtr password_node;
+    xmlNodePtr cache_ttl_node;
+    xmlNodePtr cache_size_node;
 
     struct BookInfo bookinfo;
 
     struct ldap *ldap_context;
-    unsigned int patience;
+    Connection* connecting; // while a thread connects to the server
+    bool bound;
+    int msgid; // of the bind or the search we're waiting for
+    guint io_watch;
+    guint timeout_watch;
+    struct berval page_cookie;
+    unsigned int found;
+    std::string searched_filter;
+    std::list<ContactPtr> search_results;
 
     std::string status;
     std::string search_filter;
@@ -36,6 +36,9 @@
  *
  */
 
+#include <string.h>
+#include <glib.h>
+
 #include "ldap-contact.h"
 #include "menu-builder-tools.h"
 
@@ -52,8 +55,9 @@ struct null_deleter
 
 OPENLDAP::Contact::Contact (Ekiga::ServiceCore &_core,
 			    const std::string _name,
-			    const std::map<std::string, std::string> _uris)
-  : core(_core), name(_name), uris(_uris)
+			    const std::map<std::string, std::string> _uris,
+			    const std::map<std::string, std::string> _values)
+  : core(_core), name(_name), uris(_uris), values(_values)
 {
 }
 
@@ -83,6 +87,35 @@ OPENLDAP::Contact::has_uri (const std::string uri) const
   return result;
 }
 
+static bool
+folded_contains (const std::string str,
+		 const std::string folded_search)
+{
+  gchar* folded = g_utf8_casefold (str.c_str (), -1);
+  bool result = (strstr (folded, folded_search.c_str ()) != NULL);
+
+  g_free (folded);
+
+  return result;
+}
+
+bool
+OPENLDAP::Contact::matches (const std::list<std::string> attributes,
+			    const std::string folded_search) const
+{
+  bool result = false;
+
+  for (std::list<std::string>::const_iterator iter = attributes.begin ();
+       !result && iter != attributes.end ();
+       iter++) {
+
+    std::map<std::string, std::string>::const_iterator value = values.find (*iter);
+    result = (value != values.end () && folded_contains (value->second, folded_search));
+  }
+
+  return result;
+}
+
 bool
 OPENLDAP::Contact::populate_menu (Ekiga::MenuBuilder &builder)
 {
@@ -39,6 +39,8 @@
 #ifndef __LDAP_CONTACT_H__
 #define __LDAP_CONTACT_H__
 
+#include <list>
+
 #include "contact-core.h"
 
 namespace OPENLDAP
@@ -54,9 +56,13 @@ namespace OPENLDAP
   {
   public:
 
+    /* the values are those of the name and call attributes as the server
+     * gave them, by lowercase attribute name
+     */
     Contact (Ekiga::ServiceCore &_core,
 	     const std::string _name,
-    	     const std::map<std::string, std::string> _uris);
+    	     const std::map<std::string, std::string> _uris,
+	     const std::map<std::string, std::string> _values);
 
     ~Contact ();
 
@@ -64,6 +70,13 @@ namespace OPENLDAP
 
     bool has_uri (const std::string uri) const;
 
+    /* whether the (casefolded) search string is found in the value of one
+     * of the (lowercase) attributes, to narrow down the results of a
+     * broader search without the server
+     */
+    bool matches (const std::list<std::string> attributes,
+		  const std::string folded_search) const;
+
     bool populate_menu (Ekiga::MenuBuilder &builder);
 
   private:
@@ -72,6 +85,7 @@ namespace OPENLDAP
 
     std::string name;
     std::map<std::string, std::string> uris;
+    std::map<std::string, std::string> values;
   };
 
   typedef boost::shared_ptr<Contact> ContactPtr;
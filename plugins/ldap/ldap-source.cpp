@@ -147,6 +147,8 @@ OPENLDAP::Source::new_book ()
   bookinfo.saslMech = "";
   bookinfo.sasl = false;
   bookinfo.starttls = false;
+  bookinfo.cache_ttl = LDAP_CACHE_TTL;
+  bookinfo.cache_size = LDAP_CACHE_SIZE;
 
   OPENLDAP::BookInfoParse (bookinfo);
   OPENLDAP::BookForm (request, bookinfo, _("Create LDAP directory"));
@@ -166,6 +168,8 @@ OPENLDAP::Source::new_ekiga_net_book ()
   bookinfo.saslMech = "";
   bookinfo.sasl = false;
   bookinfo.starttls = false;
+  bookinfo.cache_ttl = LDAP_CACHE_TTL;
+  bookinfo.cache_size = LDAP_CACHE_SIZE;
 
   add (bookinfo);
 }
@@ -111,19 +111,7 @@ LM::Account::Account (boost::shared_ptr<Ekiga::PersonalDetails> details_,
 
   status = _("Inactive");
 
-  xmlChar* xml_str = xmlGetProp (node, BAD_CAST "startup");
-  bool enable_on_startup = false;
-  if (xml_str != NULL) {
-
-    if (xmlStrEqual (xml_str, BAD_CAST "true")) {
-
-      enable_on_startup = true;
-    } else {
-
-      enable_on_startup = false;
-    }
-  }
-  xmlFree (xml_str);
+  parse_node ();
 
   connection = lm_connection_new (NULL);
 
@@ -178,6 +166,8 @@ LM::Account::Account (boost::shared_ptr<Ekiga::PersonalDetails> details_,
     xmlSetProp (node, BAD_CAST "startup", BAD_CAST "false");
   }
 
+  parse_node ();
+
   connection = lm_connection_new (NULL);
   lm_connection_set_disconnect_function (connection, (LmDisconnectFunction)on_disconnected_c,
 					 this, NULL);
@@ -191,36 +181,20 @@ void
 LM::Account::enable ()
 {
   GError *error = NULL;
-  xmlChar* server =  NULL;
-  unsigned port = LM_CONNECTION_DEFAULT_PORT;
   LmSSL* ssl = NULL;
 
-  server = xmlGetProp (node, BAD_CAST "server");
-  {
-    xmlChar* port_str = xmlGetProp (node, BAD_CAST "port");
-
-    port = atoi ((const char*)port_str);
-    xmlFree (port_str);
-  }
-
   {
     gchar* jid = NULL;
-    xmlChar* user = NULL;
-    xmlChar* resource = NULL;
-    user = xmlGetProp (node, BAD_CAST "user");
-    resource = xmlGetProp (node, BAD_CAST "resource");
-    jid = g_strdup_printf ("%s@%s/%s", user, server, resource);
+    jid = g_strdup_printf ("%s@%s/%s", user.c_str (), server.c_str (), resource.c_str ());
     lm_connection_set_jid (connection, jid);
     g_free (jid);
-    xmlFree (user);
-    xmlFree (resource);
   }
 
   /* ugly but necessary */
-  if (g_strcmp0 ("gmail.com", (const char*)server) == 0)
+  if (server == "gmail.com")
     lm_connection_set_server (connection, "xmpp.l.google.com");
   else
-    lm_connection_set_server (connection, (const char*)server);
+    lm_connection_set_server (connection, server.c_str ());
 
   lm_connection_set_port (connection, port);
 
@@ -244,9 +218,8 @@ LM::Account::enable ()
     status = _("Connecting...");
   }
 
-  xmlFree (server);
-
   xmlSetProp (node, BAD_CAST "startup", BAD_CAST "true");
+  enable_on_startup = true;
   trigger_saving ();
 
   updated ();
@@ -256,6 +229,7 @@ void
 LM::Account::disable ()
 {
   xmlSetProp (node, BAD_CAST "startup", BAD_CAST "false");
+  enable_on_startup = false;
   trigger_saving ();
 
   lm_connection_close (connection, NULL);
@@ -278,15 +252,10 @@ LM::Account::on_connection_opened (bool result)
 {
   if (result) {
 
-    xmlChar* user = xmlGetProp (node, BAD_CAST "user");
-    xmlChar* password = xmlGetProp (node, BAD_CAST "password");
-    xmlChar* resource = xmlGetProp (node, BAD_CAST "resource");
     status = _("Authenticating...");
-    lm_connection_authenticate (connection, (const char*)user,
-				(const char*)password, (const char*)resource,
+    lm_connection_authenticate (connection, user.c_str (),
+				password.c_str (), resource.c_str (),
 				(LmResultFunction)on_authenticate_c, this, NULL, NULL);
-    xmlFree (password);
-    xmlFree (resource);
     updated ();
   } else {
 
@@ -332,47 +301,21 @@ void
 LM::Account::edit ()
 {
   boost::shared_ptr<Ekiga::FormRequestSimple> request = boost::shared_ptr<Ekiga::FormRequestSimple> (new Ekiga::FormRequestSimple (boost::bind (&LM::Account::on_edit_form_submitted, this, _1, _2)));
-  xmlChar* xml_str = NULL;
 
   request->title (_("Edit account"));
 
   request->instructions (_("Please update the following fields:"));
 
-  xml_str = xmlGetProp (node, BAD_CAST "name");
-  request->text ("name", _("Name:"), (const char*)xml_str, _("Account name, e.g. MyAccount"));
-  xmlFree (xml_str);
-
-  xml_str = xmlGetProp (node, BAD_CAST "user");
-  request->text ("user", _("User:"), (const char*)xml_str, _("The user name, e.g. jim"));
-  xmlFree (xml_str);
-
-  xml_str = xmlGetProp (node, BAD_CAST "server");
-  request->text ("server", _("Server:"), (const char*)xml_str, _("The server, e.g. jabber.org"));
-  xmlFree (xml_str);
-
-  xml_str = xmlGetProp (node, BAD_CAST "port");
-  request->text ("port", _("Port:"), (const char*)xml_str, _("The transport protocol port, if different than the default"));
-  xmlFree (xml_str);
-
-  xml_str = xmlGetProp (node, BAD_CAST "resource");
-  request->text ("resource", _("Resource:"), (const char*)xml_str, _("The resource, such as home or work, allowing to distinguish among several terminals registered to the same account; leave empty if you do not know what it is"));
-  xmlFree (xml_str);
-
-  xml_str = xmlGetProp (node, BAD_CAST "password");
-  request->private_text ("password", _("Password:"), (const char*)xml_str, _("Password associated to the user"));
-  xmlFree (xml_str);
-
-  xml_str = xmlGetProp (node, BAD_CAST "startup");
-  bool enable_on_startup = false;
-  if (xmlStrEqual (xml_str, BAD_CAST "true")) {
-
-    enable_on_startup = true;
-  } else {
-
-    enable_on_startup = false;
-
+  request->text ("name", _("Name:"), name, _("Account name, e.g. MyAccount"));
+  request->text ("user", _("User:"), user, _("The user name, e.g. jim"));
+  request->text ("server", _("Server:"), server, _("The server, e.g. jabber.org"));
+  {
+    std::stringstream sstream;
+    sstream << port;
+    request->text ("port", _("Port:"), sstream.str (), _("The transport protocol port, if different than the default"));
   }
-  xmlFree (xml_str);
+  request->text ("resource", _("Resource:"), resource, _("The resource, such as home or work, allowing to distinguish among several terminals registered to the same account; leave empty if you do not know what it is"));
+  request->private_text ("password", _("Password:"), password, _("Password associated to the user"));
   request->boolean ("enabled", _("Enable account"), enable_on_startup);
 
   questions (request);
@@ -387,30 +330,32 @@ LM::Account::on_edit_form_submitted (bool submitted,
 
   disable (); // don't stay connected!
 
-  std::string name = result.text ("name");
-  std::string user = result.text ("user");
-  std::string server = result.text ("server");
-  std::string port = result.text ("port");
-  std::string resource = result.text ("resource");
-  std::string password = result.private_text ("password");
-  bool enable_on_startup = result.boolean ("enabled");
-
-  xmlSetProp (node, BAD_CAST "name", BAD_CAST name.c_str ());
-  xmlSetProp (node, BAD_CAST "user", BAD_CAST user.c_str ());
-  xmlSetProp (node, BAD_CAST "server", BAD_CAST server.c_str ());
-  xmlSetProp (node, BAD_CAST "port", BAD_CAST port.c_str ());
-  xmlSetProp (node, BAD_CAST "resource", BAD_CAST resource.c_str ());
-  xmlSetProp (node, BAD_CAST "password", BAD_CAST password.c_str ());
+  std::string new_name = result.text ("name");
+  std::string new_user = result.text ("user");
+  std::string new_server = result.text ("server");
+  std::string new_port = result.text ("port");
+  std::string new_resource = result.text ("resource");
+  std::string new_password = result.private_text ("password");
+  bool new_enable_on_startup = result.boolean ("enabled");
+
+  xmlSetProp (node, BAD_CAST "name", BAD_CAST new_name.c_str ());
+  xmlSetProp (node, BAD_CAST "user", BAD_CAST new_user.c_str ());
+  xmlSetProp (node, BAD_CAST "server", BAD_CAST new_server.c_str ());
+  xmlSetProp (node, BAD_CAST "port", BAD_CAST new_port.c_str ());
+  xmlSetProp (node, BAD_CAST "resource", BAD_CAST new_resource.c_str ());
+  xmlSetProp (node, BAD_CAST "password", BAD_CAST new_password.c_str ());
+
+  if (new_enable_on_startup)
+    xmlSetProp (node, BAD_CAST "startup", BAD_CAST "true");
+  else
+    xmlSetProp (node, BAD_CAST "startup", BAD_CAST "false");
 
-  if (enable_on_startup) {
+  parse_node ();
 
-    xmlSetProp (node, BAD_CAST "startup", BAD_CAST "true");
+  if (enable_on_startup)
     enable ();
-  } else {
-
-    xmlSetProp (node, BAD_CAST "startup", BAD_CAST "false");
+  else
     updated ();
-  }
 }
 
 void
@@ -457,23 +402,7 @@ LM::Account::get_status () const
 bool
 LM::Account::is_enabled () const
 {
-  bool result = false;
-  xmlChar* xml_str = xmlGetProp (node, BAD_CAST "startup");
-
-  if (xml_str != NULL) {
-
-    if (xmlStrEqual (xml_str, BAD_CAST "true")) {
-
-      result = true;
-    } else {
-
-      result = false;
-    }
-
-    xmlFree (xml_str);
-  }
-
-  return result;
+  return enable_on_startup;
 }
 
 bool
@@ -488,14 +417,70 @@ LM::Account::is_active () const
 const std::string
 LM::Account::get_name () const
 {
-  std::string name;
-  xmlChar* xml_str = xmlGetProp (node, BAD_CAST "name");
+  return name;
+}
 
-  name = (const char*)xml_str;
+void
+LM::Account::parse_node ()
+{
+  xmlChar* xml_str = NULL;
 
-  xmlFree (xml_str);
+  name = "";
+  user = "";
+  server = "";
+  port = LM_CONNECTION_DEFAULT_PORT;
+  resource = "";
+  password = "";
+  enable_on_startup = false;
 
-  return name;
+  xml_str = xmlGetProp (node, BAD_CAST "name");
+  if (xml_str != NULL) {
+
+    name = (const char*)xml_str;
+    xmlFree (xml_str);
+  }
+
+  xml_str = xmlGetProp (node, BAD_CAST "user");
+  if (xml_str != NULL) {
+
+    user = (const char*)xml_str;
+    xmlFree (xml_str);
+  }
+
+  xml_str = xmlGetProp (node, BAD_CAST "server");
+  if (xml_str != NULL) {
+
+    server = (const char*)xml_str;
+    xmlFree (xml_str);
+  }
+
+  xml_str = xmlGetProp (node, BAD_CAST "port");
+  if (xml_str != NULL) {
+
+    port = atoi ((const char*)xml_str);
+    xmlFree (xml_str);
+  }
+
+  xml_str = xmlGetProp (node, BAD_CAST "resource");
+  if (xml_str != NULL) {
+
+    resource = (const char*)xml_str;
+    xmlFree (xml_str);
+  }
+
+  xml_str = xmlGetProp (node, BAD_CAST "password");
+  if (xml_str != NULL) {
+
+    password = (const char*)xml_str;
+    xmlFree (xml_str);
+  }
+
+  xml_str = xmlGetProp (node, BAD_CAST "startup");
+  if (xml_str != NULL) {
+
+    enable_on_startup = xmlStrEqual (xml_str, BAD_CAST "true");
+    xmlFree (xml_str);
+  }
 }
 
 void
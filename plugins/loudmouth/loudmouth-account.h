@@ -112,6 +112,16 @@ namespace LM
     boost::shared_ptr<Cluster> cluster;
     xmlNodePtr node;
 
+    /* the node's attributes, parsed when it is loaded or edited */
+    void parse_node ();
+    std::string name;
+    std::string user;
+    std::string server;
+    unsigned port;
+    std::string resource;
+    std::string password;
+    bool enable_on_startup;
+
     std::string status;
 
     LmConnection* connection;
@@ -38,13 +38,7 @@
 void
 LM::Conversation::visit_messages (boost::function1<bool, const Ekiga::Message&> visitor) const
 {
-  for (std::list<Ekiga::Message>::const_iterator iter = messages.begin ();
-       iter != messages.end ();
-       ++iter) {
-
-    if (!visitor (*iter))
-      break;
-  }
+  messages.visit (visitor);
 }
 
 bool
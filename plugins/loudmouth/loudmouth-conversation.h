@@ -37,6 +37,7 @@
 #define __LOUDMOUTH_CONVERSATION_H__
 
 #include "conversation.h"
+#include "message-history.h"
 #include "loudmouth-heap.h"
 
 namespace LM {
@@ -59,6 +60,14 @@ namespace LM {
 
     void visit_messages (boost::function1<bool, const Ekiga::Message&>) const;
 
+    unsigned int get_older_messages_count () const
+    { return messages.get_older_count (); }
+
+    void visit_messages_range (unsigned int first,
+			       unsigned int count,
+			       boost::function1<bool, const Ekiga::Message&> visitor) const
+    { messages.visit_range (first, count, visitor); }
+
     bool send_message (const Ekiga::Message::payload_type& payload);
 
     void got_message (const Ekiga::Message::payload_type& payload);
@@ -77,7 +86,7 @@ namespace LM {
     int unreads;
     std::string title;
     std::string status;
-    std::list<Ekiga::Message> messages;
+    Ekiga::MessageHistory messages;
   };
 
   typedef boost::shared_ptr<Conversation> ConversationPtr;
@@ -46,6 +46,7 @@ LM::HeapRoster::HeapRoster (boost::shared_ptr<Ekiga::PersonalDetails> details_,
 			    DialectPtr dialect_):
   details(details_), dialect(dialect_)
 {
+  jid_index = add_index (boost::bind (&LM::Presentity::get_jid, _1));
   details_connection = details->updated.connect (boost::bind (&LM::HeapRoster::on_personal_details_updated, this));
 }
 
@@ -276,23 +277,18 @@ LM::HeapRoster::parse_roster (LmMessageNode* query)
     }
 
     const gchar* jid = lm_message_node_get_attribute (node, "jid");
-    bool found = false;
-    for (iterator iter = begin (); !found && iter != end (); ++iter) {
-
-      if ((*iter)->get_jid () == jid) {
+    PresentityPtr item = find_item (jid);
+    if (item) {
 
-	found = true;
-	const gchar* subscription = lm_message_node_get_attribute (node, "subscription");
-	if (subscription != NULL && g_strcmp0 (subscription, "remove") == 0) {
+      const gchar* subscription = lm_message_node_get_attribute (node, "subscription");
+      if (subscription != NULL && g_strcmp0 (subscription, "remove") == 0) {
 
-	  (*iter)->removed ();
-	} else {
+	item->removed ();
+      } else {
 
-	  (*iter)->update (node);
-	}
+	item->update (node);
       }
-    }
-    if ( !found) {
+    } else {
 
       PresentityPtr presentity(new Presentity (connection, node));
       presentity->chat_requested.connect (boost::bind (&LM::HeapRoster::on_chat_requested, this, presentity));
@@ -428,18 +424,7 @@ LM::HeapRoster::subscribe_from_form_submitted (bool submitted,
 LM::PresentityPtr
 LM::HeapRoster::find_item (const std::string jid)
 {
-  PresentityPtr result;
-
-  for (iterator iter = begin (); iter != end (); ++iter) {
-
-    if ((*iter)->get_jid () == jid) {
-
-      result = *iter;
-      break;
-    }
-  }
-
-  return result;
+  return find_object (jid_index, jid);
 }
 
 void
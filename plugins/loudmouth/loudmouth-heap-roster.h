@@ -131,6 +131,9 @@ namespace LM
      * notified it was added, we can know we did that and act accordingly.
      */
     std::set<std::string> items_added_by_me;
+
+    /* the RefLister index used by find_item */
+    int jid_index;
   };
 
   typedef boost::shared_ptr<HeapRoster> HeapRosterPtr;
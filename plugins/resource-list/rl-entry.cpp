@@ -89,6 +89,21 @@ RL::Entry::~Entry ()
 {
 }
 
+void
+RL::Entry::update (boost::shared_ptr<xmlDoc> doc_,
+		   xmlNodePtr node_)
+{
+  std::string old_name = get_name ();
+
+  doc = doc_;
+  node = node_;
+  name_node = NULL;
+  parse ();
+
+  if (get_name () != old_name)
+    updated ();
+}
+
 const std::string
 RL::Entry::get_uri () const
 {
@@ -62,6 +62,12 @@ namespace RL {
 
     ~Entry ();
 
+    /* makes the entry use a new version of its node, and emits
+     * updated only if its name changed
+     */
+    void update (boost::shared_ptr<xmlDoc> doc_,
+		 xmlNodePtr node_);
+
     /* needed so presence can be pushed into this presentity */
     const std::string get_uri () const;
 
@@ -251,22 +251,40 @@ RL::Heap::refresh ()
   path->set_credentials (username_str, password_str);
   path = path->build_child ("resource-lists");
 
-  while ( !presentities.empty ()) {
-
-    presentities.begin()->first->removed ();
-    for (std::list<boost::signals2::connection>::const_iterator iter2
-	   = presentities.begin()->second.begin ();
-	 iter2 != presentities.begin()->second.end ();
-	 ++iter2)
-      iter2->disconnect ();
-    presentities.erase (presentities.begin()->first);
-  }
-
-  doc.reset ();
+  /* show the last known version until the server answers */
+  if (presentities.empty () && xcap->get_cached (path, raw_doc))
+    parse_doc (raw_doc);
 
   xcap->read (path, boost::bind (&RL::Heap::on_document_received, this, _1, _2));
 }
 
+void
+RL::Heap::reload ()
+{
+  /* a presentity may have changed its node : make sure it gets
+   * the server version back, even if the document didn't change
+   */
+  raw_doc.clear ();
+  refresh ();
+}
+
+void
+RL::Heap::remove_presentity (PresentityPtr presentity)
+{
+  std::map<PresentityPtr, std::list<boost::signals2::connection> >::iterator iter = presentities.find (presentity);
+
+  if (iter == presentities.end ())
+    return;
+
+  presentity->removed ();
+  for (std::list<boost::signals2::connection>::const_iterator iter2
+	 = iter->second.begin ();
+       iter2 != iter->second.end ();
+       ++iter2)
+    iter2->disconnect ();
+  presentities.erase (iter);
+}
+
 void
 RL::Heap::on_document_received (bool error,
 				std::string value)
@@ -275,8 +293,9 @@ RL::Heap::on_document_received (bool error,
 
     // FIXME: do something
     std::cout << "XCAP error: " << value << std::endl;
-  } else {
+  } else if (value != raw_doc) {
 
+    raw_doc = value;
     parse_doc (value);
   }
 }
@@ -284,10 +303,10 @@ RL::Heap::on_document_received (bool error,
 void
 RL::Heap::parse_doc (std::string raw)
 {
-  doc = boost::shared_ptr<xmlDoc> (xmlRecoverMemory (raw.c_str (), raw.length ()), xmlFreeDoc);
-  if ( !doc)
-    doc = boost::shared_ptr<xmlDoc> (xmlNewDoc (BAD_CAST "1.0"), xmlFreeDoc);
-  xmlNodePtr doc_root = xmlDocGetRootElement (doc.get ());
+  boost::shared_ptr<xmlDoc> new_doc (xmlRecoverMemory (raw.c_str (), raw.length ()), xmlFreeDoc);
+  if ( !new_doc)
+    new_doc = boost::shared_ptr<xmlDoc> (xmlNewDoc (BAD_CAST "1.0"), xmlFreeDoc);
+  xmlNodePtr doc_root = xmlDocGetRootElement (new_doc.get ());
 
   if (doc_root == NULL
       || doc_root->name == NULL
@@ -295,9 +314,13 @@ RL::Heap::parse_doc (std::string raw)
 
     std::cout << "Invalid document in " << __PRETTY_FUNCTION__ << std::endl;
     // FIXME: warn the user somehow?
-    doc.reset ();
   } else {
 
+    /* the presentities keep the previous document alive until they
+     * have all moved to the new one
+     */
+    doc = new_doc;
+
 
     for (xmlNodePtr child = doc_root->children;
 	 child != NULL;
@@ -358,6 +381,16 @@ RL::Heap::parse_list (xmlNodePtr list)
   path = path->build_child ("resource-lists");
   path = path->build_child ("list");
 
+  /* entries are matched by uri with the presentities we already have, so
+   * only the real changes get signalled
+   */
+  std::multimap<std::string, PresentityPtr> old_presentities;
+  for (std::map<PresentityPtr,std::list<boost::signals2::connection> >::const_iterator
+	 iter = presentities.begin ();
+       iter != presentities.end ();
+       ++iter)
+    old_presentities.insert (std::make_pair (iter->first->get_uri (), iter->first));
+
   for (xmlNodePtr child = list->children;
        child != NULL;
        child = child->next)
@@ -365,16 +398,37 @@ RL::Heap::parse_list (xmlNodePtr list)
 	&& child->name != NULL
 	&& xmlStrEqual (BAD_CAST ("entry"), child->name)) {
 
+      std::string uri;
+      xmlChar* str = xmlGetProp (child, BAD_CAST "uri");
+      if (str != NULL) {
+
+	uri = (const char*)str;
+	xmlFree (str);
+      }
+
+      std::multimap<std::string, PresentityPtr>::iterator old = old_presentities.find (uri);
+      if (old != old_presentities.end ()) {
+
+	old->second->update (path, doc, child, writable);
+	old_presentities.erase (old);
+	continue;
+      }
+
       PresentityPtr presentity(new Presentity (services, path, doc, child, writable));
       std::list<boost::signals2::connection> conns;
       conns.push_back (presentity->updated.connect (boost::bind (boost::ref (presentity_updated), presentity)));
       conns.push_back (presentity->removed.connect (boost::bind(boost::ref (presentity_removed),presentity)));
-      conns.push_back (presentity->trigger_reload.connect (boost::bind (&RL::Heap::refresh, this)));
+      conns.push_back (presentity->trigger_reload.connect (boost::bind (&RL::Heap::reload, this)));
       conns.push_back (presentity->questions.connect (boost::ref (questions)));
       presentities[presentity]=conns;
       presentity_added (presentity);
       continue;
     }
+
+  for (std::multimap<std::string, PresentityPtr>::iterator iter = old_presentities.begin ();
+       iter != old_presentities.end ();
+       ++iter)
+    remove_presentity (iter->second);
 }
 
 void
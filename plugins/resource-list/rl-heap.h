@@ -108,8 +108,15 @@ namespace RL {
 
     std::map<PresentityPtr, std::list<boost::signals2::connection> > presentities;
 
+    /* the document the presentities come from */
+    std::string raw_doc;
+
     void refresh ();
 
+    void reload ();
+
+    void remove_presentity (PresentityPtr presentity);
+
     void on_document_received (bool error,
 			       std::string doc);
 
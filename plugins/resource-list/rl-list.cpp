@@ -42,6 +42,8 @@
 
 #include "rl-list.h"
 
+#include <map>
+
 class RL::ListImpl
 {
 public: // no need to make anything private
@@ -66,6 +68,8 @@ public: // no need to make anything private
 
   void flush ();
 
+  void flush_lists ();
+
   void refresh ();
 
   void on_xcap_answer (bool error,
@@ -225,15 +229,21 @@ RL::ListImpl::has_name (const std::string name) const
 }
 
 void
-RL::ListImpl::flush ()
+RL::ListImpl::flush_lists ()
 {
-  ordering.clear ();
-
   for (std::list<boost::shared_ptr<List> >::iterator iter = lists.begin ();
        iter != lists.end ();
        ++iter)
     (*iter)->flush ();
   lists.clear ();
+}
+
+void
+RL::ListImpl::flush ()
+{
+  ordering.clear ();
+
+  flush_lists ();
 
   for (std::list<std::pair<boost::shared_ptr<Entry>, std::list<boost::signals2::connection> > >::iterator iter = entries.begin ();
        iter != entries.end ();
@@ -256,8 +266,7 @@ RL::ListImpl::flush ()
 void
 RL::ListImpl::refresh ()
 {
-  flush ();
-
+  /* the entries are kept : parse () will only signal what changed */
   boost::shared_ptr<XCAP::Core> xcap = core.get<XCAP::Core> ("xcap-core");
   xcap->read (path, boost::bind (&RL::ListImpl::on_xcap_answer, this, _1, _2));
 }
@@ -272,17 +281,19 @@ RL::ListImpl::on_xcap_answer (bool error,
 
   } else {
 
-    doc = boost::shared_ptr<xmlDoc> (xmlRecoverMemory (value.c_str (), value.length ()), xmlFreeDoc);
-    if ( !doc)
-      doc = boost::shared_ptr<xmlDoc> (xmlNewDoc (BAD_CAST "1.0"), xmlFreeDoc);
-    node = xmlDocGetRootElement (doc.get ());
-    if (node == NULL
-	|| node->name == NULL
-	|| !xmlStrEqual (BAD_CAST "list", node->name)) {
+    boost::shared_ptr<xmlDoc> new_doc (xmlRecoverMemory (value.c_str (), value.length ()), xmlFreeDoc);
+    if ( !new_doc)
+      new_doc = boost::shared_ptr<xmlDoc> (xmlNewDoc (BAD_CAST "1.0"), xmlFreeDoc);
+    xmlNodePtr new_node = xmlDocGetRootElement (new_doc.get ());
+    if (new_node == NULL
+	|| new_node->name == NULL
+	|| !xmlStrEqual (BAD_CAST "list", new_node->name)) {
 
       // FIXME : how to properly tell the user?
     } else {
 
+      doc = new_doc;
+      node = new_node;
       parse ();
     }
   }
@@ -293,6 +304,21 @@ RL::ListImpl::parse ()
 {
   int list_pos = 1;
   int entry_pos = 1;
+  typedef std::list<std::pair<boost::shared_ptr<Entry>, std::list<boost::signals2::connection> > > entry_list;
+  entry_list old_entries;
+  std::multimap<std::string, entry_list::iterator> old_uris;
+
+  /* sub-lists are rebuilt, but entries are matched by uri with the ones
+   * we already have, so only the real changes get signalled
+   */
+  flush_lists ();
+  ordering.clear ();
+  old_entries.swap (entries);
+  for (entry_list::iterator iter = old_entries.begin ();
+       iter != old_entries.end ();
+       ++iter)
+    old_uris.insert (std::make_pair (iter->first->get_uri (), iter));
+  name_node = NULL;
 
   for (xmlNodePtr child = node->children; child != NULL; child = child->next) {
 
@@ -338,6 +364,26 @@ RL::ListImpl::parse ()
 	&& child->name != NULL
 	&& xmlStrEqual (BAD_CAST "entry", child->name)) {
 
+      std::string uri;
+      xmlChar* str = xmlGetProp (child, BAD_CAST "uri");
+      if (str != NULL) {
+
+	uri = (const char*)str;
+	xmlFree (str);
+      }
+
+      std::multimap<std::string, entry_list::iterator>::iterator old = old_uris.find (uri);
+
+      if ( !uri.empty () && old != old_uris.end ()) {
+
+	old->second->first->update (doc, child);
+	entries.splice (entries.end (), old_entries, old->second);
+	old_uris.erase (old);
+	ordering.push_back (ENTRY);
+	entry_pos++;
+	continue;
+      }
+
       boost::shared_ptr<Entry> entry = boost::shared_ptr<Entry> (new Entry (core, path,
 							    entry_pos,
 							    display_name,
@@ -352,6 +398,18 @@ RL::ListImpl::parse ()
       continue;
     }
   }
+
+  for (entry_list::iterator iter = old_entries.begin ();
+       iter != old_entries.end ();
+       ++iter) {
+
+    iter->first->removed ();
+    for (std::list<boost::signals2::connection>::iterator conn_iter
+	   = iter->second.begin ();
+	 conn_iter != iter->second.end ();
+	 ++conn_iter)
+      conn_iter->disconnect ();
+  }
 }
 
 void
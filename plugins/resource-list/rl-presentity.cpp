@@ -65,25 +65,62 @@ RL::Presentity::Presentity (Ekiga::ServiceCore &services_,
 {
   boost::shared_ptr<Ekiga::PresenceCore> presence_core(services.get<Ekiga::PresenceCore> ("presence-core"));
   xmlChar *xml_str = NULL;
-  xmlNsPtr ns = xmlSearchNsByHref (doc.get (), node,
-                                   BAD_CAST "http://www.ekiga.org");
-
-  if (ns == NULL) {
-
-    // FIXME: we should handle the case, even if it shouldn't happen
-  }
 
   xml_str = xmlGetProp (node, BAD_CAST "uri");
   if (xml_str != NULL) {
 
     uri = (const char *)xml_str;
-    path = path_->build_child_with_attribute ("entry", "uri", uri);
     xmlFree (xml_str);
   } else {
 
     // FIXME: we should handle the case, even if it shouldn't happen
 
   }
+  list_path = path_;
+  path = list_path->build_child_with_attribute ("entry", "uri", uri);
+
+  parse_node ();
+
+  presence_core->fetch_presence (uri);
+}
+
+void
+RL::Presentity::update (boost::shared_ptr<XCAP::Path> path_,
+			boost::shared_ptr<xmlDoc> doc_,
+			xmlNodePtr node_,
+			bool writable_)
+{
+  std::string old_name = get_name ();
+  std::set<std::string> old_groups = groups;
+
+  /* the uri is the same : that's how the heap matched us */
+  list_path = path_;
+  path = list_path->build_child_with_attribute ("entry", "uri", uri);
+  doc = doc_;
+  node = node_;
+  writable = writable_;
+
+  parse_node ();
+
+  if (get_name () != old_name || groups != old_groups)
+    updated ();
+}
+
+void
+RL::Presentity::parse_node ()
+{
+  xmlChar *xml_str = NULL;
+  xmlNsPtr ns = xmlSearchNsByHref (doc.get (), node,
+                                   BAD_CAST "http://www.ekiga.org");
+
+  if (ns == NULL) {
+
+    // FIXME: we should handle the case, even if it shouldn't happen
+  }
+
+  name_node = NULL;
+  group_nodes.clear ();
+  groups.clear ();
 
   for (xmlNodePtr child = node->children ;
        child != NULL ;
@@ -116,8 +153,6 @@ RL::Presentity::Presentity (Ekiga::ServiceCore &services_,
        iter != group_nodes.end ();
        iter++)
     groups.insert (iter->first);
-
-  presence_core->fetch_presence (uri);
 }
 
 RL::Presentity::~Presentity ()
@@ -253,16 +288,21 @@ RL::Presentity::edit_presentity_form_submitted (bool submitted,
   std::map<std::string, xmlNodePtr> future_group_nodes;
   xmlNsPtr ns = xmlSearchNsByHref (node->doc, node,
                                    BAD_CAST "http://www.ekiga.org");
-  bool reload = false;
+  boost::shared_ptr<XCAP::Path> old_path;
 
   robust_xmlNodeSetContent (node, &name_node, "name", new_name);
 
   if (uri != new_uri) {
 
-    xmlSetProp (node, (const xmlChar*)"uri", (const xmlChar*)uri.c_str ());
+    /* the entry is selected by its uri, so it moves : the new one
+     * gets written, then the old one erased
+     */
+    xmlSetProp (node, (const xmlChar*)"uri",
+		BAD_CAST robust_xmlEscape (node->doc, new_uri).c_str ());
     boost::shared_ptr<Ekiga::PresenceCore> presence_core(services.get<Ekiga::PresenceCore> ("presence-core"));
     presence_core->unfetch_presence (uri);
-    reload = true;
+    old_path = path;
+    path = list_path->build_child_with_attribute ("entry", "uri", new_uri);
   }
 
   for (std::map<std::string, xmlNodePtr>::const_iterator iter
@@ -293,11 +333,11 @@ RL::Presentity::edit_presentity_form_submitted (bool submitted,
   group_nodes = future_group_nodes;
   groups = new_groups;
 
-  save (reload);
+  save (old_path);
 }
 
 void
-RL::Presentity::save (bool reload)
+RL::Presentity::save (boost::shared_ptr<XCAP::Path> old_path)
 {
   xmlBufferPtr buffer = xmlBufferCreate ();
   int result = xmlNodeDump (buffer, node->doc, node, 0, 0);
@@ -307,7 +347,7 @@ RL::Presentity::save (bool reload)
     boost::shared_ptr<XCAP::Core> xcap = services.get<XCAP::Core> ("xcap-core");
     xcap->write (path, "application/xcap-el+xml",
                  (const char*)xmlBufferContent (buffer),
-                 boost::bind (&RL::Presentity::save_result, this, _1, reload));
+                 boost::bind (&RL::Presentity::save_result, this, _1, old_path));
   }
 
   xmlBufferFree (buffer);
@@ -319,6 +359,9 @@ RL::Presentity::remove ()
 {
   xmlUnlinkNode (node);
   xmlFreeNode (node);
+  node = NULL;
+  name_node = NULL;
+  group_nodes.clear ();
   boost::shared_ptr<Ekiga::PresenceCore> presence_core = services.get<Ekiga::PresenceCore> ("presence-core");
 
   presence_core->unfetch_presence (uri);
@@ -330,7 +373,7 @@ RL::Presentity::remove ()
 
 void
 RL::Presentity::save_result (std::string error,
-			     bool reload)
+			     boost::shared_ptr<XCAP::Path> old_path)
 {
   if ( !error.empty ()) {
 
@@ -339,8 +382,12 @@ RL::Presentity::save_result (std::string error,
     trigger_reload ();
   } else {
 
-    if (reload)
-      trigger_reload ();
+    if (old_path) {
+
+      boost::shared_ptr<XCAP::Core> xcap = services.get<XCAP::Core> ("xcap-core");
+      xcap->erase (old_path,
+		   boost::bind (&RL::Presentity::erase_result, this, _1));
+    }
     else
       updated ();
   }
@@ -61,6 +61,14 @@ namespace RL
 
     ~Presentity ();
 
+    /* makes the presentity use a new version of its node, and emits
+     * updated only if what it shows changed
+     */
+    void update (boost::shared_ptr<XCAP::Path> path_,
+		 boost::shared_ptr<xmlDoc> doc_,
+		 xmlNodePtr _node,
+		 bool writable_);
+
     const std::string get_name () const;
 
     const std::string get_presence () const;
@@ -83,22 +91,25 @@ namespace RL
 
   private:
 
+    void parse_node ();
+
     void edit_presentity ();
 
     void edit_presentity_form_submitted (bool submitted,
 					 Ekiga::Form &result);
 
-    void save (bool reload);
+    void save (boost::shared_ptr<XCAP::Path> old_path);
 
     void remove ();
 
     void save_result (std::string error,
-		      bool reload);
+		      boost::shared_ptr<XCAP::Path> old_path);
 
     void erase_result (std::string error);
 
     Ekiga::ServiceCore &services;
 
+    boost::shared_ptr<XCAP::Path> list_path;
     boost::shared_ptr<XCAP::Path> path;
     boost::shared_ptr<xmlDoc> doc;
     xmlNodePtr node;
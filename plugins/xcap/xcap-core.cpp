@@ -39,8 +39,9 @@
 
 #include "xcap-core.h"
 
+#include <glib/gstdio.h>
 #include <libsoup/soup.h>
-#include <iostream>
+#include <map>
 
 /* declaration of XCAP::CoreImpl */
 
@@ -60,41 +61,54 @@ public:
 	      boost::function1<void,std::string> callback);
   void erase (boost::shared_ptr<Path>,
 	      boost::function1<void,std::string> callback);
+  bool get_cached (boost::shared_ptr<Path> path,
+		   std::string& document);
 
   /* public to be used by C callbacks */
 
-  /* The memory management is a little complex, here is how it works :
-   *
-   * There are two kinds of live SOUP sessions :
-   * - the old sessions : we have to keep them around because we can't unref
-   * a SOUP session from result_callback, so we need to keep it
-   * around for later ;
-   * - the pending ones : we keep them around to be able to cancel them if
-   * we destroy the core (and cancelling calls result_callback with an
-   * error -- the sessions get pushed from pending to old) ;
-   *
-   * So the problem of freeing the SOUP sessions becomes one is reduced to
-   * that of freeing the old sessions :
-   * - in the read method, we check this old_sessions list and unref any old
-   * session we find : ok ;
-   * - in the destructor, we check the old_sesssions list and unref any old
-   * session we find.
-   *
-   * That means if you launch a thousand reads fast then nothing,
-   * we will end up with a thousand SOUP sessions in old_sessions. But any
-   * subsequent read will clear them all.
+  /* The last fetched version of each document, with the ETag the server
+   * gave it : it is used to revalidate the document with a conditional GET,
+   * and is kept on disk to be available before the network answers.
+   */
+  struct CachedDocument
+  {
+    std::string etag;
+    std::string document;
+  };
+
+  CachedDocument* lookup_cache (const std::string uri);
+  void store_cache (const std::string uri,
+		    const std::string etag,
+		    const std::string document);
+
+private:
+
+  /* There is a single SOUP session per server and user, which is kept for
+   * the whole life of the core so that its connections get reused. Each
+   * message carries its own path, where the authenticate callback finds
+   * the credentials.
    *
-   * If you launch a thousand reads not fast enough, the last reads will
-   * already find the first sessions and get rid of them.
+   * A session remembers the credentials it authenticated with, so users
+   * with different credentials on the same server can't share one, and
+   * a session gets replaced when the password of its user changes.
    *
-   * In short this code guarantees :
-   * - the number of old sessions can't really grow if we have reads from time
-   * to time  ;
-   * - all the sessions will get freed eventually -- no leak!
+   * Aborting a session calls the result callbacks of its pending messages
+   * with an error, before it gets unref'ed.
    */
-  std::list<SoupSession*> pending_sessions;
-  std::list<SoupSession*> old_sessions;
-  void clear_old_sessions ();
+  struct Session
+  {
+    SoupSession* session;
+    std::string password;
+  };
+  std::map<std::string, Session> sessions;
+  std::map<std::string, CachedDocument> cache;
+  std::string cache_dir;
+
+  void queue_message (boost::shared_ptr<Path> path,
+		      SoupMessage* message,
+		      SoupSessionCallback callback,
+		      gpointer data);
+  std::string get_cache_file (const std::string uri) const;
 };
 
 /* soup callbacks */
@@ -114,68 +128,61 @@ struct cb_other_data
 };
 
 static void
-authenticate_read_callback (G_GNUC_UNUSED SoupSession* session,
-			    G_GNUC_UNUSED SoupMessage* message,
-			    SoupAuth* auth,
-			    gboolean retrying,
-			    gpointer data)
-{
-  cb_read_data* cb = (cb_read_data*)data;
-
-  if ( !retrying) {
-
-    soup_auth_authenticate (auth,
-			    cb->path->get_username ().c_str (),
-			    cb->path->get_password ().c_str ());
-  }
-}
-
-static void
-authenticate_other_callback (G_GNUC_UNUSED SoupSession* session,
-			     G_GNUC_UNUSED SoupMessage* message,
-			     SoupAuth* auth,
-			     gboolean retrying,
-			     gpointer data)
+authenticate_callback (G_GNUC_UNUSED SoupSession* session,
+		       SoupMessage* message,
+		       SoupAuth* auth,
+		       gboolean retrying,
+		       G_GNUC_UNUSED gpointer data)
 {
-  cb_other_data* cb = (cb_other_data*)data;
+  XCAP::Path* path = (XCAP::Path*)g_object_get_data (G_OBJECT (message),
+						     "xcap-path");
 
-  if ( !retrying) {
+  if ( !retrying && path != NULL) {
 
     soup_auth_authenticate (auth,
-			    cb->path->get_username ().c_str (),
-			    cb->path->get_password ().c_str ());
+			    path->get_username ().c_str (),
+			    path->get_password ().c_str ());
   }
 }
 
 static void
-result_read_callback (SoupSession* session,
+result_read_callback (G_GNUC_UNUSED SoupSession* session,
 		      SoupMessage* message,
 		      gpointer data)
 {
   cb_read_data* cb = (cb_read_data*)data;
+  std::string uri = cb->path->to_uri ();
+  XCAP::CoreImpl::CachedDocument* cached = NULL;
 
   if (message->status_code == SOUP_STATUS_OK) {
 
-    cb->callback (false, message->response_body->data);
+    std::string document (message->response_body->data,
+			  message->response_body->length);
+    const char* etag = soup_message_headers_get_one (message->response_headers,
+						     "ETag");
+
+    cb->core->store_cache (uri, etag ? etag : "", document);
+    cb->callback (false, document);
+  } else if (message->status_code == SOUP_STATUS_NOT_MODIFIED
+	     && (cached = cb->core->lookup_cache (uri)) != NULL) {
+
+    cb->callback (false, cached->document);
   } else {
 
     cb->callback (true, message->reason_phrase);
   }
 
-  cb->core->pending_sessions.remove (session);
-  cb->core->old_sessions.push_back (session);
-
   delete cb;
 }
 
 static void
-result_other_callback (SoupSession* session,
+result_other_callback (G_GNUC_UNUSED SoupSession* session,
 		       SoupMessage* message,
 		       gpointer data)
 {
   cb_other_data* cb = (cb_other_data*)data;
 
-  if (message->status_code == SOUP_STATUS_OK) {
+  if (SOUP_STATUS_IS_SUCCESSFUL (message->status_code)) {
 
     cb->callback ("");
   } else {
@@ -183,9 +190,6 @@ result_other_callback (SoupSession* session,
     cb->callback (message->reason_phrase);
   }
 
-  cb->core->pending_sessions.remove (session);
-  cb->core->old_sessions.push_back (session);
-
   delete cb;
 }
 
@@ -193,59 +197,169 @@ result_other_callback (SoupSession* session,
 
 XCAP::CoreImpl::CoreImpl ()
 {
+  gchar* dir = g_build_filename (g_get_user_cache_dir (), PACKAGE_NAME, "xcap", NULL);
+
+  cache_dir = dir;
+  g_free (dir);
 }
 
 XCAP::CoreImpl::~CoreImpl ()
 {
-  /* we loop like this because aborting calls result_callback, and hence
-   * makes the current iterator invalid : it gets pushed to the old sessions
-   * list!
-   */
-  while ( !pending_sessions.empty ())
-    soup_session_abort (*pending_sessions.begin ());
+  for (std::map<std::string, Session>::iterator iter = sessions.begin ();
+       iter != sessions.end ();
+       ++iter) {
 
-  /* now all pending sessions have been made old, so we can do that: */
-  clear_old_sessions ();
+    soup_session_abort (iter->second.session);
+    g_object_unref (iter->second.session);
+  }
+  sessions.clear ();
 }
 
 void
-XCAP::CoreImpl::clear_old_sessions ()
+XCAP::CoreImpl::queue_message (boost::shared_ptr<Path> path,
+			       SoupMessage* message,
+			       SoupSessionCallback callback,
+			       gpointer data)
 {
-  for (std::list<SoupSession*>::iterator iter = old_sessions.begin ();
-       iter != old_sessions.end ();
-       ++iter) {
+  SoupURI* uri = soup_message_get_uri (message);
+  gchar* server = g_strdup_printf ("%s://%s@%s:%u", uri->scheme,
+				   path->get_username ().c_str (),
+				   uri->host, uri->port);
+  SoupSession* session = NULL;
+  std::map<std::string, Session>::iterator iter = sessions.find (server);
 
-    soup_session_abort (*iter); // needed ?
-    g_object_unref (*iter);
+  if (iter != sessions.end () && iter->second.password != path->get_password ()) {
+
+    /* the session would keep sending the old credentials */
+    soup_session_abort (iter->second.session);
+    g_object_unref (iter->second.session);
+    sessions.erase (iter);
+    iter = sessions.end ();
   }
-  old_sessions.clear ();
+
+  if (iter != sessions.end ()) {
+
+    session = iter->second.session;
+  } else {
+
+    session = soup_session_async_new_with_options ("user-agent", "ekiga", NULL);
+    g_signal_connect (session, "authenticate",
+		      G_CALLBACK (authenticate_callback), this);
+    sessions[server].session = session;
+    sessions[server].password = path->get_password ();
+  }
+  g_free (server);
+
+  /* the path outlives the message : it is kept in the callback data */
+  g_object_set_data (G_OBJECT (message), "xcap-path", path.get ());
+
+  soup_session_queue_message (session, message, callback, data);
+}
+
+std::string
+XCAP::CoreImpl::get_cache_file (const std::string uri) const
+{
+  gchar* checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, uri.c_str (), -1);
+  gchar* file_name = g_build_filename (cache_dir.c_str (), checksum, NULL);
+  std::string result = file_name;
+
+  g_free (file_name);
+  g_free (checksum);
+
+  return result;
+}
+
+XCAP::CoreImpl::CachedDocument*
+XCAP::CoreImpl::lookup_cache (const std::string uri)
+{
+  std::map<std::string, CachedDocument>::iterator iter = cache.find (uri);
+
+  if (iter != cache.end ())
+    return &iter->second;
+
+  /* the disk cache file is the ETag line followed by the document */
+  gchar* contents = NULL;
+  gsize length = 0;
+
+  if ( !g_file_get_contents (get_cache_file (uri).c_str (), &contents, &length, NULL))
+    return NULL;
+
+  std::string raw (contents, length);
+  std::string::size_type eol = raw.find ('\n');
+  g_free (contents);
+
+  if (eol == std::string::npos)
+    return NULL;
+
+  CachedDocument& cached = cache[uri];
+  cached.etag = raw.substr (0, eol);
+  cached.document = raw.substr (eol + 1);
+
+  return &cached;
+}
+
+void
+XCAP::CoreImpl::store_cache (const std::string uri,
+			     const std::string etag,
+			     const std::string document)
+{
+  CachedDocument& cached = cache[uri];
+  const std::string file = get_cache_file (uri);
+  std::string raw;
+
+  cached.etag = etag;
+  cached.document = document;
+
+  /* the documents are contact lists : keep them to the user */
+  raw = etag + "\n" + document;
+  if (g_mkdir_with_parents (cache_dir.c_str (), 0700) != 0
+      || !g_file_set_contents (file.c_str (), raw.c_str (), raw.length (), NULL)
+      || g_chmod (file.c_str (), 0600) != 0)
+    g_warning ("Couldn't write the XCAP cache of %s", uri.c_str ());
+}
+
+bool
+XCAP::CoreImpl::get_cached (boost::shared_ptr<Path> path,
+			    std::string& document)
+{
+  CachedDocument* cached = lookup_cache (path->to_uri ());
+
+  if (cached == NULL)
+    return false;
+
+  document = cached->document;
+
+  return true;
 }
 
 void
 XCAP::CoreImpl::read (boost::shared_ptr<Path> path,
 		      boost::function2<void, bool, std::string> callback)
 {
-  SoupSession* session = NULL;
   SoupMessage* message = NULL;
   cb_read_data* data = NULL;
+  CachedDocument* cached = NULL;
 
-  clear_old_sessions ();
-
-  /* all of this is freed in the result callback */
-  session = soup_session_async_new_with_options ("user-agent", "ekiga", NULL);
   message = soup_message_new ("GET", path->to_uri ().c_str ());
+  if (message == NULL) {
+
+    callback (true, "Invalid XCAP URI");
+    return;
+  }
+
+  /* only download the document again if it changed */
+  cached = lookup_cache (path->to_uri ());
+  if (cached != NULL && !cached->etag.empty ())
+    soup_message_headers_append (message->request_headers,
+				 "If-None-Match", cached->etag.c_str ());
+
+  /* this is freed in the result callback */
   data = new cb_read_data;
   data->core = this;
   data->path = path;
   data->callback = callback;
 
-  g_signal_connect (session, "authenticate",
-		    G_CALLBACK (authenticate_read_callback), data);
-
-  soup_session_queue_message (session, message,
-			      result_read_callback, data);
-
-  pending_sessions.push_back (session);
+  queue_message (path, message, result_read_callback, data);
 }
 
 void
@@ -254,58 +368,49 @@ XCAP::CoreImpl::write (boost::shared_ptr<Path> path,
 		       const std::string content,
 		       boost::function1<void,std::string> callback)
 {
-  SoupSession* session = NULL;
   SoupMessage* message = NULL;
   cb_other_data* data = NULL;
 
-  clear_old_sessions ();
-
-  /* all of this is freed in the result callback */
-  session = soup_session_async_new_with_options ("user-agent", "ekiga", NULL);
   message = soup_message_new ("PUT", path->to_uri ().c_str ());
+  if (message == NULL) {
+
+    callback ("Invalid XCAP URI");
+    return;
+  }
   soup_message_set_request (message, content_type.c_str (),
 			    SOUP_MEMORY_COPY,
 			    content.c_str (), content.length ());
 
+  /* this is freed in the result callback */
   data = new cb_other_data;
   data->core = this;
   data->path = path;
   data->callback = callback;
 
-  g_signal_connect (session, "authenticate",
-		    G_CALLBACK (authenticate_other_callback), data);
-
-  soup_session_queue_message (session, message,
-			      result_other_callback, data);
-
-  pending_sessions.push_back (session);
+  queue_message (path, message, result_other_callback, data);
 }
 
 void
 XCAP::CoreImpl::erase (boost::shared_ptr<Path> path,
 		       boost::function1<void,std::string> callback)
 {
-  SoupSession* session = NULL;
   SoupMessage* message = NULL;
   cb_other_data* data = NULL;
 
-  clear_old_sessions ();
-
-  /* all of this is freed in the result callback */
-  session = soup_session_async_new_with_options ("user-agent", "ekiga", NULL);
   message = soup_message_new ("DELETE", path->to_uri ().c_str ());
+  if (message == NULL) {
+
+    callback ("Invalid XCAP URI");
+    return;
+  }
+
+  /* this is freed in the result callback */
   data = new cb_other_data;
   data->core = this;
   data->path = path;
   data->callback = callback;
 
-  g_signal_connect (session, "authenticate",
-		    G_CALLBACK (authenticate_other_callback), data);
-
-  soup_session_queue_message (session, message,
-			      result_other_callback, data);
-
-  pending_sessions.push_back (session);
+  queue_message (path, message, result_other_callback, data);
 }
 
 
@@ -327,6 +432,13 @@ XCAP::Core::read (boost::shared_ptr<XCAP::Path> path,
   impl->read (path, callback);
 }
 
+bool
+XCAP::Core::get_cached (boost::shared_ptr<Path> path,
+			std::string& document)
+{
+  return impl->get_cached (path, document);
+}
+
 void
 XCAP::Core::write (boost::shared_ptr<Path> path,
 		   const std::string content_type,
@@ -55,7 +55,10 @@ namespace XCAP
 
     ~Core ();
 
-    /* The callback gets a boolean and a string :
+    /* Reading only downloads the document if it changed since the last
+     * read (the server is asked with its ETag).
+     *
+     * The callback gets a boolean and a string :
      * - if the boolean is false, there was no error and the string is the
      * document you wanted ;
      * - if the boolean is true, there was an error and the string is the
@@ -64,6 +67,14 @@ namespace XCAP
     void read (boost::shared_ptr<Path>,
 	       boost::function2<void,bool,std::string> callback);
 
+    /* Gives the last version of the document which was read, even from a
+     * previous run, so it can be shown before the network answers :
+     * - if the result is false, there is no such document ;
+     * - if it's true, the string is the document.
+     */
+    bool get_cached (boost::shared_ptr<Path>,
+		     std::string& document);
+
     /* the callback gets only a string :
      * - if the string is empty, all went well ;
      * - if it's not, then it's the error message.
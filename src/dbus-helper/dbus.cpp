@@ -40,11 +40,19 @@
 #include <dbus/dbus-glib.h>
 #include <ptlib.h>
 
+#include <map>
+
 #include "dbus.h"
+#include "dbus-marshal.h"
 #include "ekiga-settings.h"
 #include "gmcallbacks.h"
 #include "gtk-frontend.h"
 #include "call-core.h"
+#include "account-core.h"
+#include "audioinput-core.h"
+#include "audiooutput-core.h"
+#include "videoinput-core.h"
+#include "scoped-connections.h"
 
 /* Those defines the namespace and path we want to use. */
 #define EKIGA_DBUS_NAMESPACE "org.ekiga.Ekiga"
@@ -56,10 +64,39 @@ G_DEFINE_TYPE(EkigaDBusComponent, ekiga_dbus_component, G_TYPE_OBJECT);
 struct _EkigaDBusComponentPrivate
 {
   boost::weak_ptr<Ekiga::CallCore> call_core;
+  boost::weak_ptr<Ekiga::AccountCore> account_core;
+  boost::weak_ptr<Ekiga::AudioInputCore> audioinput_core;
+  boost::weak_ptr<Ekiga::AudioOutputCore> audiooutput_core;
+  boost::weak_ptr<Ekiga::VideoInputCore> videoinput_core;
   boost::weak_ptr<GtkFrontend> gtk_frontend;
   boost::shared_ptr<Ekiga::Settings> personal_data_settings;
+
+  /* the current calls, by id, with their state and the connection to
+   * their statistics */
+  std::map<std::string, boost::shared_ptr<Ekiga::Call> > calls;
+  std::map<std::string, std::string> call_states;
+  std::map<std::string, boost::signals2::connection> statistics_connections;
+
+  Ekiga::scoped_connections connections;
 };
 
+enum {
+  CALL_STATE_CHANGED_SIGNAL,
+  ACCOUNT_STATE_CHANGED_SIGNAL,
+  CALL_STATISTICS_UPDATED_SIGNAL,
+  LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL] = { 0 };
+
+#define EKIGA_DBUS_ERROR (ekiga_dbus_error_quark ())
+
+static GQuark
+ekiga_dbus_error_quark ()
+{
+  return g_quark_from_static_string ("ekiga-dbus-error");
+}
+
 /**************************
  * GOBJECT / DBUS METHODS *
  **************************/
@@ -74,6 +111,73 @@ static gboolean ekiga_dbus_component_call (EkigaDBusComponent *self,
 static gboolean ekiga_dbus_component_get_user_name (EkigaDBusComponent *self,
                                                     char **name,
                                                     GError **error);
+static gboolean ekiga_dbus_component_list_calls (EkigaDBusComponent *self,
+                                                 char ***ids,
+                                                 GError **error);
+static gboolean ekiga_dbus_component_get_call_info (EkigaDBusComponent *self,
+                                                    const gchar *id,
+                                                    char **remote_uri,
+                                                    char **remote_party_name,
+                                                    char **state,
+                                                    gboolean *outgoing,
+                                                    char **duration,
+                                                    GError **error);
+static gboolean ekiga_dbus_component_answer_call (EkigaDBusComponent *self,
+                                                  const gchar *id,
+                                                  GError **error);
+static gboolean ekiga_dbus_component_hang_up_call (EkigaDBusComponent *self,
+                                                   const gchar *id,
+                                                   GError **error);
+static gboolean ekiga_dbus_component_toggle_hold_call (EkigaDBusComponent *self,
+                                                       const gchar *id,
+                                                       GError **error);
+static gboolean ekiga_dbus_component_transfer_call (EkigaDBusComponent *self,
+                                                    const gchar *id,
+                                                    const gchar *uri,
+                                                    GError **error);
+static gboolean ekiga_dbus_component_list_accounts (EkigaDBusComponent *self,
+                                                    char ***names,
+                                                    GError **error);
+static gboolean ekiga_dbus_component_get_account_state (EkigaDBusComponent *self,
+                                                        const gchar *name,
+                                                        gboolean *enabled,
+                                                        gboolean *active,
+                                                        char **status,
+                                                        GError **error);
+static gboolean ekiga_dbus_component_enable_account (EkigaDBusComponent *self,
+                                                     const gchar *name,
+                                                     GError **error);
+static gboolean ekiga_dbus_component_disable_account (EkigaDBusComponent *self,
+                                                      const gchar *name,
+                                                      GError **error);
+static gboolean ekiga_dbus_component_get_audio_input_counters (EkigaDBusComponent *self,
+                                                               guint *captured,
+                                                               guint *dropped,
+                                                               guint *underruns,
+                                                               GError **error);
+static gboolean ekiga_dbus_component_get_audio_output_counters (EkigaDBusComponent *self,
+                                                                guint *played,
+                                                                guint *underruns,
+                                                                guint *overruns,
+                                                                guint *queue_target,
+                                                                guint *queue_depth,
+                                                                GError **error);
+static gboolean ekiga_dbus_component_get_video_input_counters (EkigaDBusComponent *self,
+                                                               guint *grabbed,
+                                                               guint *dropped,
+                                                               GError **error);
+static gboolean ekiga_dbus_component_get_call_statistics (EkigaDBusComponent *self,
+                                                          const gchar *id,
+                                                          gdouble *received_audio_bandwidth,
+                                                          gdouble *transmitted_audio_bandwidth,
+                                                          gdouble *received_video_bandwidth,
+                                                          gdouble *transmitted_video_bandwidth,
+                                                          guint *packets,
+                                                          guint *lost,
+                                                          guint *late,
+                                                          guint *out_of_order,
+                                                          guint *jitter,
+                                                          GError **error);
 
 /* get the code to make the GObject accessible through dbus
  * (this is especially where we get dbus_glib_dbus_component_object_info !)
@@ -83,14 +187,63 @@ static gboolean ekiga_dbus_component_get_user_name (EkigaDBusComponent *self,
 static void
 ekiga_dbus_component_init (EkigaDBusComponent *self)
 {
-  self->priv = G_TYPE_INSTANCE_GET_PRIVATE (self, EKIGA_TYPE_DBUS_COMPONENT,
-                                            EkigaDBusComponentPrivate);
+  /* the private data holds C++ containers : it can't live in GObject's
+   * private area */
+  self->priv = new EkigaDBusComponentPrivate;
+}
+
+static void
+ekiga_dbus_component_finalize (GObject *obj)
+{
+  EkigaDBusComponent *self = EKIGA_DBUS_COMPONENT (obj);
+
+  for (std::map<std::string, boost::signals2::connection>::iterator iter = self->priv->statistics_connections.begin ();
+       iter != self->priv->statistics_connections.end ();
+       ++iter)
+    iter->second.disconnect ();
+
+  delete self->priv;
+
+  G_OBJECT_CLASS (ekiga_dbus_component_parent_class)->finalize (obj);
 }
 
 static void
 ekiga_dbus_component_class_init (EkigaDBusComponentClass *klass)
 {
-  g_type_class_add_private (klass, sizeof (EkigaDBusComponentPrivate));
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  gobject_class->finalize = ekiga_dbus_component_finalize;
+
+  /* the signals are exported through D-Bus with the same names in
+   * CamelCase, as described in dbus-stub.xml */
+  signals[CALL_STATE_CHANGED_SIGNAL] =
+    g_signal_new ("call-state-changed",
+                  G_OBJECT_CLASS_TYPE (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL,
+                  gm_dbus_marshal_VOID__STRING_STRING,
+                  G_TYPE_NONE, 2,
+                  G_TYPE_STRING, G_TYPE_STRING);
+
+  signals[ACCOUNT_STATE_CHANGED_SIGNAL] =
+    g_signal_new ("account-state-changed",
+                  G_OBJECT_CLASS_TYPE (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL,
+                  gm_dbus_marshal_VOID__STRING_BOOLEAN_BOOLEAN_STRING,
+                  G_TYPE_NONE, 4,
+                  G_TYPE_STRING, G_TYPE_BOOLEAN, G_TYPE_BOOLEAN, G_TYPE_STRING);
+
+  signals[CALL_STATISTICS_UPDATED_SIGNAL] =
+    g_signal_new ("call-statistics-updated",
+                  G_OBJECT_CLASS_TYPE (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL,
+                  gm_dbus_marshal_VOID__STRING_DOUBLE_DOUBLE_DOUBLE_DOUBLE_UINT_UINT_UINT_UINT_UINT,
+                  G_TYPE_NONE, 10,
+                  G_TYPE_STRING,
+                  G_TYPE_DOUBLE, G_TYPE_DOUBLE, G_TYPE_DOUBLE, G_TYPE_DOUBLE,
+                  G_TYPE_UINT, G_TYPE_UINT, G_TYPE_UINT, G_TYPE_UINT, G_TYPE_UINT);
 
   /* initializing as dbus object */
   dbus_g_object_type_install_info (G_TYPE_FROM_CLASS (klass),
@@ -156,6 +309,424 @@ ekiga_dbus_component_get_user_name (EkigaDBusComponent *self,
 }
 
 
+/* the calls and accounts are designated by their id and name on the bus */
+
+static boost::shared_ptr<Ekiga::Call>
+find_call (EkigaDBusComponent *self,
+           const gchar *id,
+           GError **error)
+{
+  std::map<std::string, boost::shared_ptr<Ekiga::Call> >::iterator iter = self->priv->calls.find (id);
+
+  if (iter == self->priv->calls.end ()) {
+
+    g_set_error (error, EKIGA_DBUS_ERROR, 0, "No such call: %s", id);
+    return boost::shared_ptr<Ekiga::Call> ();
+  }
+
+  return iter->second;
+}
+
+static bool
+find_account_helper (Ekiga::AccountPtr account,
+                     const std::string name,
+                     Ekiga::AccountPtr *result)
+{
+  if (account->get_name () == name) {
+
+    *result = account;
+    return false;
+  }
+
+  return true;
+}
+
+static bool
+find_account_in_bank (Ekiga::BankPtr bank,
+                      const std::string name,
+                      Ekiga::AccountPtr *result)
+{
+  bank->visit_accounts (boost::bind (&find_account_helper, _1, name, result));
+
+  return !*result;
+}
+
+static Ekiga::AccountPtr
+find_account (EkigaDBusComponent *self,
+              const gchar *name,
+              GError **error)
+{
+  boost::shared_ptr<Ekiga::AccountCore> account_core = self->priv->account_core.lock ();
+  Ekiga::AccountPtr result;
+
+  if (account_core)
+    account_core->visit_banks (boost::bind (&find_account_in_bank, _1, std::string (name), &result));
+
+  if (!result)
+    g_set_error (error, EKIGA_DBUS_ERROR, 0, "No such account: %s", name);
+
+  return result;
+}
+
+static bool
+list_accounts_helper (Ekiga::AccountPtr account,
+                      GPtrArray *names)
+{
+  g_ptr_array_add (names, g_strdup (account->get_name ().c_str ()));
+
+  return true;
+}
+
+static bool
+list_accounts_in_bank (Ekiga::BankPtr bank,
+                       GPtrArray *names)
+{
+  bank->visit_accounts (boost::bind (&list_accounts_helper, _1, names));
+
+  return true;
+}
+
+static gboolean
+ekiga_dbus_component_list_calls (EkigaDBusComponent *self,
+                                 char ***ids,
+                                 G_GNUC_UNUSED GError **error)
+{
+  unsigned ii = 0;
+
+  *ids = g_new0 (char *, self->priv->calls.size () + 1);
+  for (std::map<std::string, boost::shared_ptr<Ekiga::Call> >::iterator iter = self->priv->calls.begin ();
+       iter != self->priv->calls.end ();
+       ++iter)
+    (*ids)[ii++] = g_strdup (iter->first.c_str ());
+
+  return TRUE;
+}
+
+static gboolean
+ekiga_dbus_component_get_call_info (EkigaDBusComponent *self,
+                                    const gchar *id,
+                                    char **remote_uri,
+                                    char **remote_party_name,
+                                    char **state,
+                                    gboolean *outgoing,
+                                    char **duration,
+                                    GError **error)
+{
+  boost::shared_ptr<Ekiga::Call> call = find_call (self, id, error);
+
+  if (!call)
+    return FALSE;
+
+  *remote_uri = g_strdup (call->get_remote_uri ().c_str ());
+  *remote_party_name = g_strdup (call->get_remote_party_name ().c_str ());
+  *state = g_strdup (self->priv->call_states[id].c_str ());
+  *outgoing = call->is_outgoing ();
+  *duration = g_strdup (call->get_duration ().c_str ());
+
+  return TRUE;
+}
+
+static gboolean
+ekiga_dbus_component_answer_call (EkigaDBusComponent *self,
+                                  const gchar *id,
+                                  GError **error)
+{
+  boost::shared_ptr<Ekiga::Call> call = find_call (self, id, error);
+
+  if (!call)
+    return FALSE;
+
+  call->answer ();
+
+  return TRUE;
+}
+
+static gboolean
+ekiga_dbus_component_hang_up_call (EkigaDBusComponent *self,
+                                   const gchar *id,
+                                   GError **error)
+{
+  boost::shared_ptr<Ekiga::Call> call = find_call (self, id, error);
+
+  if (!call)
+    return FALSE;
+
+  call->hang_up ();
+
+  return TRUE;
+}
+
+static gboolean
+ekiga_dbus_component_toggle_hold_call (EkigaDBusComponent *self,
+                                       const gchar *id,
+                                       GError **error)
+{
+  boost::shared_ptr<Ekiga::Call> call = find_call (self, id, error);
+
+  if (!call)
+    return FALSE;
+
+  call->toggle_hold ();
+
+  return TRUE;
+}
+
+static gboolean
+ekiga_dbus_component_transfer_call (EkigaDBusComponent *self,
+                                    const gchar *id,
+                                    const gchar *uri,
+                                    GError **error)
+{
+  boost::shared_ptr<Ekiga::Call> call = find_call (self, id, error);
+
+  if (!call)
+    return FALSE;
+
+  call->transfer (uri);
+
+  return TRUE;
+}
+
+static gboolean
+ekiga_dbus_component_list_accounts (EkigaDBusComponent *self,
+                                    char ***names,
+                                    G_GNUC_UNUSED GError **error)
+{
+  boost::shared_ptr<Ekiga::AccountCore> account_core = self->priv->account_core.lock ();
+  GPtrArray *result = g_ptr_array_new ();
+
+  if (account_core)
+    account_core->visit_banks (boost::bind (&list_accounts_in_bank, _1, result));
+
+  g_ptr_array_add (result, NULL);
+  *names = (char **) g_ptr_array_free (result, FALSE);
+
+  return TRUE;
+}
+
+static gboolean
+ekiga_dbus_component_get_account_state (EkigaDBusComponent *self,
+                                        const gchar *name,
+                                        gboolean *enabled,
+                                        gboolean *active,
+                                        char **status,
+                                        GError **error)
+{
+  Ekiga::AccountPtr account = find_account (self, name, error);
+
+  if (!account)
+    return FALSE;
+
+  *enabled = account->is_enabled ();
+  *active = account->is_active ();
+  *status = g_strdup (account->get_status ().c_str ());
+
+  return TRUE;
+}
+
+static gboolean
+ekiga_dbus_component_enable_account (EkigaDBusComponent *self,
+                                     const gchar *name,
+                                     GError **error)
+{
+  Ekiga::AccountPtr account = find_account (self, name, error);
+
+  if (!account)
+    return FALSE;
+
+  account->enable ();
+
+  return TRUE;
+}
+
+static gboolean
+ekiga_dbus_component_disable_account (EkigaDBusComponent *self,
+                                      const gchar *name,
+                                      GError **error)
+{
+  Ekiga::AccountPtr account = find_account (self, name, error);
+
+  if (!account)
+    return FALSE;
+
+  account->disable ();
+
+  return TRUE;
+}
+
+static gboolean
+ekiga_dbus_component_get_audio_input_counters (EkigaDBusComponent *self,
+                                               guint *captured,
+                                               guint *dropped,
+                                               guint *underruns,
+                                               G_GNUC_UNUSED GError **error)
+{
+  boost::shared_ptr<Ekiga::AudioInputCore> audioinput_core = self->priv->audioinput_core.lock ();
+  unsigned c = 0, d = 0, u = 0;
+
+  if (audioinput_core)
+    audioinput_core->get_capture_statistics (c, d, u);
+
+  *captured = c;
+  *dropped = d;
+  *underruns = u;
+
+  return TRUE;
+}
+
+static gboolean
+ekiga_dbus_component_get_audio_output_counters (EkigaDBusComponent *self,
+                                                guint *played,
+                                                guint *underruns,
+                                                guint *overruns,
+                                                guint *queue_target,
+                                                guint *queue_depth,
+                                                G_GNUC_UNUSED GError **error)
+{
+  boost::shared_ptr<Ekiga::AudioOutputCore> audiooutput_core = self->priv->audiooutput_core.lock ();
+  unsigned p = 0, u = 0, o = 0, t = 0, q = 0;
+
+  if (audiooutput_core)
+    audiooutput_core->get_playout_statistics (p, u, o, t, q);
+
+  *played = p;
+  *underruns = u;
+  *overruns = o;
+  *queue_target = t;
+  *queue_depth = q;
+
+  return TRUE;
+}
+
+static gboolean
+ekiga_dbus_component_get_video_input_counters (EkigaDBusComponent *self,
+                                               guint *grabbed,
+                                               guint *dropped,
+                                               G_GNUC_UNUSED GError **error)
+{
+  boost::shared_ptr<Ekiga::VideoInputCore> videoinput_core = self->priv->videoinput_core.lock ();
+  unsigned g = 0, d = 0;
+
+  if (videoinput_core)
+    videoinput_core->get_capture_statistics (g, d);
+
+  *grabbed = g;
+  *dropped = d;
+
+  return TRUE;
+}
+
+static gboolean
+ekiga_dbus_component_get_call_statistics (EkigaDBusComponent *self,
+                                          const gchar *id,
+                                          gdouble *received_audio_bandwidth,
+                                          gdouble *transmitted_audio_bandwidth,
+                                          gdouble *received_video_bandwidth,
+                                          gdouble *transmitted_video_bandwidth,
+                                          guint *packets,
+                                          guint *lost,
+                                          guint *late,
+                                          guint *out_of_order,
+                                          guint *jitter,
+                                          GError **error)
+{
+  boost::shared_ptr<Ekiga::Call> call = find_call (self, id, error);
+  Ekiga::CallStatistics statistics;
+
+  if (!call)
+    return FALSE;
+
+  const Ekiga::CallStatisticsHistory& history = call->get_statistics_history ();
+  if (history.size () > 0)
+    statistics = history[history.size () - 1];
+
+  *received_audio_bandwidth = statistics.received_audio.bandwidth;
+  *transmitted_audio_bandwidth = statistics.transmitted_audio.bandwidth;
+  *received_video_bandwidth = statistics.received_video.bandwidth;
+  *transmitted_video_bandwidth = statistics.transmitted_video.bandwidth;
+  *packets = statistics.received_audio.packets + statistics.received_video.packets;
+  *lost = statistics.received_audio.lost_packets + statistics.received_video.lost_packets;
+  *late = statistics.received_audio.late_packets + statistics.received_video.late_packets;
+  *out_of_order = statistics.received_audio.out_of_order_packets + statistics.received_video.out_of_order_packets;
+  *jitter = statistics.received_audio.jitter;
+
+  return TRUE;
+}
+
+
+/*****************************
+ * ENGINE SIGNALS TO D-BUS   *
+ *****************************/
+
+static void
+on_call_statistics_updated (const Ekiga::CallStatistics& statistics,
+                            std::string id,
+                            EkigaDBusComponent *self)
+{
+  g_signal_emit (self, signals[CALL_STATISTICS_UPDATED_SIGNAL], 0,
+                 id.c_str (),
+                 statistics.received_audio.bandwidth,
+                 statistics.transmitted_audio.bandwidth,
+                 statistics.received_video.bandwidth,
+                 statistics.transmitted_video.bandwidth,
+                 statistics.received_audio.packets + statistics.received_video.packets,
+                 statistics.received_audio.lost_packets + statistics.received_video.lost_packets,
+                 statistics.received_audio.late_packets + statistics.received_video.late_packets,
+                 statistics.received_audio.out_of_order_packets + statistics.received_video.out_of_order_packets,
+                 statistics.received_audio.jitter);
+}
+
+static void
+on_call_state (boost::shared_ptr<Ekiga::Call> call,
+               const std::string state,
+               EkigaDBusComponent *self)
+{
+  const std::string id = call->get_id ();
+
+  if (state == "cleared" || state == "missed") {
+
+    std::map<std::string, boost::signals2::connection>::iterator iter = self->priv->statistics_connections.find (id);
+    if (iter != self->priv->statistics_connections.end ()) {
+
+      iter->second.disconnect ();
+      self->priv->statistics_connections.erase (iter);
+    }
+    self->priv->calls.erase (id);
+    self->priv->call_states.erase (id);
+  }
+  else {
+
+    if (self->priv->calls.find (id) == self->priv->calls.end ()) {
+
+      self->priv->calls[id] = call;
+      self->priv->statistics_connections[id] =
+        call->statistics_updated.connect (boost::bind (&on_call_statistics_updated, _1, id, self));
+    }
+    self->priv->call_states[id] = state;
+  }
+
+  g_signal_emit (self, signals[CALL_STATE_CHANGED_SIGNAL], 0, id.c_str (), state.c_str ());
+}
+
+static void
+on_setup_call (boost::shared_ptr<Ekiga::Call> call,
+               EkigaDBusComponent *self)
+{
+  on_call_state (call, call->is_outgoing () ? "calling" : "incoming", self);
+}
+
+static void
+on_account_updated (Ekiga::AccountPtr account,
+                    EkigaDBusComponent *self)
+{
+  g_signal_emit (self, signals[ACCOUNT_STATE_CHANGED_SIGNAL], 0,
+                 account->get_name ().c_str (),
+                 (gboolean) account->is_enabled (),
+                 (gboolean) account->is_active (),
+                 account->get_status ().c_str ());
+}
+
+
 /**************
  * PUBLIC API *
  **************/
@@ -223,8 +794,28 @@ ekiga_dbus_component_new (Ekiga::ServiceCore& service_core)
   obj = EKIGA_DBUS_COMPONENT (g_object_new (EKIGA_TYPE_DBUS_COMPONENT, NULL));
   obj->priv->gtk_frontend = service_core.get<GtkFrontend> ("gtk-frontend");
   obj->priv->call_core = service_core.get<Ekiga::CallCore> ("call-core");
+  obj->priv->account_core = service_core.get<Ekiga::AccountCore> ("account-core");
+  obj->priv->audioinput_core = service_core.get<Ekiga::AudioInputCore> ("audioinput-core");
+  obj->priv->audiooutput_core = service_core.get<Ekiga::AudioOutputCore> ("audiooutput-core");
+  obj->priv->videoinput_core = service_core.get<Ekiga::VideoInputCore> ("videoinput-core");
   obj->priv->personal_data_settings =
     boost::shared_ptr<Ekiga::Settings> (new Ekiga::Settings (PERSONAL_DATA_SCHEMA));
+
+  boost::shared_ptr<Ekiga::CallCore> call_core = obj->priv->call_core.lock ();
+  if (call_core) {
+
+    obj->priv->connections.add (call_core->setup_call.connect (boost::bind (&on_setup_call, _2, obj)));
+    obj->priv->connections.add (call_core->ringing_call.connect (boost::bind (&on_call_state, _2, "ringing", obj)));
+    obj->priv->connections.add (call_core->established_call.connect (boost::bind (&on_call_state, _2, "established", obj)));
+    obj->priv->connections.add (call_core->held_call.connect (boost::bind (&on_call_state, _2, "held", obj)));
+    obj->priv->connections.add (call_core->retrieved_call.connect (boost::bind (&on_call_state, _2, "established", obj)));
+    obj->priv->connections.add (call_core->cleared_call.connect (boost::bind (&on_call_state, _2, "cleared", obj)));
+    obj->priv->connections.add (call_core->missed_call.connect (boost::bind (&on_call_state, _2, "missed", obj)));
+  }
+
+  boost::shared_ptr<Ekiga::AccountCore> account_core = obj->priv->account_core.lock ();
+  if (account_core)
+    obj->priv->connections.add (account_core->account_updated.connect (boost::bind (&on_account_updated, _2, obj)));
   dbus_g_connection_register_g_object (bus, EKIGA_DBUS_PATH, G_OBJECT (obj));
 
   return obj;